@@ -74,4 +74,6 @@ check_function_exists("mmap"             HAVE_MMAP)
 check_function_exists("mprotect"         HAVE_MPROTECT)
 check_function_exists("mkdtemp"          HAVE_MKDTEMP)
 check_function_exists("mkstemp"          HAVE_MKSTEMP)
+check_function_exists("posix_fadvise"    HAVE_POSIX_FADVISE)
+check_function_exists("pread"            HAVE_PREAD)
 check_function_exists("sysconf"          HAVE_SYSCONF)
@@ -110,6 +110,25 @@
 
 static gboolean continue_after_wtap_open_offline_failure = TRUE;
 
+/*
+ * The '-j' option sets the number of worker threads reading
+ * files; with more than one, several pcap and pcapng files are
+ * read at once, and at most twice that many files are open at
+ * any time.
+ * The infos are still reported in command line order.
+ */
+
+static int     worker_threads = 1;
+static GMutex *jobs_mtx = NULL;     /* protects the done flag of the jobs  */
+static GCond  *jobs_cond = NULL;    /* signalled when a job is done        */
+
+/*
+ * The '-f' option skips over the packet data, where the file
+ * format allows it, as none of the infos need it.
+ */
+
+static gboolean fast_mode = FALSE;
+
 /*
  * table report variables
  */
@@ -149,6 +168,7 @@ static gboolean cap_data_rate_bit = TRUE;   /* Report data rate bites/sec */
 static gboolean cap_packet_size = TRUE;     /* Report average packet size */
 static gboolean cap_packet_rate = TRUE;     /* Report average packet rate */
 static gboolean cap_order = TRUE;           /* Report if packets are in chronological order (True/False) */
+static gboolean cap_read_stall = FALSE;     /* Report time spent waiting for the file to be read (not in -A) */
 
 #ifdef HAVE_LIBGCRYPT
 static gboolean cap_file_hashes = TRUE;     /* Calculate file hashes */
@@ -162,11 +182,6 @@ static gboolean cap_file_hashes = TRUE;     /* Calculate file hashes */
 #define HASH_STR_SIZE (41) /* Max hash size * 2 + '\0' */
 #define HASH_BUF_SIZE (1024 * 1024)
 
-
-static gchar file_sha1[HASH_STR_SIZE];
-static gchar file_rmd160[HASH_STR_SIZE];
-static gchar file_md5[HASH_STR_SIZE];
-
 #define FILE_HASH_OPT "H"
 #else
 #define FILE_HASH_OPT ""
@@ -213,10 +228,34 @@ typedef struct _capture_info {
   double        data_rate;              /* in bytes */
   gboolean      know_order;
   order_t       order;
+  double        read_stall_time;        /* in seconds */
 
   int          *encap_counts;           /* array of per_packet encap counts; array has one entry per wtap_encap type */
+
+#ifdef HAVE_LIBGCRYPT
+  gchar         file_sha1[HASH_STR_SIZE];
+  gchar         file_rmd160[HASH_STR_SIZE];
+  gchar         file_md5[HASH_STR_SIZE];
+#endif /* HAVE_LIBGCRYPT */
 } capture_info;
 
+/*
+ * One input file: opened by the main thread, read by a worker
+ * thread (or by the main thread itself without '-j') and
+ * reported by the main thread.
+ */
+typedef struct _cap_job {
+  const char    *filename;
+  wtap          *wth;
+  gboolean       opened;                /* FALSE if wtap_open_offline() failed */
+  int            open_err;
+  gchar         *open_err_info;
+  int            status;                /* return value of process_cap_file() */
+  gchar         *err_msg;               /* error to report if status != 0     */
+  gboolean       done;                  /* set once the file has been read    */
+  capture_info   cf_info;
+} cap_job;
+
 static void
 enable_all_infos(void)
 {
@@ -403,12 +442,13 @@ print_stats(const gchar *filename, capture_info *cf_info)
   }
 #ifdef HAVE_LIBGCRYPT
   if (cap_file_hashes) {
-                          printf     ("SHA1:                %s\n", file_sha1);
-                          printf     ("RIPEMD160:           %s\n", file_rmd160);
-                          printf     ("MD5:                 %s\n", file_md5);
+                          printf     ("SHA1:                %s\n", cf_info->file_sha1);
+                          printf     ("RIPEMD160:           %s\n", cf_info->file_rmd160);
+                          printf     ("MD5:                 %s\n", cf_info->file_md5);
   }
 #endif /* HAVE_LIBGCRYPT */
   if (cap_order)          printf     ("Strict time order:   %s\n", order_string(cf_info->order));
+  if (cap_read_stall)     printf     ("Read stall time:     %.6f seconds\n", cf_info->read_stall_time);
 }
 
 static void
@@ -462,6 +502,7 @@ print_stats_table_header(void)
   }
 #endif /* HAVE_LIBGCRYPT */
   if (cap_order)          print_stats_table_header_label("Strict time order");
+  if (cap_read_stall)     print_stats_table_header_label("Read stall time (seconds)");
 
   printf("\n");
 }
@@ -620,17 +661,17 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
   if (cap_file_hashes) {
     putsep();
     putquote();
-    printf("%s", file_sha1);
+    printf("%s", cf_info->file_sha1);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_rmd160);
+    printf("%s", cf_info->file_rmd160);
     putquote();
 
     putsep();
     putquote();
-    printf("%s", file_md5);
+    printf("%s", cf_info->file_md5);
     putquote();
   }
 #endif /* HAVE_LIBGCRYPT */
@@ -642,11 +683,24 @@ print_stats_table(const gchar *filename, capture_info *cf_info)
     putquote();
   }
 
+  if (cap_read_stall) {
+    putsep();
+    putquote();
+    printf("%f", cf_info->read_stall_time);
+    putquote();
+  }
+
   printf("\n");
 }
 
+/*
+ * Read through a capture file and fill in *cf_info.  Returns 0 on
+ * success; on failure returns 1 and sets *err_msg to a message to
+ * report.  Doesn't print anything, as it may run on a worker thread.
+ */
 static int
-process_cap_file(wtap *wth, const char *filename)
+process_cap_file(wtap *wth, const char *filename, capture_info *cf_info,
+                 gchar **err_msg)
 {
   int                   err;
   gchar                 *err_info;
@@ -658,7 +712,6 @@ process_cap_file(wtap *wth, const char *filename)
   guint32               snaplen_min_inferred = 0xffffffff;
   guint32               snaplen_max_inferred =          0;
   const struct wtap_pkthdr *phdr;
-  capture_info          cf_info;
   gboolean		have_times = TRUE;
   double                start_time = 0;
   double                stop_time  = 0;
@@ -667,7 +720,7 @@ process_cap_file(wtap *wth, const char *filename)
   gboolean		know_order = FALSE;
   order_t		order = IN_ORDER;
 
-  cf_info.encap_counts = g_malloc0(WTAP_NUM_ENCAP_TYPES * sizeof(int));
+  cf_info->encap_counts = g_malloc0(WTAP_NUM_ENCAP_TYPES * sizeof(int));
 
   /* Tally up data that we need to parse through the file to find */
   while (wtap_read(wth, &err, &err_info, &data_offset))  {
@@ -712,7 +765,7 @@ process_cap_file(wtap *wth, const char *filename)
     /* Per-packet encapsulation */
     if (wtap_file_encap(wth) == WTAP_ENCAP_PER_PACKET) {
         if ((phdr->pkt_encap > 0) && (phdr->pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-            cf_info.encap_counts[phdr->pkt_encap] += 1;
+            cf_info->encap_counts[phdr->pkt_encap] += 1;
         } else {
             fprintf(stderr, "capinfos: Unknown per-packet encapsulation: %d [frame number: %d]\n", phdr->pkt_encap, packet);
         }
@@ -721,89 +774,254 @@ process_cap_file(wtap *wth, const char *filename)
   } /* while */
 
   if (err != 0) {
-    fprintf(stderr,
-            "capinfos: An error occurred after reading %u packets from \"%s\": %s.\n",
-            packet, filename, wtap_strerror(err));
     switch (err) {
 
     case WTAP_ERR_UNSUPPORTED:
     case WTAP_ERR_UNSUPPORTED_ENCAP:
     case WTAP_ERR_BAD_FILE:
     case WTAP_ERR_DECOMPRESS:
-      fprintf(stderr, "(%s)\n", err_info);
+      *err_msg = g_strdup_printf(
+            "capinfos: An error occurred after reading %u packets from \"%s\": %s.\n(%s)\n",
+            packet, filename, wtap_strerror(err), err_info);
       g_free(err_info);
       break;
+
+    default:
+      *err_msg = g_strdup_printf(
+            "capinfos: An error occurred after reading %u packets from \"%s\": %s.\n",
+            packet, filename, wtap_strerror(err));
+      break;
     }
-    g_free(cf_info.encap_counts);
+    g_free(cf_info->encap_counts);
     return 1;
   }
 
   /* File size */
   size = wtap_file_size(wth, &err);
   if (size == -1) {
-    fprintf(stderr,
+    *err_msg = g_strdup_printf(
             "capinfos: Can't get size of \"%s\": %s.\n",
             filename, g_strerror(err));
-    g_free(cf_info.encap_counts);
+    g_free(cf_info->encap_counts);
     return 1;
   }
 
-  cf_info.filesize = size;
+  cf_info->filesize = size;
 
   /* File Type */
-  cf_info.file_type = wtap_file_type(wth);
-  cf_info.iscompressed = wtap_iscompressed(wth);
+  cf_info->file_type = wtap_file_type(wth);
+  cf_info->iscompressed = wtap_iscompressed(wth);
 
   /* File Encapsulation */
-  cf_info.file_encap = wtap_file_encap(wth);
+  cf_info->file_encap = wtap_file_encap(wth);
 
   /* Packet size limit (snaplen) */
-  cf_info.snaplen = wtap_snapshot_length(wth);
-  if(cf_info.snaplen > 0)
-    cf_info.snap_set = TRUE;
+  cf_info->snaplen = wtap_snapshot_length(wth);
+  if(cf_info->snaplen > 0)
+    cf_info->snap_set = TRUE;
   else
-    cf_info.snap_set = FALSE;
+    cf_info->snap_set = FALSE;
 
-  cf_info.snaplen_min_inferred = snaplen_min_inferred;
-  cf_info.snaplen_max_inferred = snaplen_max_inferred;
+  cf_info->snaplen_min_inferred = snaplen_min_inferred;
+  cf_info->snaplen_max_inferred = snaplen_max_inferred;
 
   /* # of packets */
-  cf_info.packet_count = packet;
+  cf_info->packet_count = packet;
 
   /* File Times */
-  cf_info.times_known = have_times;
-  cf_info.start_time = start_time;
-  cf_info.stop_time = stop_time;
-  cf_info.duration = stop_time-start_time;
-  cf_info.know_order = know_order;
-  cf_info.order = order;
+  cf_info->times_known = have_times;
+  cf_info->start_time = start_time;
+  cf_info->stop_time = stop_time;
+  cf_info->duration = stop_time-start_time;
+  cf_info->know_order = know_order;
+  cf_info->order = order;
 
   /* Number of packet bytes */
-  cf_info.packet_bytes = bytes;
+  cf_info->packet_bytes = bytes;
 
-  cf_info.data_rate   = 0.0;
-  cf_info.packet_rate = 0.0;
-  cf_info.packet_size = 0.0;
+  /* Time spent waiting for the file to be read */
+  cf_info->read_stall_time = wtap_read_stall_time(wth);
+
+  cf_info->data_rate   = 0.0;
+  cf_info->packet_rate = 0.0;
+  cf_info->packet_size = 0.0;
 
   if (packet > 0) {
-    if (cf_info.duration > 0.0) {
-      cf_info.data_rate   = (double)bytes  / (stop_time-start_time); /* Data rate per second */
-      cf_info.packet_rate = (double)packet / (stop_time-start_time); /* packet rate per second */
+    if (cf_info->duration > 0.0) {
+      cf_info->data_rate   = (double)bytes  / (stop_time-start_time); /* Data rate per second */
+      cf_info->packet_rate = (double)packet / (stop_time-start_time); /* packet rate per second */
+    }
+    cf_info->packet_size = (double)bytes / packet;                  /* Avg packet size      */
+  }
+
+  return 0;
+}
+
+#ifdef HAVE_LIBGCRYPT
+static void
+hash_to_str(const unsigned char *hash, size_t length, char *str) {
+  int i;
+
+  for (i = 0; i < (int) length; i++) {
+    g_snprintf(str+(i*2), 3, "%02x", hash[i]);
+  }
+}
+
+static void
+calculate_hashes(const char *filename, capture_info *cf_info)
+{
+  FILE  *fh;
+  char  *hash_buf;
+  gcry_md_hd_t hd = NULL;
+  size_t hash_bytes;
+
+  g_strlcpy(cf_info->file_sha1, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_rmd160, "<unknown>", HASH_STR_SIZE);
+  g_strlcpy(cf_info->file_md5, "<unknown>", HASH_STR_SIZE);
+
+  if (!cap_file_hashes)
+    return;
+
+  gcry_md_open(&hd, GCRY_MD_SHA1, 0);
+  if (!hd)
+    return;
+  gcry_md_enable(hd, GCRY_MD_RMD160);
+  gcry_md_enable(hd, GCRY_MD_MD5);
+
+  fh = ws_fopen(filename, "rb");
+  if (fh) {
+    hash_buf = (char *)g_malloc(HASH_BUF_SIZE);
+    while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
+      gcry_md_write(hd, hash_buf, hash_bytes);
+    }
+    g_free(hash_buf);
+    fclose(fh);
+    gcry_md_final(hd);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, cf_info->file_sha1);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, cf_info->file_rmd160);
+    hash_to_str(gcry_md_read(hd, GCRY_MD_MD5), HASH_SIZE_MD5, cf_info->file_md5);
+  }
+  gcry_md_close(hd);
+}
+#endif /* HAVE_LIBGCRYPT */
+
+/*
+ * Read one input file; run by the worker threads with '-j',
+ * otherwise called directly by the main thread.
+ */
+static void
+run_cap_job(gpointer data, gpointer user_data _U_)
+{
+  cap_job *job = (cap_job *)data;
+
+  if (fast_mode)
+    wtap_set_skip_packet_data(job->wth, TRUE);
+  job->status = process_cap_file(job->wth, job->filename, &job->cf_info,
+                                 &job->err_msg);
+  wtap_close(job->wth);
+  job->wth = NULL;
+
+  if (jobs_mtx != NULL) {
+    g_mutex_lock(jobs_mtx);
+    job->done = TRUE;
+    g_cond_broadcast(jobs_cond);
+    g_mutex_unlock(jobs_mtx);
+  } else {
+    job->done = TRUE;
+  }
+}
+
+/*
+ * Only the pcap and pcapng readers are known to keep no static or
+ * global state; files of other types are read by the main thread,
+ * so they can't race with each other or with the opening of the
+ * next file.
+ */
+static gboolean
+cap_job_threadable(wtap *wth)
+{
+  switch (wtap_file_type(wth)) {
+
+  case WTAP_FILE_PCAP:
+  case WTAP_FILE_PCAPNG:
+  case WTAP_FILE_PCAP_NSEC:
+  case WTAP_FILE_PCAP_AIX:
+  case WTAP_FILE_PCAP_SS991029:
+  case WTAP_FILE_PCAP_NOKIA:
+  case WTAP_FILE_PCAP_SS990417:
+  case WTAP_FILE_PCAP_SS990915:
+    return TRUE;
+
+  default:
+    return FALSE;
+  }
+}
+
+static gboolean
+cap_job_done(cap_job *job)
+{
+  gboolean done;
+
+  if (jobs_mtx == NULL)
+    return job->done;
+  g_mutex_lock(jobs_mtx);
+  done = job->done;
+  g_mutex_unlock(jobs_mtx);
+  return done;
+}
+
+/*
+ * Wait for a job to be done, then report on its file.  Exits, as
+ * capinfos always has, if the file couldn't be read, or if it
+ * couldn't be opened and '-C' was given.  Otherwise returns 1 if
+ * it couldn't be opened and 0 if it was reported.
+ */
+static int
+report_cap_job(cap_job *job, gboolean first)
+{
+  if (jobs_mtx != NULL) {
+    g_mutex_lock(jobs_mtx);
+    while (!job->done)
+      g_cond_wait(jobs_cond, jobs_mtx);
+    g_mutex_unlock(jobs_mtx);
+  }
+
+  if (!job->opened) {
+    fprintf(stderr, "capinfos: Can't open %s: %s\n", job->filename,
+      wtap_strerror(job->open_err));
+    switch (job->open_err) {
+
+    case WTAP_ERR_UNSUPPORTED:
+    case WTAP_ERR_UNSUPPORTED_ENCAP:
+    case WTAP_ERR_BAD_FILE:
+      fprintf(stderr, "(%s)\n", job->open_err_info);
+      g_free(job->open_err_info);
+      break;
     }
-    cf_info.packet_size = (double)bytes / packet;                  /* Avg packet size      */
+    if(!continue_after_wtap_open_offline_failure)
+      exit(1); /* error status */
+    return 1;
+  }
+
+  if (!first && long_report)
+    printf("\n");
+  if (job->status) {
+    fputs(job->err_msg, stderr);
+    exit(job->status);
   }
 
   if(long_report) {
-    print_stats(filename, &cf_info);
+    print_stats(job->filename, &job->cf_info);
   } else {
-    print_stats_table(filename, &cf_info);
+    print_stats_table(job->filename, &job->cf_info);
   }
 
-  g_free(cf_info.encap_counts);
+  g_free(job->cf_info.encap_counts);
 
   return 0;
 }
 
+
 static void
 usage(gboolean is_error)
 {
@@ -852,6 +1070,7 @@ usage(gboolean is_error)
   fprintf(output, "  -i display average data rate (in bits/sec)\n");
   fprintf(output, "  -z display average packet size (in bytes)\n");
   fprintf(output, "  -x display average packet rate (in packets/sec)\n");
+  fprintf(output, "  -w display time spent waiting for the file to be read (in seconds)\n");
   fprintf(output, "\n");
   fprintf(output, "Output format:\n");
   fprintf(output, "  -L generate long report (default)\n");
@@ -873,12 +1092,14 @@ usage(gboolean is_error)
   fprintf(output, "  -h display this help and exit\n");
   fprintf(output, "  -C cancel processing if file open fails (default is to continue)\n");
   fprintf(output, "  -A generate all infos (default)\n");
+  fprintf(output, "  -f don't read packet data where possible (pcap and pcapng files)\n");
+  fprintf(output, "  -j <threads> read up to <threads> files at the same time (default 1)\n");
   fprintf(output, "\n");
   fprintf(output, "Options are processed from left to right order with later options superceeding\n");
   fprintf(output, "or adding to earlier options.\n");
   fprintf(output, "\n");
-  fprintf(output, "If no options are given the default is to display all infos in long report\n");
-  fprintf(output, "output format.\n");
+  fprintf(output, "If no options are given the default is to display all infos, except -w, in long\n");
+  fprintf(output, "report output format.\n");
 #ifndef HAVE_LIBGCRYPT
   fprintf(output, "\nFile hashing support (-H) is not present.\n");
 #endif
@@ -897,41 +1118,31 @@ failure_message(const char *msg_format _U_, va_list ap _U_)
 }
 #endif
 
-#ifdef HAVE_LIBGCRYPT
-static void
-hash_to_str(const unsigned char *hash, size_t length, char *str) {
-  int i;
-
-  for (i = 0; i < (int) length; i++) {
-    g_snprintf(str+(i*2), 3, "%02x", hash[i]);
-  }
-}
-#endif /* HAVE_LIBGCRYPT */
-
 int
 main(int argc, char *argv[])
 {
-  wtap  *wth;
-  int    err;
-  gchar *err_info;
   int    opt;
   int    overall_error_status;
+  char  *p;
+  int    num_files;
+  int    i, next_report;
+  cap_job *jobs;
+  cap_job *job;
+  GThreadPool *pool = NULL;
 
-  int status = 0;
 #ifdef HAVE_PLUGINS
   char  *init_progfile_dir_error;
 #endif
-#ifdef HAVE_LIBGCRYPT
-  FILE  *fh;
-  char  *hash_buf = NULL;
-  gcry_md_hd_t hd = NULL;
-  size_t hash_bytes;
-#endif
 
 #ifdef _WIN32
   arg_list_utf_16to8(argc, argv);
 #endif /* _WIN32 */
 
+#if !GLIB_CHECK_VERSION(2,31,0)
+  /* Initialize the thread system */
+  g_thread_init(NULL);
+#endif
+
   /*
    * Get credential information for later use.
    */
@@ -951,7 +1162,7 @@ main(int argc, char *argv[])
 
   /* Process the options */
 
-  while ((opt = getopt(argc, argv, "tEcs" FILE_HASH_OPT "dluaeyizvhxoCALTRrSNqQBmb")) !=-1) {
+  while ((opt = getopt(argc, argv, "tEcs" FILE_HASH_OPT "dluaeyizvhxwoCALTRrSNqQBmbfj:")) !=-1) {
 
     switch (opt) {
 
@@ -1024,6 +1235,11 @@ main(int argc, char *argv[])
       cap_packet_rate = TRUE;
       break;
 
+    case 'w':
+      if (report_all_infos) disable_all_infos();
+      cap_read_stall = TRUE;
+      break;
+
 #ifdef HAVE_LIBGCRYPT
     case 'H':
       if (report_all_infos) disable_all_infos();
@@ -1084,6 +1300,19 @@ main(int argc, char *argv[])
       field_separator = ' ';
       break;
 
+    case 'f':
+      fast_mode = TRUE;
+      break;
+
+    case 'j':
+      worker_threads = (int)strtol(optarg, &p, 10);
+      if (p == optarg || *p != '\0' || worker_threads < 1) {
+        fprintf(stderr, "capinfos: \"%s\" isn't a valid number of threads\n",
+                optarg);
+        exit(1);
+      }
+      break;
+
     case 'h':
       usage(FALSE);
       exit(1);
@@ -1108,68 +1337,73 @@ main(int argc, char *argv[])
 #ifdef HAVE_LIBGCRYPT
   if (cap_file_hashes) {
     gcry_check_version(NULL);
-    gcry_md_open(&hd, GCRY_MD_SHA1, 0);
-    if (hd) {
-      gcry_md_enable(hd, GCRY_MD_RMD160);
-      gcry_md_enable(hd, GCRY_MD_MD5);
-    }
-    hash_buf = (char *)g_malloc(HASH_BUF_SIZE);
+    gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
   }
 #endif
 
   overall_error_status = 0;
 
-  for (opt = optind; opt < argc; opt++) {
-
-#ifdef HAVE_LIBGCRYPT
-    g_strlcpy(file_sha1, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_rmd160, "<unknown>", HASH_STR_SIZE);
-    g_strlcpy(file_md5, "<unknown>", HASH_STR_SIZE);
-
-    if (cap_file_hashes) {
-      fh = ws_fopen(argv[opt], "rb");
-      if (fh && hd) {
-        while((hash_bytes = fread(hash_buf, 1, HASH_BUF_SIZE, fh)) > 0) {
-          gcry_md_write(hd, hash_buf, hash_bytes);
-        }
-        gcry_md_final(hd);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_SHA1), HASH_SIZE_SHA1, file_sha1);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_RMD160), HASH_SIZE_RMD160, file_rmd160);
-        hash_to_str(gcry_md_read(hd, GCRY_MD_MD5), HASH_SIZE_MD5, file_md5);
-      }
-      if (fh) fclose(fh);
-      if (hd) gcry_md_reset(hd);
-    }
-#endif /* HAVE_LIBGCRYPT */
+  num_files = argc - optind;
+  jobs = g_new0(cap_job, num_files);
+  if (worker_threads > 1 && num_files > 1) {
+    pool = g_thread_pool_new(run_cap_job, NULL, worker_threads, FALSE, NULL);
+#if GLIB_CHECK_VERSION(2,31,0)
+    jobs_mtx = g_new(GMutex, 1);
+    g_mutex_init(jobs_mtx);
+    jobs_cond = g_new(GCond, 1);
+    g_cond_init(jobs_cond);
+#else
+    jobs_mtx = g_mutex_new();
+    jobs_cond = g_cond_new();
+#endif
+  }
 
-    wth = wtap_open_offline(argv[opt], &err, &err_info, FALSE);
+  /*
+   * Open the files here, in order, and hand them to the worker
+   * threads; report on each one once it and the files before it
+   * have been read, keeping no more than 2 * worker_threads files
+   * open.
+   */
+  next_report = 0;
+  for (i = 0; i < num_files; i++) {
+    job = &jobs[i];
+    job->filename = argv[optind + i];
+    job->wth = wtap_open_offline(job->filename, &job->open_err,
+                                 &job->open_err_info, FALSE);
 
-    if (!wth) {
-      fprintf(stderr, "capinfos: Can't open %s: %s\n", argv[opt],
-        wtap_strerror(err));
-      switch (err) {
+    job->opened = (job->wth != NULL);
 
-      case WTAP_ERR_UNSUPPORTED:
-      case WTAP_ERR_UNSUPPORTED_ENCAP:
-      case WTAP_ERR_BAD_FILE:
-        fprintf(stderr, "(%s)\n", err_info);
-        g_free(err_info);
-        break;
-      }
-      overall_error_status = 1; /* remember that an error has occurred */
+    if (!job->opened) {
+      job->done = TRUE;
       if(!continue_after_wtap_open_offline_failure)
-        exit(1); /* error status */
+        num_files = i + 1; /* don't open any more files */
+    } else {
+#ifdef HAVE_LIBGCRYPT
+      /*
+       * Hash on this thread: gcrypt is initialized without thread
+       * callbacks, and releases before 1.6 aren't safe to use from
+       * several threads without them.
+       */
+      calculate_hashes(job->filename, &job->cf_info);
+#endif /* HAVE_LIBGCRYPT */
+      if (pool != NULL && cap_job_threadable(job->wth))
+        g_thread_pool_push(pool, job, NULL);
+      else
+        run_cap_job(job, NULL);
     }
 
-    if(wth) {
-      if ((opt > optind) && (long_report))
-        printf("\n");
-      status = process_cap_file(wth, argv[opt]);
-
-      wtap_close(wth);
-      if (status)
-        exit(status);
+    while (next_report <= i && (i - next_report >= 2 * worker_threads - 1 ||
+                                cap_job_done(&jobs[next_report]) ||
+                                i == num_files - 1)) {
+      if (report_cap_job(&jobs[next_report], next_report == 0))
+        overall_error_status = 1; /* remember that an error has occurred */
+      next_report++;
     }
   }
+
+  if (pool != NULL)
+    g_thread_pool_free(pool, FALSE, TRUE);
+  g_free(jobs);
+
   return overall_error_status;
 }
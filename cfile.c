@@ -48,5 +48,7 @@ cap_file_init(capture_file *cf)
   cf->rfcode          = NULL;
   cf->dfilter         = NULL;
   cf->redissecting    = FALSE;
+  cf->dfilter_flags_valid = TRUE;
+  cf->dfilter_results = NULL;
   cf->frames          = NULL;
 }
@@ -91,6 +91,8 @@ typedef struct _capture_file {
   dfilter_t   *rfcode;          /* Compiled read (display) filter program */
   gchar       *dfilter;         /* Display filter string */
   gboolean     redissecting;    /* TRUE if currently redissecting (cf_redissect_packets) */
+  gboolean     dfilter_flags_valid; /* TRUE if the frames' passed_dfilter flags are the results of dfilter */
+  GSList      *dfilter_results; /* Saved results of recently used display filters */
   /* search */
   gchar       *sfilter;         /* Filter, hex value, or string being searched */
   gboolean     hex;             /* TRUE if "Hex value" search was last selected */
@@ -0,0 +1,35 @@
+#
+# $Id$
+#
+# - Find zstd
+# Find the native ZSTD includes and library
+#
+#  ZSTD_INCLUDE_DIRS - where to find zstd.h, etc.
+#  ZSTD_LIBRARIES    - List of libraries when using zstd.
+#  ZSTD_FOUND        - True if zstd found.
+
+
+IF (ZSTD_INCLUDE_DIRS)
+  # Already in cache, be silent
+  SET(ZSTD_FIND_QUIETLY TRUE)
+ENDIF (ZSTD_INCLUDE_DIRS)
+
+FIND_PATH(ZSTD_INCLUDE_DIR zstd.h)
+
+SET(ZSTD_NAMES zstd)
+FIND_LIBRARY(ZSTD_LIBRARY NAMES ${ZSTD_NAMES} )
+
+# handle the QUIETLY and REQUIRED arguments and set ZSTD_FOUND to TRUE if 
+# all listed variables are TRUE
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(ZSTD DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
+
+IF(ZSTD_FOUND)
+  SET( ZSTD_LIBRARIES ${ZSTD_LIBRARY} )
+  SET( ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR} )
+ELSE(ZSTD_FOUND)
+  SET( ZSTD_LIBRARIES )
+  SET( ZSTD_INCLUDE_DIRS )
+ENDIF(ZSTD_FOUND)
+
+MARK_AS_ADVANCED( ZSTD_LIBRARIES ZSTD_INCLUDE_DIRS )
@@ -81,11 +81,24 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * The digests of the frames in the window are kept in fd_hash[], which is
+ * used as a ring, and each distinct digest in the window also has a
+ * dup_key_t in dup_table counting the frames that have it; checking a
+ * frame is a single hash table lookup, however large the window is.
  */
+typedef struct _dup_key_t {
+  md5_byte_t digest[16];
+  guint32 len;
+  guint count;          /* frames in the window with this digest and length */
+  nstime_t last_time;   /* arrival time of the latest of them */
+} dup_key_t;
+
 typedef struct _fd_hash_t {
   md5_byte_t digest[16];
   guint32 len;
   nstime_t time;
+  dup_key_t *key;       /* NULL if the entry isn't in the window */
 } fd_hash_t;
 
 #define DEFAULT_DUP_DEPTH 5     /* Used with -d */
@@ -94,6 +107,20 @@ typedef struct _fd_hash_t {
 fd_hash_t fd_hash[MAX_DUP_DEPTH];
 int dup_window = DEFAULT_DUP_DEPTH;
 int cur_dup_entry = 0;
+static int dup_entries = 0;             /* entries of fd_hash[] in the window */
+static GHashTable *dup_table = NULL;    /* dup_key_t's of the window */
+
+/* Byte ranges that are zeroed before a frame's digest is computed (-I) */
+#define MAX_DUP_IGNORE 16
+static struct {
+  guint32 offset;
+  guint32 len;
+} dup_ignore[MAX_DUP_IGNORE];
+static int dup_ignore_count = 0;
+static guint8 *dup_scratch = NULL;      /* frame copy for masking */
+static guint32 dup_scratch_len = 0;
+
+static gboolean dup_fast_hash = FALSE;  /* MurmurHash3 rather than MD5 (-m) */
 
 #define ONE_MILLION 1000000
 #define ONE_BILLION 1000000000
@@ -127,6 +154,7 @@ static int out_file_type = WTAP_FILE_PCAPNG; /* default to pcapng   */
 static int out_file_type = WTAP_FILE_PCAP;   /* default to pcap     */
 #endif
 static int out_frame_type = -2;              /* Leave frame type alone */
+static int out_compression = WTAP_UNCOMPRESSED; /* Don't compress output */
 static int verbose = 0;                      /* Not so verbose         */
 static struct time_adjustment time_adj = {{0, 0}, 0}; /* no adjustment */
 static nstime_t relative_time_window = {0, 0}; /* de-dup time window */
@@ -516,140 +544,290 @@ set_rel_time(char *optarg_str_p)
   relative_time_window.nsecs = val;
 }
 
-static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-  int i;
-  md5_state_t ms;
+/*
+ * MurmurHash3_x64_128, by Austin Appleby, who placed it in the public
+ * domain.  Much faster than MD5, and plenty good enough to tell frames
+ * apart; the digest depends on the host's byte order, which doesn't
+ * matter as digests are only ever compared within one run.
+ */
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
 
-  cur_dup_entry++;
-  if (cur_dup_entry >= dup_window)
-    cur_dup_entry = 0;
+static guint64
+fmix64(guint64 k)
+{
+  k ^= k >> 33;
+  k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+  return k;
+}
 
-  /* Calculate our digest */
-  md5_init(&ms);
-  md5_append(&ms, fd, len);
-  md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+static void
+murmur3_128(const guint8 *data, guint32 len, md5_byte_t digest[16])
+{
+  const guint64 c1 = G_GUINT64_CONSTANT(0x87c37b91114253d5);
+  const guint64 c2 = G_GUINT64_CONSTANT(0x4cf5ad432745937f);
+  const guint8 *tail;
+  guint64 h1 = 0, h2 = 0, k1, k2;
+  guint32 nblocks = len / 16;
+  guint32 i;
+
+  for (i = 0; i < nblocks; i++) {
+    memcpy(&k1, data + i * 16, 8);
+    memcpy(&k2, data + i * 16 + 8, 8);
+
+    k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = ROTL64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+    k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = ROTL64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
 
-  fd_hash[cur_dup_entry].len = len;
+  tail = data + nblocks * 16;
+  k1 = 0;
+  k2 = 0;
+  switch (len & 15) {
+  case 15: k2 ^= (guint64)tail[14] << 48;
+  case 14: k2 ^= (guint64)tail[13] << 40;
+  case 13: k2 ^= (guint64)tail[12] << 32;
+  case 12: k2 ^= (guint64)tail[11] << 24;
+  case 11: k2 ^= (guint64)tail[10] << 16;
+  case 10: k2 ^= (guint64)tail[ 9] << 8;
+  case  9: k2 ^= (guint64)tail[ 8];
+    k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+  case  8: k1 ^= (guint64)tail[ 7] << 56;
+  case  7: k1 ^= (guint64)tail[ 6] << 48;
+  case  6: k1 ^= (guint64)tail[ 5] << 40;
+  case  5: k1 ^= (guint64)tail[ 4] << 32;
+  case  4: k1 ^= (guint64)tail[ 3] << 24;
+  case  3: k1 ^= (guint64)tail[ 2] << 16;
+  case  2: k1 ^= (guint64)tail[ 1] << 8;
+  case  1: k1 ^= (guint64)tail[ 0];
+    k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+  }
 
-  /* Look for duplicates */
-  for (i = 0; i < dup_window; i++) {
-    if (i == cur_dup_entry)
-      continue;
+  h1 ^= len;
+  h2 ^= len;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+
+  memcpy(digest, &h1, 8);
+  memcpy(digest + 8, &h2, 8);
+}
 
-    if (fd_hash[i].len == fd_hash[cur_dup_entry].len &&
-        memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-      return TRUE;
+static void
+add_dup_ignore(const char *optarg)
+{
+  char *p;
+  long offset, len = 1;
+
+  if (dup_ignore_count >= MAX_DUP_IGNORE) {
+    fprintf(stderr, "editcap: too many byte ranges to ignore, max is %d\n",
+            MAX_DUP_IGNORE);
+    exit(1);
+  }
+
+  offset = strtol(optarg, &p, 10);
+  if (p != optarg && *p == ':') {
+    optarg = p + 1;
+    len = strtol(optarg, &p, 10);
+  }
+  if (p == optarg || *p != '\0' || offset < 0 || len <= 0) {
+    fprintf(stderr, "editcap: \"%s\" isn't a valid <offset>[:<length>] to ignore\n",
+            optarg);
+    exit(1);
+  }
+
+  dup_ignore[dup_ignore_count].offset = (guint32) offset;
+  dup_ignore[dup_ignore_count].len = (guint32) len;
+  dup_ignore_count++;
+}
+
+/* Compute the digest of a frame, leaving out the -I byte ranges */
+static void
+compute_digest(const guint8 *fd, guint32 len, md5_byte_t digest[16])
+{
+  md5_state_t ms;
+  int i;
+
+  if (dup_ignore_count > 0) {
+    if (len > dup_scratch_len) {
+      dup_scratch = g_realloc(dup_scratch, len);
+      dup_scratch_len = len;
     }
+    memcpy(dup_scratch, fd, len);
+    for (i = 0; i < dup_ignore_count; i++) {
+      if (dup_ignore[i].offset < len)
+        memset(dup_scratch + dup_ignore[i].offset, 0,
+               MIN(dup_ignore[i].len, len - dup_ignore[i].offset));
+    }
+    fd = dup_scratch;
   }
 
-  return FALSE;
+  if (dup_fast_hash) {
+    murmur3_128(fd, len, digest);
+  } else {
+    md5_init(&ms);
+    md5_append(&ms, fd, len);
+    md5_finish(&ms, digest);
+  }
+}
+
+static guint
+dup_key_hash(gconstpointer k)
+{
+  const dup_key_t *key = (const dup_key_t *)k;
+  guint32 h;
+
+  /* Any four bytes of the digest are as good a hash as any */
+  memcpy(&h, key->digest, sizeof h);
+  return h ^ key->len;
 }
 
 static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
+dup_key_equal(gconstpointer a, gconstpointer b)
+{
+  const dup_key_t *ka = (const dup_key_t *)a;
+  const dup_key_t *kb = (const dup_key_t *)b;
+
+  return ka->len == kb->len && memcmp(ka->digest, kb->digest, 16) == 0;
+}
+
+static void
+dup_init(void)
+{
   int i;
-  md5_state_t ms;
+
+  for (i = 0; i < dup_window; i++) {
+    memset(&fd_hash[i].digest, 0, 16);
+    fd_hash[i].len = 0;
+    nstime_set_unset(&fd_hash[i].time);
+    fd_hash[i].key = NULL;
+  }
+  dup_table = g_hash_table_new(dup_key_hash, dup_key_equal);
+}
+
+/* Take an entry of fd_hash[] out of the window */
+static void
+dup_remove(int entry)
+{
+  dup_key_t *key = fd_hash[entry].key;
+
+  if (key == NULL)
+    return;
+  fd_hash[entry].key = NULL;
+  dup_entries--;
+  if (--key->count == 0) {
+    g_hash_table_remove(dup_table, key);
+    g_slice_free(dup_key_t, key);
+  }
+}
+
+/*
+ * Put the frame into the next entry of fd_hash[], pushing out the
+ * oldest one if the window is full, and compute its digest.  Returns
+ * the dup_key_t of frames in the window with the same digest and length,
+ * if there are any.
+ */
+static dup_key_t *
+dup_next_entry(guint8 *fd, guint32 len, const nstime_t *current)
+{
+  dup_key_t probe;
 
   cur_dup_entry++;
   if (cur_dup_entry >= dup_window)
     cur_dup_entry = 0;
 
-  /* Calculate our digest */
-  md5_init(&ms);
-  md5_append(&ms, fd, len);
-  md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+  dup_remove(cur_dup_entry);
 
+  compute_digest(fd, len, fd_hash[cur_dup_entry].digest);
   fd_hash[cur_dup_entry].len = len;
-  fd_hash[cur_dup_entry].time.secs = current->secs;
-  fd_hash[cur_dup_entry].time.nsecs = current->nsecs;
+  if (current != NULL)
+    fd_hash[cur_dup_entry].time = *current;
 
-  /*
-   * Look for relative time related duplicates.
-   * This is hopefully a reasonably efficient mechanism for
-   * finding duplicates by rel time in the fd_hash[] cache.
-   * We check starting from the most recently added hash
-   * entries and work backwards towards older packets.
-   * This approach allows the dup test to be terminated
-   * when the relative time of a cached entry is found to
-   * be beyond the dup time window.
-   *
-   * Of course this assumes that the input trace file is
-   * "well-formed" in the sense that the packet timestamps are
-   * in strict chronologically increasing order (which is NOT
-   * always the case!!).
-   *
-   * The fd_hash[] table was deliberatly created large (1,000,000).
-   * Looking for time related duplicates in large trace files with
-   * non-fractional dup time window values can potentially take
-   * a long time to complete.
-   */
+  memcpy(probe.digest, fd_hash[cur_dup_entry].digest, 16);
+  probe.len = len;
+  return (dup_key_t *)g_hash_table_lookup(dup_table, &probe);
+}
 
-  for (i = cur_dup_entry - 1;; i--) {
-    nstime_t delta;
-    int cmp;
+/* Make the current entry of fd_hash[] part of the window */
+static void
+dup_add_entry(dup_key_t *key)
+{
+  fd_hash_t *entry = &fd_hash[cur_dup_entry];
 
-    if (i < 0) {
-      i = dup_window - 1;
-    }
+  if (dup_window <= 1)
+    return;     /* nothing to compare later frames with */
 
-    if (i == cur_dup_entry) {
-      /*
-       * We've decremented back to where we started.
-       * Check no more!
-       */
-      break;
-    }
+  if (key == NULL) {
+    key = g_slice_new(dup_key_t);
+    memcpy(key->digest, entry->digest, 16);
+    key->len = entry->len;
+    key->count = 0;
+    g_hash_table_insert(dup_table, key, key);
+  }
+  key->count++;
+  key->last_time = entry->time;
+  entry->key = key;
+  dup_entries++;
+}
 
-    if (nstime_is_unset(&(fd_hash[i].time))) {
-      /*
-       * We've decremented to an unused fd_hash[] entry.
-       * Check no more!
-       */
-      break;
-    }
+static gboolean
+is_duplicate(guint8* fd, guint32 len) {
+  dup_key_t *key;
 
-    nstime_delta(&delta, current, &fd_hash[i].time);
+  key = dup_next_entry(fd, len, NULL);
+  dup_add_entry(key);
 
-    if(delta.secs < 0 || delta.nsecs < 0)
-    {
-      /*
-       * A negative delta implies that the current packet
-       * has an absolute timestamp less than the cached packet
-       * that it is being compared to.  This is NOT a normal
-       * situation since trace files usually have packets in
-       * chronological order (oldest to newest).
-       *
-       * There are several possible ways to deal with this:
-       * 1. 'continue' dup checking with the next cached frame.
-       * 2. 'break' from looking for a duplicate of the current frame.
-       * 3. Take the absolute value of the delta and see if that
-       * falls within the specifed dup time window.
-       *
-       * Currently this code does option 1.  But it would pretty
-       * easy to add yet-another-editcap-option to select one of
-       * the other behaviors for dealing with out-of-sequence
-       * packets.
-       */
-      continue;
-    }
+  return key != NULL;
+}
 
-    cmp = nstime_cmp(&delta, &relative_time_window);
+static gboolean
+is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
+  dup_key_t *key;
+  nstime_t delta;
+  int oldest;
+  gboolean dup = FALSE;
 
-    if(cmp > 0) {
-      /*
-       * The delta time indicates that we are now looking at
-       * cached packets beyond the specified dup time window.
-       * Check no more!
-       */
+  /*
+   * Drop the frames that have fallen out of the time window, oldest
+   * first.  This assumes that the input trace file is "well-formed" in
+   * the sense that the packet timestamps are in strict chronologically
+   * increasing order (which is NOT always the case!!); a frame with a
+   * later timestamp than the current one stays in the window.
+   */
+  while (dup_entries > 0) {
+    oldest = cur_dup_entry - dup_entries + 1;
+    if (oldest < 0)
+      oldest += dup_window;
+    nstime_delta(&delta, current, &fd_hash[oldest].time);
+    if (delta.secs < 0 || delta.nsecs < 0 ||
+        nstime_cmp(&delta, &relative_time_window) <= 0)
       break;
-    } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len &&
-          memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-      return TRUE;
-    }
+    dup_remove(oldest);
   }
 
-  return FALSE;
+  key = dup_next_entry(fd, len, current);
+
+  if (key != NULL) {
+    /*
+     * The latest frame with the same digest is the closest one in time.
+     * If the current frame's timestamp is less than its, it's out of
+     * order, which isn't counted as a duplicate.
+     */
+    nstime_delta(&delta, current, &key->last_time);
+    dup = !(delta.secs < 0 || delta.nsecs < 0) &&
+          nstime_cmp(&delta, &relative_time_window) <= 0;
+  }
+
+  dup_add_entry(key);
+
+  return dup;
 }
 
 static void
@@ -692,6 +870,12 @@ usage(gboolean is_error)
   fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
   fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
   fprintf(output, "                         (e.g. 0.000001).\n");
+  fprintf(output, "  -I <offset>[:<len>]    ignore <len> (default 1) bytes at <offset> of each\n");
+  fprintf(output, "                         packet when looking for duplicates, e.g. the IP TTL\n");
+  fprintf(output, "                         and checksum (-I 22 -I 24:2 for IPv4 over Ethernet).\n");
+  fprintf(output, "                         May be given up to %d times.\n", MAX_DUP_IGNORE);
+  fprintf(output, "  -m                     use a faster, non-cryptographic 128-bit hash\n");
+  fprintf(output, "                         (MurmurHash3) instead of MD5 for duplicates.\n");
   fprintf(output, "\n");
   fprintf(output, "           NOTE: The use of the 'Duplicate packet removal' options with\n");
   fprintf(output, "           other editcap options except -v may not always work as expected.\n");
@@ -728,13 +912,15 @@ usage(gboolean is_error)
   fprintf(output, "  -T <encap type>        set the output file encapsulation type;\n");
   fprintf(output, "                         default is the same as the input file.\n");
   fprintf(output, "                         an empty \"-T\" option will list the encapsulation types.\n");
+  fprintf(output, "  -z <compression type>  compress the output file; \"gzip\" or \"zstd\".\n");
+  fprintf(output, "                         both can be read back with random access.\n");
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                     display this help and exit.\n");
   fprintf(output, "  -v                     verbose output.\n");
   fprintf(output, "                         If -v is used with any of the 'Duplicate Packet\n");
   fprintf(output, "                         Removal' options (-d, -D or -w) then Packet lengths\n");
-  fprintf(output, "                         and MD5 hashes are printed to standard-out.\n");
+  fprintf(output, "                         and MD5 (or -m) hashes are printed to standard-out.\n");
   fprintf(output, "\n");
 }
 
@@ -869,7 +1055,7 @@ main(int argc, char *argv[])
 #endif
 
   /* Process the options */
-  while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hrs:i:t:S:T:vw:")) !=-1) {
+  while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hI:mrs:i:t:S:T:vw:z:")) !=-1) {
 
     switch (opt) {
 
@@ -938,6 +1124,14 @@ main(int argc, char *argv[])
       }
       break;
 
+    case 'I':
+      add_dup_ignore(optarg);
+      break;
+
+    case 'm':
+      dup_fast_hash = TRUE;
+      break;
+
     case 'w':
       dup_detect = FALSE;
       dup_detect_by_time = TRUE;
@@ -945,6 +1139,15 @@ main(int argc, char *argv[])
       set_rel_time(optarg);
       break;
 
+    case 'z':
+      out_compression = wtap_short_string_to_compression_type(optarg);
+      if (out_compression < 0) {
+        fprintf(stderr, "editcap: \"%s\" isn't a supported compression type\n",
+            optarg);
+        exit(1);
+      }
+      break;
+
     case '?':              /* Bad options if GNU getopt */
       switch(optopt) {
       case'F':
@@ -1120,13 +1323,8 @@ main(int argc, char *argv[])
       if (add_selection(argv[i]) == FALSE)
         break;
 
-    if (dup_detect || dup_detect_by_time) {
-      for (i = 0; i < dup_window; i++) {
-        memset(&fd_hash[i].digest, 0, 16);
-        fd_hash[i].len = 0;
-        nstime_set_unset(&fd_hash[i].time);
-      }
-    }
+    if (dup_detect || dup_detect_by_time)
+      dup_init();
 
     while (wtap_read(wth, &err, &err_info, &data_offset)) {
       read_count++;
@@ -1154,7 +1352,7 @@ main(int argc, char *argv[])
 
         pdh = wtap_dump_open_ng(filename, out_file_type, out_frame_type,
           snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-          FALSE /* compressed */, shb_hdr, idb_inf, &err);
+          out_compression, shb_hdr, idb_inf, &err);
 
         if (pdh == NULL) {
           fprintf(stderr, "editcap: Can't open or create %s: %s\n", filename,
@@ -1186,7 +1384,7 @@ main(int argc, char *argv[])
 
           pdh = wtap_dump_open_ng(filename, out_file_type, out_frame_type,
             snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-            FALSE /* compressed */, shb_hdr, idb_inf, &err);
+            out_compression, shb_hdr, idb_inf, &err);
 
           if (pdh == NULL) {
             fprintf(stderr, "editcap: Can't open or create %s: %s\n", filename,
@@ -1217,7 +1415,7 @@ main(int argc, char *argv[])
 
           pdh = wtap_dump_open_ng(filename, out_file_type, out_frame_type,
             snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-            FALSE /* compressed */, shb_hdr, idb_inf, &err);
+            out_compression, shb_hdr, idb_inf, &err);
           if (pdh == NULL) {
             fprintf(stderr, "editcap: Can't open or create %s: %s\n", filename,
                 wtap_strerror(err));
@@ -1359,7 +1557,8 @@ main(int argc, char *argv[])
         if (dup_detect) {
           if (is_duplicate(buf, phdr->caplen)) {
             if (verbose) {
-              fprintf(stdout, "Skipped: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Skipped: %u, Len: %u, %s Hash: ", count, phdr->caplen,
+                      dup_fast_hash ? "Murmur3" : "MD5");
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -1370,7 +1569,8 @@ main(int argc, char *argv[])
             continue;
           } else {
             if (verbose) {
-              fprintf(stdout, "Packet: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Packet: %u, Len: %u, %s Hash: ", count, phdr->caplen,
+                      dup_fast_hash ? "Murmur3" : "MD5");
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -1388,7 +1588,8 @@ main(int argc, char *argv[])
 
           if (is_duplicate_rel_time(buf, phdr->caplen, &current)) {
             if (verbose) {
-              fprintf(stdout, "Skipped: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Skipped: %u, Len: %u, %s Hash: ", count, phdr->caplen,
+                      dup_fast_hash ? "Murmur3" : "MD5");
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -1399,7 +1600,8 @@ main(int argc, char *argv[])
             continue;
           } else {
             if (verbose) {
-              fprintf(stdout, "Packet: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Packet: %u, Len: %u, %s Hash: ", count, phdr->caplen,
+                      dup_fast_hash ? "Murmur3" : "MD5");
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -1509,7 +1711,7 @@ main(int argc, char *argv[])
 
       pdh = wtap_dump_open_ng(filename, out_file_type, out_frame_type,
         snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
-        FALSE /* compressed */, shb_hdr, idb_inf, &err);
+        out_compression, shb_hdr, idb_inf, &err);
       if (pdh == NULL) {
         fprintf(stderr, "editcap: Can't open or create %s: %s\n", filename,
         wtap_strerror(err));
@@ -0,0 +1,183 @@
+/* Standalone program to test the Internet checksum and CRC-32 routines
+ * against simple bit-at-a-time reference implementations.
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <config.h>
+
+#include "in_cksum.h"
+#include <wsutil/crc32.h>
+
+/* Large enough for a jumbo frame, plus room to move the start around */
+#define BUF_LEN	(9000+8)
+
+gboolean failed = FALSE;
+
+static guint8 buf[BUF_LEN];
+
+/* RFC 1071 checksum, in network byte order */
+static guint16
+ref_cksum(const guint8 *p, int len)
+{
+	guint32 sum = 0;
+	int i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		sum += (p[i] << 8) | p[i+1];
+	if (len & 1)
+		sum += p[len-1] << 8;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum & 0xffff;
+}
+
+/* Bit-reflected CRC-32, without the final complement */
+static guint32
+ref_crc32_reflected(guint32 poly, const guint8 *p, int len, guint32 crc)
+{
+	int i, bit;
+
+	for (i = 0; i < len; i++) {
+		crc ^= p[i];
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+	}
+	return crc;
+}
+
+/* Lengths around the unrolled loops' block sizes, and some frame sizes */
+static const int lengths[] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 15, 16, 17, 31, 32, 33, 34, 35, 36,
+	63, 64, 65, 127, 128, 129, 1499, 1500, 1514, 1518, 4096, 9000
+};
+
+static void
+test_in_cksum(void)
+{
+	vec_t cksum_vec[3];
+	guint16 expected, computed;
+	int len, offset, split1, split2;
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(lengths); i++) {
+		len = lengths[i];
+		for (offset = 0; offset < 8; offset++) {
+			expected = g_htons(ref_cksum(buf + offset, len));
+
+			cksum_vec[0].ptr = buf + offset;
+			cksum_vec[0].len = len;
+			computed = in_cksum(cksum_vec, 1);
+			if (computed != expected) {
+				printf("in_cksum: length %d offset %d: 0x%04x, expected 0x%04x\n",
+				    len, offset, computed, expected);
+				failed = TRUE;
+			}
+
+			/* Split into three pieces, at odd and even places */
+			for (split1 = 0; split1 <= len && split1 < 12; split1++) {
+				split2 = split1 + (len - split1) / 2 + (split1 & 1);
+				if (split2 > len)
+					split2 = len;
+				cksum_vec[0].ptr = buf + offset;
+				cksum_vec[0].len = split1;
+				cksum_vec[1].ptr = buf + offset + split1;
+				cksum_vec[1].len = split2 - split1;
+				cksum_vec[2].ptr = buf + offset + split2;
+				cksum_vec[2].len = len - split2;
+				computed = in_cksum(cksum_vec, 3);
+				if (computed != expected) {
+					printf("in_cksum: length %d offset %d split %d/%d: 0x%04x, expected 0x%04x\n",
+					    len, offset, split1, split2, computed, expected);
+					failed = TRUE;
+				}
+			}
+		}
+	}
+}
+
+static void
+test_crc32(void)
+{
+	static const guint32 seeds[] = { 0xffffffff, 0, 0x12345678 };
+	guint32 expected, computed;
+	int len, offset;
+	unsigned int i, j;
+
+	for (i = 0; i < G_N_ELEMENTS(lengths); i++) {
+		len = lengths[i];
+		for (offset = 0; offset < 8; offset++) {
+			for (j = 0; j < G_N_ELEMENTS(seeds); j++) {
+				expected = ref_crc32_reflected(0x82F63B78, buf + offset, len, seeds[j]);
+				computed = crc32c_calculate_no_swap(buf + offset, len, seeds[j]);
+				if (computed != expected) {
+					printf("crc32c_calculate_no_swap: length %d offset %d seed 0x%08x: 0x%08x, expected 0x%08x\n",
+					    len, offset, seeds[j], computed, expected);
+					failed = TRUE;
+				}
+				computed = crc32c_calculate(buf + offset, len, CRC32C_SWAP(seeds[j]));
+				if (computed != CRC32C_SWAP(expected)) {
+					printf("crc32c_calculate: length %d offset %d seed 0x%08x: 0x%08x, expected 0x%08x\n",
+					    len, offset, seeds[j], computed, CRC32C_SWAP(expected));
+					failed = TRUE;
+				}
+
+				expected = ~ref_crc32_reflected(0xEDB88320, buf + offset, len, seeds[j]);
+				computed = crc32_ccitt_seed(buf + offset, len, seeds[j]);
+				if (computed != expected) {
+					printf("crc32_ccitt_seed: length %d offset %d seed 0x%08x: 0x%08x, expected 0x%08x\n",
+					    len, offset, seeds[j], computed, expected);
+					failed = TRUE;
+				}
+			}
+		}
+	}
+
+	/* Check values: the CRCs of "123456789" */
+	if (crc32c_calculate_no_swap("123456789", 9, CRC32C_PRELOAD) != ~0xE3069283) {
+		printf("crc32c_calculate_no_swap: wrong check value\n");
+		failed = TRUE;
+	}
+	if (crc32_ccitt((const guint8 *)"123456789", 9) != 0xCBF43926) {
+		printf("crc32_ccitt: wrong check value\n");
+		failed = TRUE;
+	}
+}
+
+int main(void)
+{
+	int i;
+
+	/* Anything but zeros, with some runs of 0xff to exercise carries */
+	srand(1);
+	for (i = 0; i < BUF_LEN; i++)
+		buf[i] = (i % 97) < 40 ? 0xff : rand() & 0xff;
+
+	test_in_cksum();
+	test_crc32();
+
+	if (failed == FALSE)
+		printf("success\n");
+	exit(failed?1:0);
+}
@@ -65,6 +65,8 @@ col_setup(column_info *cinfo, const gint num_cols)
   cinfo->col_data   = (const gchar **)g_new(gchar*, num_cols);
   cinfo->col_buf    = g_new(gchar*, num_cols);
   cinfo->col_fence  = g_new(int, num_cols);
+  cinfo->col_skip   = g_new0(gboolean, num_cols);
+  cinfo->fmt_skip   = g_new0(gboolean, NUM_COL_FMTS);
   cinfo->col_expr.col_expr = (const gchar **) g_new(gchar*, num_cols + 1);
   cinfo->col_expr.col_expr_val = g_new(gchar*, num_cols + 1);
 
@@ -113,7 +115,13 @@ col_set_writable(column_info *cinfo, const gboolean writable)
     /* We are constructing columns, and they're writable */ \
     (COL_GET_WRITABLE(cinfo) && \
       /* There is at least one column in that format */ \
-    ((cinfo)->col_first[el] >= 0))
+    ((cinfo)->col_first[el] >= 0) && \
+      /* and the current consumer wants at least one of them */ \
+    !(cinfo)->fmt_skip[el])
+
+/* Checks to see if column i, which is in the range for el, should be written */
+#define COL_WANTED(cinfo, i, el) \
+    ((cinfo)->fmt_matx[i][el] && !(cinfo)->col_skip[i])
 
 gint
 check_col(column_info *cinfo, const gint el)
@@ -121,6 +129,33 @@ check_col(column_info *cinfo, const gint el)
   return CHECK_COL(cinfo, el);
 }
 
+/* Records which columns the current consumer is going to look at.  The
+   others are left empty, and col_*() calls that would only touch them
+   return before formatting anything. */
+void
+col_set_needed(column_info *cinfo, const gboolean *needed)
+{
+  int i, j;
+
+  if (!cinfo)
+    return;
+
+  for (i = 0; i < cinfo->num_cols; i++)
+    cinfo->col_skip[i] = needed ? !needed[i] : FALSE;
+
+  for (j = 0; j < NUM_COL_FMTS; j++) {
+    cinfo->fmt_skip[j] = TRUE;
+    if (cinfo->col_first[j] < 0)
+      continue;
+    for (i = cinfo->col_first[j]; i <= cinfo->col_last[j]; i++) {
+      if (COL_WANTED(cinfo, i, j)) {
+        cinfo->fmt_skip[j] = FALSE;
+        break;
+      }
+    }
+  }
+}
+
 /* Sets the fence for a column to be at the end of the column. */
 void
 col_set_fence(column_info *cinfo, const gint el)
@@ -131,7 +166,7 @@ col_set_fence(column_info *cinfo, const gint el)
     return;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       cinfo->col_fence[i] = (int)strlen(cinfo->col_data[i]);
     }
   }
@@ -153,7 +188,7 @@ col_clear(column_info *cinfo, const gint el)
     return;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       /*
        * At this point, either
        *
@@ -200,7 +235,8 @@ col_clear(column_info *cinfo, const gint el)
   }
 
 /* The same as CHECK_COL(), but without the check to see if the column is writable. */
-#define HAVE_CUSTOM_COLS(cinfo) ((cinfo) && (cinfo)->col_first[COL_CUSTOM] >= 0)
+#define HAVE_CUSTOM_COLS(cinfo) ((cinfo) && (cinfo)->col_first[COL_CUSTOM] >= 0 && \
+                                 !(cinfo)->fmt_skip[COL_CUSTOM])
 
 gboolean
 have_custom_cols(column_info *cinfo)
@@ -218,7 +254,7 @@ void col_custom_set_edt(epan_dissect_t *edt, column_info *cinfo)
 
   for (i = cinfo->col_first[COL_CUSTOM];
        i <= cinfo->col_last[COL_CUSTOM]; i++) {
-    if (cinfo->fmt_matx[i][COL_CUSTOM] &&
+    if (COL_WANTED(cinfo, i, COL_CUSTOM) &&
         cinfo->col_custom_field[i] &&
         cinfo->col_custom_field_id[i] != -1) {
        cinfo->col_data[i] = cinfo->col_buf[i];
@@ -243,7 +279,7 @@ col_custom_prime_edt(epan_dissect_t *edt, column_info *cinfo)
        i <= cinfo->col_last[COL_CUSTOM]; i++) {
 
     cinfo->col_custom_field_id[i] = -1;
-    if (cinfo->fmt_matx[i][COL_CUSTOM] &&
+    if (COL_WANTED(cinfo, i, COL_CUSTOM) &&
         cinfo->col_custom_dfilter[i]){
         epan_dissect_prime_dfilter(edt, cinfo->col_custom_dfilter[i]);
         if (cinfo->col_custom_field) {
@@ -275,7 +311,7 @@ col_append_fstr(column_info *cinfo, const gint el, const gchar *format, ...)
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       /*
        * First arrange that we can append, if necessary.
        */
@@ -317,7 +353,7 @@ col_append_sep_fstr(column_info *cinfo, const gint el, const gchar *separator,
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       /*
        * First arrange that we can append, if necessary.
        */
@@ -362,7 +398,7 @@ col_prepend_fstr(column_info *cinfo, const gint el, const gchar *format, ...)
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       if (cinfo->col_data[i] != cinfo->col_buf[i]) {
         /* This was set with "col_set_str()"; which is effectively const */
         orig = cinfo->col_data[i];
@@ -403,7 +439,7 @@ col_prepend_fence_fstr(column_info *cinfo, const gint el, const gchar *format, .
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       if (cinfo->col_data[i] != cinfo->col_buf[i]) {
         /* This was set with "col_set_str()"; which is effectively const */
         orig = cinfo->col_data[i];
@@ -448,7 +484,7 @@ col_add_str(column_info *cinfo, const gint el, const gchar* str)
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       fence = cinfo->col_fence[i];
       if (fence != 0) {
         /*
@@ -491,7 +527,7 @@ col_set_str(column_info *cinfo, const gint el, const gchar* str)
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       fence = cinfo->col_fence[i];
       if (fence != 0) {
         /*
@@ -529,7 +565,7 @@ col_add_fstr(column_info *cinfo, const gint el, const gchar *format, ...) {
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       fence = cinfo->col_fence[i];
       if (fence != 0) {
         /*
@@ -563,7 +599,7 @@ col_do_append_str(column_info *cinfo, const gint el, const gchar* separator,
     max_len = COL_MAX_LEN;
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
-    if (cinfo->fmt_matx[i][el]) {
+    if (COL_WANTED(cinfo, i, el)) {
       /*
        * First arrange that we can append, if necessary.
        */
@@ -1331,7 +1367,7 @@ col_set_time(column_info *cinfo, const gint el, const nstime_t *ts, char *fieldn
   */
 
   for (col = cinfo->col_first[el]; col <= cinfo->col_last[el]; col++) {
-    if (cinfo->fmt_matx[col][el]) {
+    if (COL_WANTED(cinfo, col, el)) {
       switch(timestamp_get_precision()) {
     case TS_PREC_FIXED_SEC:
     case TS_PREC_AUTO_SEC:
@@ -1636,6 +1672,9 @@ col_fill_in(packet_info *pinfo, const gboolean fill_col_exprs, const gboolean fi
     return;
 
   for (i = 0; i < pinfo->cinfo->num_cols; i++) {
+    if (pinfo->cinfo->col_skip[i])
+      continue;
+
     switch (pinfo->cinfo->col_fmt[i]) {
 
     case COL_NUMBER:
@@ -72,6 +72,17 @@ extern void	col_fill_in(packet_info *pinfo, const gboolean fill_col_exprs, const
  */
 extern void	col_fill_in_error(column_info *cinfo, frame_data *fdata, const gboolean fill_col_exprs, const gboolean fill_fd_colums);
 
+/** Declare which columns the caller is going to read back for this pass.
+ *  Columns that aren't needed are left empty, and col_xxx() calls that
+ *  would only touch them return without formatting anything.
+ *
+ * Internal, don't use this in dissectors!
+ *
+ * @param cinfo the current packet row
+ * @param needed array of num_cols flags, or NULL if all columns are needed
+ */
+extern void	col_set_needed(column_info *cinfo, const gboolean *needed);
+
 /* Utility routines used by packet*.c */
 
 /** Are the columns writable?
@@ -59,6 +59,8 @@ typedef struct _column_info {
   const gchar       **col_data;             /**< Column data */
   gchar             **col_buf;              /**< Buffer into which to copy data for column */
   int                *col_fence;            /**< Stuff in column buffer before this index is immutable */
+  gboolean           *col_skip;             /**< Column isn't wanted by the current consumer */
+  gboolean           *fmt_skip;             /**< No wanted column has a given format */
   col_expr_t          col_expr;             /**< Column expressions and values */
   gboolean            writable;             /**< writable or not @todo Are we still writing to the columns? */
   gboolean            columns_changed;      /**< Have the columns been changed in the prefs? */
@@ -218,19 +218,55 @@ static INT AirPDcapRsnaMicCheck(
  * @param id [IN] id of the association (composed by BSSID and MAC of
  * the station)
  * @return
- * - index of the Security Association structure if found
- * - -1, if the specified addresses pair BSSID-STA MAC has not been found
+ * - pointer to the Security Association structure if found
+ * - NULL, if the specified addresses pair BSSID-STA MAC has not been found
  */
-static INT AirPDcapGetSa(
+static PAIRPDCAP_SEC_ASSOCIATION AirPDcapGetSa(
     PAIRPDCAP_CONTEXT ctx,
     AIRPDCAP_SEC_ASSOCIATION_ID *id)
     ;
 
-static INT AirPDcapStoreSa(
+static PAIRPDCAP_SEC_ASSOCIATION AirPDcapStoreSa(
     PAIRPDCAP_CONTEXT ctx,
     AIRPDCAP_SEC_ASSOCIATION_ID *id)
     ;
 
+static guint AirPDcapSaHash(
+    gconstpointer key)
+    ;
+
+static gboolean AirPDcapSaEqual(
+    gconstpointer a,
+    gconstpointer b)
+    ;
+
+static guint AirPDcapPwdKeyHash(
+    gconstpointer key)
+    ;
+
+static gboolean AirPDcapPwdKeyEqual(
+    gconstpointer a,
+    gconstpointer b)
+    ;
+
+/**
+ * It returns a WPA passphrase key for the specified SSID with its PSK
+ * calculated, running the PBKDF2 derivation only the first time the
+ * passphrase-SSID pair is seen.
+ * @param ctx [IN] pointer to the current context
+ * @param key [IN] pointer to a WPA passphrase key
+ * @param ssid [IN] pointer to the SSID to use instead of the key's one
+ * @param ssidLength [IN] length of the SSID
+ * @return pointer to a key owned by the context, valid until the
+ * context is destroyed
+ */
+static PAIRPDCAP_KEY_ITEM AirPDcapGetPwdKey(
+    PAIRPDCAP_CONTEXT ctx,
+    const AIRPDCAP_KEY_ITEM *key,
+    const CHAR *ssid,
+    const size_t ssidLength)
+    ;
+
 static const UCHAR * AirPDcapGetStaAddress(
     const AIRPDCAP_MAC_FRAME_ADDR4 *frame)
     ;
@@ -445,17 +481,14 @@ AirPDcapGetSaPtr(
     PAIRPDCAP_CONTEXT ctx,
     AIRPDCAP_SEC_ASSOCIATION_ID *id)
 {
-    int sa_index;
+    PAIRPDCAP_SEC_ASSOCIATION sa;
 
     /* search for a cached Security Association for supplied BSSID and STA MAC  */
-    if ((sa_index=AirPDcapGetSa(ctx, id))==-1) {
+    if ((sa=AirPDcapGetSa(ctx, id))==NULL) {
         /* create a new Security Association if it doesn't currently exist      */
-        if ((sa_index=AirPDcapStoreSa(ctx, id))==-1) {
-            return NULL;
-        }
+        sa=AirPDcapStoreSa(ctx, id);
     }
-    /* get the Security Association structure   */
-    return &ctx->sa[sa_index];
+    return sa;
 }
 
 #define GROUP_KEY_PAYLOAD_LEN (8+4+sizeof(EAPOL_RSN_KEY))
@@ -833,7 +866,9 @@ INT AirPDcapSetKeys(
         if (AirPDcapValidateKey(keys+i)==TRUE) {
             if (keys[i].KeyType==AIRPDCAP_KEY_TYPE_WPA_PWD) {
                 AIRPDCAP_DEBUG_PRINT_LINE("AirPDcapSetKeys", "Set a WPA-PWD key", AIRPDCAP_DEBUG_LEVEL_4);
-                AirPDcapRsnaPwd2Psk(keys[i].UserPwd.Passphrase, keys[i].UserPwd.Ssid, keys[i].UserPwd.SsidLen, keys[i].KeyData.Wpa.Psk);
+                memcpy(keys[i].KeyData.Wpa.Psk,
+                    AirPDcapGetPwdKey(ctx, &keys[i], keys[i].UserPwd.Ssid, keys[i].UserPwd.SsidLen)->KeyData.Wpa.Psk,
+                    AIRPDCAP_WPA_PSK_LEN);
             }
 #ifdef _DEBUG
             else if (keys[i].KeyType==AIRPDCAP_KEY_TYPE_WPA_PMK) {
@@ -937,12 +972,15 @@ INT AirPDcapInitContext(
 
     AirPDcapCleanKeys(ctx);
 
-    ctx->first_free_index=0;
-    ctx->index=-1;
-    ctx->sa_index=-1;
     ctx->pkt_ssid_len = 0;
 
-    memset(ctx->sa, 0, AIRPDCAP_MAX_SEC_ASSOCIATIONS_NR * sizeof(AIRPDCAP_SEC_ASSOCIATION));
+    if (ctx->sa_hash)
+        g_hash_table_remove_all(ctx->sa_hash);
+    else
+        ctx->sa_hash=g_hash_table_new_full(AirPDcapSaHash, AirPDcapSaEqual, NULL, g_free);
+
+    if (ctx->pmk_cache==NULL)
+        ctx->pmk_cache=g_hash_table_new_full(AirPDcapPwdKeyHash, AirPDcapPwdKeyEqual, g_free, NULL);
 
     AIRPDCAP_DEBUG_PRINT_LINE("AirPDcapInitContext", "Context initialized!", AIRPDCAP_DEBUG_LEVEL_5);
     AIRPDCAP_DEBUG_TRACE_END("AirPDcapInitContext");
@@ -962,9 +1000,14 @@ INT AirPDcapDestroyContext(
 
     AirPDcapCleanKeys(ctx);
 
-    ctx->first_free_index=0;
-    ctx->index=-1;
-    ctx->sa_index=-1;
+    if (ctx->sa_hash) {
+        g_hash_table_destroy(ctx->sa_hash);
+        ctx->sa_hash=NULL;
+    }
+    if (ctx->pmk_cache) {
+        g_hash_table_destroy(ctx->pmk_cache);
+        ctx->pmk_cache=NULL;
+    }
 
     AIRPDCAP_DEBUG_PRINT_LINE("AirPDcapDestroyContext", "Context destroyed!", AIRPDCAP_DEBUG_LEVEL_5);
     AIRPDCAP_DEBUG_TRACE_END("AirPDcapDestroyContext");
@@ -1198,7 +1241,7 @@ AirPDcapRsna4WHandshake(
     PAIRPDCAP_KEY_ITEM key,
     INT offset)
 {
-    AIRPDCAP_KEY_ITEM *tmp_key, pkt_key;
+    AIRPDCAP_KEY_ITEM *tmp_key;
     AIRPDCAP_SEC_ASSOCIATION *tmp_sa;
     INT key_index;
     INT ret_value=1;
@@ -1302,12 +1345,7 @@ AirPDcapRsna4WHandshake(
                     {
                         if (tmp_key->KeyType == AIRPDCAP_KEY_TYPE_WPA_PWD && tmp_key->UserPwd.SsidLen == 0 && ctx->pkt_ssid_len > 0 && ctx->pkt_ssid_len <= AIRPDCAP_WPA_SSID_MAX_LEN) {
                             /* We have a "wildcard" SSID.  Use the one from the packet. */
-                            memcpy(&pkt_key, tmp_key, sizeof(pkt_key));
-                            memcpy(&pkt_key.UserPwd.Ssid, ctx->pkt_ssid, ctx->pkt_ssid_len);
-                             pkt_key.UserPwd.SsidLen = ctx->pkt_ssid_len;
-                            AirPDcapRsnaPwd2Psk(pkt_key.UserPwd.Passphrase, pkt_key.UserPwd.Ssid,
-                                pkt_key.UserPwd.SsidLen, pkt_key.KeyData.Wpa.Psk);
-                            tmp_key = &pkt_key;
+                            tmp_key = AirPDcapGetPwdKey(ctx, tmp_key, ctx->pkt_ssid, ctx->pkt_ssid_len);
                         }
 
                         /* derive the PTK from the BSSID, STA MAC, PMK, SNonce, ANonce */
@@ -1543,72 +1581,114 @@ AirPDcapValidateKey(
     return ret;
 }
 
-static INT
+static guint
+AirPDcapSaHash(
+    gconstpointer key)
+{
+    const AIRPDCAP_SEC_ASSOCIATION_ID *id=(const AIRPDCAP_SEC_ASSOCIATION_ID *)key;
+    guint hash=0;
+    INT i;
+
+    for (i=0; i<AIRPDCAP_MAC_LEN; i++)
+        hash=hash*31+id->bssid[i];
+    for (i=0; i<AIRPDCAP_MAC_LEN; i++)
+        hash=hash*31+id->sta[i];
+
+    return hash;
+}
+
+static gboolean
+AirPDcapSaEqual(
+    gconstpointer a,
+    gconstpointer b)
+{
+    return memcmp(a, b, sizeof(AIRPDCAP_SEC_ASSOCIATION_ID))==0;
+}
+
+static PAIRPDCAP_SEC_ASSOCIATION
 AirPDcapGetSa(
     PAIRPDCAP_CONTEXT ctx,
     AIRPDCAP_SEC_ASSOCIATION_ID *id)
 {
-    INT sa_index;
-
-    if (ctx->sa_index!=-1) {
-        /* at least one association was stored                               */
-        /* search for the association from sa_index to 0 (most recent added) */
-        for (sa_index=ctx->sa_index; sa_index>=0; sa_index--) {
-            if (ctx->sa[sa_index].used) {
-                if (memcmp(id, &(ctx->sa[sa_index].saId), sizeof(AIRPDCAP_SEC_ASSOCIATION_ID))==0) {
-                    ctx->index=sa_index;
-                    return sa_index;
-                }
-            }
-        }
-    }
+    if (ctx->sa_hash==NULL)
+        return NULL;
 
-    return -1;
+    return (PAIRPDCAP_SEC_ASSOCIATION)g_hash_table_lookup(ctx->sa_hash, id);
 }
 
-static INT
+static PAIRPDCAP_SEC_ASSOCIATION
 AirPDcapStoreSa(
     PAIRPDCAP_CONTEXT ctx,
     AIRPDCAP_SEC_ASSOCIATION_ID *id)
 {
-    INT last_free;
-
-    if (ctx->sa[ctx->first_free_index].used) {
-        /* last addition was in the middle of the array (and the first_free_index was just incremented by 1)   */
-        /* search for a free space from the first_free_index to AIRPDCAP_STA_INFOS_NR (to avoid free blocks in */
-        /*              the middle)                                                                            */
-        for (last_free=ctx->first_free_index; last_free<AIRPDCAP_MAX_SEC_ASSOCIATIONS_NR; last_free++)
-            if (!ctx->sa[last_free].used)
-                break;
-
-        if (last_free>=AIRPDCAP_MAX_SEC_ASSOCIATIONS_NR) {
-            /* there is no empty space available. FAILURE */
-            return -1;
-        }
+    PAIRPDCAP_SEC_ASSOCIATION sa;
 
-        /* store first free space index */
-        ctx->first_free_index=last_free;
+    if (ctx->sa_hash==NULL) {
+        /* the context has not been initialized. FAILURE */
+        return NULL;
     }
 
-    /* use this info */
-    ctx->index=ctx->first_free_index;
+    sa=g_new0(AIRPDCAP_SEC_ASSOCIATION, 1);
+
+    /* set the info structure; the ID is also the hash table key */
+    memcpy(&(sa->saId), id, sizeof(AIRPDCAP_SEC_ASSOCIATION_ID));
+    g_hash_table_insert(ctx->sa_hash, &(sa->saId), sa);
+
+    return sa;
+}
+
+static guint
+AirPDcapPwdKeyHash(
+    gconstpointer key)
+{
+    const AIRPDCAP_KEY_ITEM *pwd_key=(const AIRPDCAP_KEY_ITEM *)key;
+    guint hash;
+    size_t i;
 
-    /* reset the info structure */
-    memset(ctx->sa+ctx->index, 0, sizeof(AIRPDCAP_SEC_ASSOCIATION));
+    hash=g_str_hash(pwd_key->UserPwd.Passphrase);
+    for (i=0; i<pwd_key->UserPwd.SsidLen; i++)
+        hash=hash*31+(UCHAR)pwd_key->UserPwd.Ssid[i];
 
-    ctx->sa[ctx->index].used=1;
+    return hash;
+}
 
-    /* set the info structure */
-    memcpy(&(ctx->sa[ctx->index].saId), id, sizeof(AIRPDCAP_SEC_ASSOCIATION_ID));
+static gboolean
+AirPDcapPwdKeyEqual(
+    gconstpointer a,
+    gconstpointer b)
+{
+    const AIRPDCAP_KEY_ITEM *key_a=(const AIRPDCAP_KEY_ITEM *)a;
+    const AIRPDCAP_KEY_ITEM *key_b=(const AIRPDCAP_KEY_ITEM *)b;
 
-    /* increment by 1 the first_free_index (heuristic) */
-    ctx->first_free_index++;
+    return strcmp(key_a->UserPwd.Passphrase, key_b->UserPwd.Passphrase)==0 &&
+        key_a->UserPwd.SsidLen==key_b->UserPwd.SsidLen &&
+        memcmp(key_a->UserPwd.Ssid, key_b->UserPwd.Ssid, key_a->UserPwd.SsidLen)==0;
+}
 
-    /* set the sa_index if the added index is greater the the sa_index */
-    if (ctx->index > ctx->sa_index)
-        ctx->sa_index=ctx->index;
+static PAIRPDCAP_KEY_ITEM
+AirPDcapGetPwdKey(
+    PAIRPDCAP_CONTEXT ctx,
+    const AIRPDCAP_KEY_ITEM *key,
+    const CHAR *ssid,
+    const size_t ssidLength)
+{
+    AIRPDCAP_KEY_ITEM pwd_key;
+    PAIRPDCAP_KEY_ITEM cached;
+
+    memcpy(&pwd_key, key, sizeof(pwd_key));
+    memcpy(pwd_key.UserPwd.Ssid, ssid, ssidLength);
+    pwd_key.UserPwd.SsidLen=ssidLength;
+
+    cached=(PAIRPDCAP_KEY_ITEM)g_hash_table_lookup(ctx->pmk_cache, &pwd_key);
+    if (cached==NULL) {
+        AIRPDCAP_DEBUG_PRINT_LINE("AirPDcapGetPwdKey", "Derive the PSK from passphrase and SSID", AIRPDCAP_DEBUG_LEVEL_4);
+        AirPDcapRsnaPwd2Psk(pwd_key.UserPwd.Passphrase, pwd_key.UserPwd.Ssid,
+            pwd_key.UserPwd.SsidLen, pwd_key.KeyData.Wpa.Psk);
+        cached=(PAIRPDCAP_KEY_ITEM)g_memdup(&pwd_key, sizeof(pwd_key));
+        g_hash_table_insert(ctx->pmk_cache, cached, cached);
+    }
 
-    return ctx->index;
+    return cached;
 }
 
 /*
@@ -66,7 +66,6 @@
 #define	AIRPDCAP_RET_SUCCESS_HANDSHAKE  	 -1
 
 #define	AIRPDCAP_MAX_KEYS_NR	        	 64
-#define	AIRPDCAP_MAX_SEC_ASSOCIATIONS_NR	256
 
 /*	Decryption algorithms fields size definition (bytes)		*/
 #define	AIRPDCAP_WPA_NONCE_LEN		         32
@@ -130,11 +129,6 @@ typedef struct _AIRPDCAP_SEC_ASSOCIATION {
      */
     struct _AIRPDCAP_SEC_ASSOCIATION* next;
 
-	/**
-	 * This flag define whether this item is used or not. Accepted
-     * values are TRUE and FALSE
-	 */
-	UINT8 used;
 	AIRPDCAP_SEC_ASSOCIATION_ID saId;
 	AIRPDCAP_KEY_ITEM *key;
 	UINT8 handshake;
@@ -154,16 +148,18 @@ typedef struct _AIRPDCAP_SEC_ASSOCIATION {
 } AIRPDCAP_SEC_ASSOCIATION, *PAIRPDCAP_SEC_ASSOCIATION;
 
 typedef struct _AIRPDCAP_CONTEXT {
-	AIRPDCAP_SEC_ASSOCIATION sa[AIRPDCAP_MAX_SEC_ASSOCIATIONS_NR];
-	INT sa_index;
+	/* Security associations, keyed by their BSSID/STA pair */
+	GHashTable *sa_hash;
 	AIRPDCAP_KEY_ITEM keys[AIRPDCAP_MAX_KEYS_NR];
 	size_t keys_nr;
 
+	/* PSKs already derived from a passphrase/SSID pair; unlike the
+	 * security associations these stay valid when the context is
+	 * initialized again */
+	GHashTable *pmk_cache;
+
         CHAR pkt_ssid[AIRPDCAP_WPA_SSID_MAX_LEN];
         size_t pkt_ssid_len;
-
-	INT index;
-	INT first_free_index;
 } AIRPDCAP_CONTEXT, *PAIRPDCAP_CONTEXT;
 
 /************************************************************************/
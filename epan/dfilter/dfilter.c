@@ -150,6 +150,8 @@ dfilter_free(dfilter_t *df)
 		free_insns(df->consts);
 	}
 
+	for (i = 0; i < (guint)df->num_interesting_fields; i++)
+		proto_release_interesting_hfid(df->interesting_fields[i]);
 	g_free(df->interesting_fields);
 
 	/* clear registers */
@@ -336,6 +338,8 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 		dfw->consts = NULL;
 		dfilter->interesting_fields = dfw_interesting_fields(dfw,
 			&dfilter->num_interesting_fields);
+		for (i = 0; i < (guint)dfilter->num_interesting_fields; i++)
+			proto_hold_interesting_hfid(dfilter->interesting_fields[i]);
 
 		/* Initialize run-time space */
 		dfilter->num_registers = dfw->first_constant;
@@ -395,6 +399,335 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
     }
 }
 
+/*
+ * Narrowing detection.
+ *
+ * When the user refines a display filter ("http" -> "http && ip.src==1.2.3.4",
+ * or "frame.len > 100" -> "frame.len > 1000"), every packet matching the
+ * new filter also matched the old one, so only the packets that passed the
+ * old filter need to be looked at again.  We prove that from the filter
+ * text alone, conservatively: a FALSE answer means "don't know".
+ *
+ * TEST_AND has the lowest precedence in grammar.lemon, so splitting a
+ * filter at its top-level "&&"/"and" operators yields its conjuncts
+ * exactly, whatever "||" or "!" they contain.
+ */
+
+#define DF_WORD_CHAR(c)	(g_ascii_isalnum(c) || (c) == '_' || (c) == '.' || (c) == '-' || (c) == ':')
+
+/* Fields whose value depends on which packets are displayed. */
+static const char *display_dependent_fields[] = {
+	"frame.time_delta_displayed",
+	NULL
+};
+
+typedef enum {
+	DF_BOUND_LOWER,		/* field > value, field >= value */
+	DF_BOUND_UPPER,		/* field < value, field <= value */
+	DF_BOUND_EQUAL		/* field == value */
+} df_bound_kind_t;
+
+typedef struct {
+	header_field_info	*hfinfo;
+	df_bound_kind_t		kind;
+	gboolean		strict;
+	gboolean		is_signed;
+	union {
+		gint64		s;
+		guint64		u;
+	} value;
+} df_bound_t;
+
+/* Length of the "&&" or "and" operator at s, or 0 if there isn't one. */
+static int
+df_and_op_len(const gchar *text, const gchar *s)
+{
+	if (s[0] == '&' && s[1] == '&')
+		return 2;
+	if (s != text && DF_WORD_CHAR(s[-1]))
+		return 0;
+	if (strncmp(s, "and", 3) == 0 && !DF_WORD_CHAR(s[3]))
+		return 3;
+	return 0;
+}
+
+/* Copies [start, end) dropping all whitespace outside of quoted strings,
+ * except a single blank between two word characters. */
+static gchar *
+df_normalize(const gchar *start, const gchar *end)
+{
+	GString		*str = g_string_sized_new(end - start);
+	const gchar	*s;
+	gboolean	in_quote = FALSE, pending_blank = FALSE;
+
+	for (s = start; s < end; s++) {
+		if (in_quote) {
+			g_string_append_c(str, *s);
+			if (*s == '\\' && s + 1 < end)
+				g_string_append_c(str, *++s);
+			else if (*s == '"')
+				in_quote = FALSE;
+			continue;
+		}
+		if (g_ascii_isspace(*s)) {
+			pending_blank = TRUE;
+			continue;
+		}
+		if (pending_blank && str->len > 0 &&
+		    DF_WORD_CHAR(str->str[str->len - 1]) && DF_WORD_CHAR(*s))
+			g_string_append_c(str, ' ');
+		pending_blank = FALSE;
+		if (*s == '"')
+			in_quote = TRUE;
+		g_string_append_c(str, *s);
+	}
+	return g_string_free(str, FALSE);
+}
+
+/* Returns the offset of the parenthesis closing the one at text[0]. */
+static gsize
+df_matching_paren(const gchar *text)
+{
+	const gchar	*s;
+	int		depth = 0;
+	gboolean	in_quote = FALSE;
+
+	for (s = text; *s != '\0'; s++) {
+		if (in_quote) {
+			if (*s == '\\' && s[1] != '\0')
+				s++;
+			else if (*s == '"')
+				in_quote = FALSE;
+		} else if (*s == '"') {
+			in_quote = TRUE;
+		} else if (*s == '(') {
+			depth++;
+		} else if (*s == ')') {
+			if (--depth == 0)
+				return s - text;
+		}
+	}
+	return 0;
+}
+
+static gboolean df_split_conjuncts(const gchar *text, GPtrArray *conjuncts);
+
+static gboolean
+df_add_conjunct(const gchar *start, const gchar *end, GPtrArray *conjuncts)
+{
+	gchar		*conjunct = df_normalize(start, end);
+	gsize		len = strlen(conjunct);
+	gboolean	ok;
+
+	if (len == 0) {
+		g_free(conjunct);
+		return FALSE;
+	}
+	if (conjunct[0] == '(' && df_matching_paren(conjunct) == len - 1) {
+		/* "(a && b)" - look inside the parentheses. */
+		conjunct[len - 1] = '\0';
+		ok = df_split_conjuncts(conjunct + 1, conjuncts);
+		g_free(conjunct);
+		return ok;
+	}
+	g_ptr_array_add(conjuncts, conjunct);
+	return TRUE;
+}
+
+/* Splits text at its top-level "&&" operators, adding the normalized
+ * conjuncts to the array.  Returns FALSE if the text can't be analyzed. */
+static gboolean
+df_split_conjuncts(const gchar *text, GPtrArray *conjuncts)
+{
+	const gchar	*s, *start = text;
+	int		depth = 0, len;
+	gboolean	in_quote = FALSE;
+
+	for (s = text; *s != '\0'; s++) {
+		if (in_quote) {
+			if (*s == '\\' && s[1] != '\0')
+				s++;
+			else if (*s == '"')
+				in_quote = FALSE;
+			continue;
+		}
+		switch (*s) {
+
+		case '"':
+			in_quote = TRUE;
+			break;
+
+		case '$':
+			/* A macro; we don't know what it expands to. */
+			return FALSE;
+
+		case '(':
+		case '[':
+			depth++;
+			break;
+
+		case ')':
+		case ']':
+			if (--depth < 0)
+				return FALSE;
+			break;
+
+		default:
+			if (depth == 0 && (len = df_and_op_len(text, s)) != 0) {
+				if (!df_add_conjunct(start, s, conjuncts))
+					return FALSE;
+				s += len - 1;
+				start = s + 1;
+			}
+			break;
+		}
+	}
+	if (in_quote || depth != 0)
+		return FALSE;
+	return df_add_conjunct(start, s, conjuncts);
+}
+
+/* Parses a normalized "field <op> integer" conjunct. */
+static gboolean
+df_parse_bound(const gchar *conjunct, df_bound_t *bound)
+{
+	const gchar		*s = conjunct;
+	gchar			*name, *end;
+	header_field_info	*hfinfo;
+
+	while (DF_WORD_CHAR(*s))
+		s++;
+	if (s == conjunct)
+		return FALSE;
+	name = g_strndup(conjunct, s - conjunct);
+	hfinfo = proto_registrar_get_byname(name);
+	g_free(name);
+	if (hfinfo == NULL)
+		return FALSE;
+
+	if (*s == ' ')
+		s++;
+	bound->strict = FALSE;
+	if (strncmp(s, ">=", 2) == 0 || strncmp(s, "ge ", 3) == 0) {
+		bound->kind = DF_BOUND_LOWER;
+		s += 2;
+	} else if (strncmp(s, "<=", 2) == 0 || strncmp(s, "le ", 3) == 0) {
+		bound->kind = DF_BOUND_UPPER;
+		s += 2;
+	} else if (strncmp(s, "==", 2) == 0 || strncmp(s, "eq ", 3) == 0) {
+		bound->kind = DF_BOUND_EQUAL;
+		s += 2;
+	} else if (strncmp(s, "gt ", 3) == 0 || strncmp(s, "lt ", 3) == 0) {
+		bound->kind = (*s == 'g') ? DF_BOUND_LOWER : DF_BOUND_UPPER;
+		bound->strict = TRUE;
+		s += 2;
+	} else if (*s == '>' || *s == '<') {
+		bound->kind = (*s == '>') ? DF_BOUND_LOWER : DF_BOUND_UPPER;
+		bound->strict = TRUE;
+		s += 1;
+	} else
+		return FALSE;
+	if (*s == ' ')
+		s++;
+
+	/* Only integer fields compare numerically; the value is parsed the
+	 * way ftype-integer.c parses it, so "010" is octal here too.  All
+	 * fields registered under this name must agree on the type. */
+	while (hfinfo->same_name_prev != NULL)
+		hfinfo = hfinfo->same_name_prev;
+	bound->hfinfo = hfinfo;
+	bound->is_signed = IS_FT_INT(hfinfo->type);
+	for (; hfinfo != NULL; hfinfo = hfinfo->same_name_next) {
+		if (bound->is_signed ? !IS_FT_INT(hfinfo->type) : !IS_FT_UINT(hfinfo->type))
+			return FALSE;
+	}
+
+	if (!g_ascii_isdigit(*s) && !(bound->is_signed && *s == '-'))
+		return FALSE;
+	if (bound->is_signed)
+		bound->value.s = g_ascii_strtoll(s, &end, 0);
+	else
+		bound->value.u = g_ascii_strtoull(s, &end, 0);
+	return (end != s && *end == '\0');
+}
+
+static int
+df_bound_cmp(const df_bound_t *a, const df_bound_t *b)
+{
+	if (a->is_signed)
+		return (a->value.s > b->value.s) - (a->value.s < b->value.s);
+	return (a->value.u > b->value.u) - (a->value.u < b->value.u);
+}
+
+/* Does the normalized conjunct "n" imply the normalized conjunct "o"? */
+static gboolean
+df_conjunct_implies(const gchar *n, const gchar *o)
+{
+	df_bound_t	nb, ob;
+	int		cmp;
+
+	if (strcmp(n, o) == 0)
+		return TRUE;
+	if (!df_parse_bound(o, &ob) || !df_parse_bound(n, &nb))
+		return FALSE;
+	if (nb.hfinfo != ob.hfinfo || ob.kind == DF_BOUND_EQUAL)
+		return FALSE;
+	if (nb.kind != DF_BOUND_EQUAL && nb.kind != ob.kind)
+		return FALSE;
+
+	cmp = df_bound_cmp(&nb, &ob);
+	if (ob.kind == DF_BOUND_UPPER)
+		cmp = -cmp;
+	if (cmp != 0)
+		return cmp > 0;
+	/* Same value: "> 5" implies ">= 5", not the other way round. */
+	return !ob.strict || (nb.kind != DF_BOUND_EQUAL && nb.strict);
+}
+
+gboolean
+dfilter_is_narrowing(const gchar *old_text, const gchar *new_text)
+{
+	GPtrArray	*old_conj, *new_conj;
+	gboolean	narrowing;
+	guint		i, j;
+	int		k;
+
+	if (old_text == NULL || old_text[0] == '\0')
+		return TRUE;	/* Nothing was filtered out before. */
+	if (new_text == NULL)
+		return FALSE;
+
+	for (k = 0; display_dependent_fields[k] != NULL; k++) {
+		if (strstr(old_text, display_dependent_fields[k]) != NULL ||
+		    strstr(new_text, display_dependent_fields[k]) != NULL)
+			return FALSE;
+	}
+
+	old_conj = g_ptr_array_new();
+	new_conj = g_ptr_array_new();
+	narrowing = df_split_conjuncts(old_text, old_conj) &&
+	    df_split_conjuncts(new_text, new_conj);
+
+	/* Every old conjunct must be implied by some new conjunct. */
+	for (i = 0; narrowing && i < old_conj->len; i++) {
+		narrowing = FALSE;
+		for (j = 0; !narrowing && j < new_conj->len; j++) {
+			narrowing = df_conjunct_implies(
+			    (const gchar *)g_ptr_array_index(new_conj, j),
+			    (const gchar *)g_ptr_array_index(old_conj, i));
+		}
+	}
+
+	for (i = 0; i < old_conj->len; i++)
+		g_free(g_ptr_array_index(old_conj, i));
+	for (i = 0; i < new_conj->len; i++)
+		g_free(g_ptr_array_index(new_conj, i));
+	g_ptr_array_free(old_conj, TRUE);
+	g_ptr_array_free(new_conj, TRUE);
+
+	return narrowing;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -87,6 +87,13 @@ dfilter_apply(dfilter_t *df, proto_tree *tree);
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 
+/* Returns TRUE if every packet matching the filter "new_text" is known
+ * to match the filter "old_text" as well, i.e. the new filter only adds
+ * conditions to, or tightens integer bounds of, the old one.  This is
+ * decided from the filter text; FALSE means "don't know". */
+gboolean
+dfilter_is_narrowing(const gchar *old_text, const gchar *new_text);
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
 
@@ -1185,6 +1185,32 @@ ssl_data_set(StringInfo* str, const guchar* data, guint len)
     str->data_len = len;
 }
 
+/* allocate a StringInfo and its data in one chunk; ssl_hash() depends on
+ * the data being aligned for guint access */
+static StringInfo *
+ssl_string_dup(const guchar* data, guint len)
+{
+    StringInfo* str;
+
+    str = g_malloc(sizeof(StringInfo) + len);
+    str->data = ((guchar*)str+sizeof(StringInfo));
+    ssl_data_set(str, data, len);
+    return str;
+}
+
+/* Decrypted pre-master secrets, keyed by the encrypted pre-master secret.
+ * Unlike the session hash, this is kept across captures and reloads, so
+ * that dissecting the same handshake again doesn't repeat the RSA private
+ * key operation; it is cleared whenever the private keys are reloaded. */
+static GHashTable *ssl_pre_master_cache = NULL;
+
+static void
+ssl_pre_master_cache_clear(void)
+{
+    if (ssl_pre_master_cache)
+        g_hash_table_remove_all(ssl_pre_master_cache);
+}
+
 #if defined(HAVE_LIBGNUTLS) && defined(HAVE_LIBGCRYPT)
 
 static gint ver_major, ver_minor, ver_patch;
@@ -2279,6 +2305,8 @@ ssl_decrypt_pre_master_secret(SslDecryptSession*ssl_session,
     StringInfo* encrypted_pre_master, SSL_PRIVATE_KEY *pk)
 {
     gint i;
+    StringInfo* encrypted_copy;
+    StringInfo* cached;
 
     if (!encrypted_pre_master)
         return -1;
@@ -2295,14 +2323,32 @@ ssl_decrypt_pre_master_secret(SslDecryptSession*ssl_session,
 
     /* with tls key loading will fail if not rsa type, so no need to check*/
     ssl_print_string("pre master encrypted",encrypted_pre_master);
-    ssl_debug_printf("ssl_decrypt_pre_master_secret:RSA_private_decrypt\n");
-    i=ssl_private_decrypt(encrypted_pre_master->data_len,
-        encrypted_pre_master->data, pk);
 
-    if (i!=48) {
-        ssl_debug_printf("ssl_decrypt_pre_master_secret wrong "
-            "pre_master_secret length (%d, expected %d)\n", i, 48);
-        return -1;
+    if (!ssl_pre_master_cache)
+        ssl_pre_master_cache = g_hash_table_new_full(ssl_hash, ssl_equal, g_free, g_free);
+
+    cached = g_hash_table_lookup(ssl_pre_master_cache, encrypted_pre_master);
+    if (cached) {
+        ssl_debug_printf("ssl_decrypt_pre_master_secret found decrypted pre_master_secret in cache\n");
+        memcpy(encrypted_pre_master->data, cached->data, cached->data_len);
+    } else {
+        /* the data is decrypted in place, so save the key first */
+        encrypted_copy = ssl_string_dup(encrypted_pre_master->data,
+            encrypted_pre_master->data_len);
+
+        ssl_debug_printf("ssl_decrypt_pre_master_secret:RSA_private_decrypt\n");
+        i=ssl_private_decrypt(encrypted_pre_master->data_len,
+            encrypted_pre_master->data, pk);
+
+        if (i!=48) {
+            ssl_debug_printf("ssl_decrypt_pre_master_secret wrong "
+                "pre_master_secret length (%d, expected %d)\n", i, 48);
+            g_free(encrypted_copy);
+            return -1;
+        }
+
+        g_hash_table_insert(ssl_pre_master_cache, encrypted_copy,
+            ssl_string_dup(encrypted_pre_master->data, 48));
     }
 
     /* the decrypted data has been written into the pre_master key buffer */
@@ -3510,6 +3556,9 @@ ssl_parse_key_list(const ssldecrypt_assoc_t * uats, GHashTable *key_hash, GTree*
     int                addr_len, at;
     address_type addr_type[2] = { AT_IPv4, AT_IPv6 };
 
+    /* secrets decrypted with the old keys must not outlive them */
+    ssl_pre_master_cache_clear();
+
     /* try to load keys file first */
     fp = ws_fopen(uats->keyfile, "rb");
     if (!fp) {
@@ -3648,196 +3697,137 @@ from_hex_char(gchar c) {
     return 16;
 }
 
-/* from_hex converts |hex_len| bytes of hex data from |in| and sets |*out| to
- * the result. |out->data| will be allocated using se_alloc. Returns TRUE on
- * success. */
-static gboolean from_hex(StringInfo* out, const char* in, gsize hex_len) {
+/* from_hex converts |hex_len| bytes of hex data from |in| and returns the
+ * result as a StringInfo allocated with ssl_string_dup(), or NULL if |in|
+ * isn't valid hex. */
+static StringInfo* from_hex(const char* in, gsize hex_len) {
+    guchar buf[256];
     gsize i;
 
-    if (hex_len & 1)
-        return FALSE;
+    if ((hex_len & 1) || hex_len == 0 || hex_len/2 > sizeof(buf))
+        return NULL;
 
-    out->data_len = (guint)hex_len/2;
-    out->data = se_alloc(out->data_len);
-    for (i = 0; i < out->data_len; i++) {
+    for (i = 0; i < hex_len/2; i++) {
         guint8 a = from_hex_char(in[i*2]);
         guint8 b = from_hex_char(in[i*2 + 1]);
         if (a == 16 || b == 16)
-            return FALSE;
-        out->data[i] = a << 4 | b;
+            return NULL;
+        buf[i] = a << 4 | b;
     }
-    return TRUE;
+    return ssl_string_dup(buf, (guint)hex_len/2);
 }
 
 static const unsigned int kRSAMasterSecretLength = 48; /* RFC5246 8.1 */
-
-/* ssl_keylog_parse_session_id parses, from |line|, a string that looks like:
- *   RSA Session-ID:<hex session id> Master-Key:<hex TLS master secret>.
+static const unsigned int kRSAPremasterLength = 48; /* RFC5246 7.4.7.1 */
+static const unsigned int kTLSRandomSize = 32; /* RFC5246 A.6 */
+
+/* The secrets from the key log file, parsed once and parsed again only when
+ * the file name, size or modification time changes, rather than rescanning
+ * the whole file for every handshake. */
+static GHashTable* ssl_keylog_session_ids = NULL;    /* session id -> master secret */
+static GHashTable* ssl_keylog_client_randoms = NULL; /* client random -> master secret */
+static GHashTable* ssl_keylog_rsa_premasters = NULL; /* encrypted pre-master (8 bytes) -> pre-master */
+static gchar* ssl_keylog_cached_filename = NULL;
+static gint64 ssl_keylog_cached_size;
+static time_t ssl_keylog_cached_mtime;
+
+/* ssl_keylog_parse_line adds the key and secret in |line| to |table|, if
+ * |line| starts with |prefix|, the key is |key_hex_len| hex digits (any even
+ * number if 0) followed by |separator|, and the secret is |secret_len| bytes
+ * of hex. An earlier entry for the same key takes precedence.
  *
- * It returns TRUE iff the session id matches |ssl_session| and the master
- * secret is correctly extracted. */
+ * It returns TRUE iff the line matched. */
 static gboolean
-ssl_keylog_parse_session_id(const char* line,
-                            SslDecryptSession* ssl_session)
+ssl_keylog_parse_line(const char* line, GHashTable* table,
+                      const char* prefix, gsize key_hex_len,
+                      const char* separator, gsize secret_len)
 {
     gsize len = strlen(line);
-    unsigned int i;
+    gsize prefix_len = strlen(prefix);
+    gsize separator_len = strlen(separator);
+    const char* secret_hex;
+    StringInfo* key;
+    StringInfo* secret;
 
-    if (ssl_session->session_id.data_len == 0)
+    if (len < prefix_len || memcmp(line, prefix, prefix_len) != 0)
         return FALSE;
+    line += prefix_len;
+    len -= prefix_len;
 
-    if (len < 15 || memcmp(line, "RSA Session-ID:", 15) != 0)
-        return FALSE;
-    line += 15;
-    len -= 15;
-
-    if (len < ssl_session->session_id.data_len*2)
-        return FALSE;
-
-    for (i = 0; i < ssl_session->session_id.data_len; i++) {
-        if (from_hex_char(line[2*i]) != (ssl_session->session_id.data[i] >> 4) ||
-            from_hex_char(line[2*i+1]) != (ssl_session->session_id.data[i] & 15)) {
-            ssl_debug_printf("    line does not match session id\n");
+    if (key_hex_len == 0) {
+        secret_hex = strstr(line, separator);
+        if (!secret_hex)
             return FALSE;
-        }
-    }
-
-    line += 2*i;
-    len -= 2*i;
-
-    if (len != 12 + kRSAMasterSecretLength*2 ||
-        memcmp(line, " Master-Key:", 12) != 0) {
+        key_hex_len = secret_hex - line;
+    } else if (len < key_hex_len + separator_len ||
+               memcmp(line + key_hex_len, separator, separator_len) != 0) {
         return FALSE;
     }
-    line += 12;
-    len -= 12;
+    secret_hex = line + key_hex_len + separator_len;
 
-    if (!from_hex(&ssl_session->master_secret, line, len))
+    if (len - key_hex_len - separator_len != secret_len*2)
         return FALSE;
-    ssl_session->state &= ~(SSL_PRE_MASTER_SECRET|SSL_HAVE_SESSION_KEY);
-    ssl_session->state |= SSL_MASTER_SECRET;
-    ssl_debug_printf("found master secret in key log\n");
-    return TRUE;
-}
-
-/* ssl_keylog_parse_client_random parses, from |line|, a string that looks like:
- *   CLIENT_RANDOM <hex client_random> <hex TLS master secret>.
- *
- * It returns TRUE iff the client_random matches |ssl_session| and the master
- * secret is correctly extracted. */
-static gboolean
-ssl_keylog_parse_client_random(const char* line,
-                               SslDecryptSession* ssl_session)
-{
-    static const unsigned int kTLSRandomSize = 32; /* RFC5246 A.6 */
-    gsize len = strlen(line);
-    unsigned int i;
 
-    if (len < 14 || memcmp(line, "CLIENT_RANDOM ", 14) != 0)
+    key = from_hex(line, key_hex_len);
+    if (!key)
         return FALSE;
-    line += 14;
-    len -= 14;
-
-    if (len < kTLSRandomSize*2 ||
-        ssl_session->client_random.data_len != kTLSRandomSize) {
+    secret = from_hex(secret_hex, secret_len*2);
+    if (!secret) {
+        g_free(key);
         return FALSE;
     }
 
-    for (i = 0; i < kTLSRandomSize; i++) {
-        if (from_hex_char(line[2*i]) != (ssl_session->client_random.data[i] >> 4) ||
-            from_hex_char(line[2*i+1]) != (ssl_session->client_random.data[i] & 15)) {
-            ssl_debug_printf("    line does not match client random\n");
-            return FALSE;
-        }
+    if (g_hash_table_lookup(table, key)) {
+        g_free(key);
+        g_free(secret);
+    } else {
+        g_hash_table_insert(table, key, secret);
     }
-
-    line += 2*kTLSRandomSize;
-    len -= 2*kTLSRandomSize;
-
-    if (len != 1 + kRSAMasterSecretLength*2 || line[0] != ' ')
-        return FALSE;
-    line++;
-    len--;
-
-    if (!from_hex(&ssl_session->master_secret, line, len))
-        return FALSE;
-    ssl_session->state &= ~(SSL_PRE_MASTER_SECRET|SSL_HAVE_SESSION_KEY);
-    ssl_session->state |= SSL_MASTER_SECRET;
-    ssl_debug_printf("found master secret in key log\n");
     return TRUE;
 }
 
-/* ssl_keylog_parse_session_id parses, from |line|, a string that looks like:
- *   RSA <hex, 8-bytes of encrypted pre-master secret> <hex pre-master secret>.
- *
- * It returns TRUE iff the session id matches |ssl_session| and the master
- * secret is correctly extracted. */
+/* ssl_keylog_load (re)reads the key log file if it isn't the one already
+ * cached or has changed since. Returns FALSE if the file can't be read. */
 static gboolean
-ssl_keylog_parse_rsa_premaster(const char* line,
-                               SslDecryptSession* ssl_session,
-                               StringInfo* encrypted_pre_master)
+ssl_keylog_load(const gchar* ssl_keylog_filename)
 {
-    static const unsigned int kRSAPremasterLength = 48; /* RFC5246 7.4.7.1 */
-    gsize len = strlen(line);
-    unsigned int i;
-
-    if (encrypted_pre_master == NULL)
-        return FALSE;
-
-    if (encrypted_pre_master->data_len < 8)
-        return FALSE;
-
-    if (len < 4 || memcmp(line, "RSA ", 4) != 0)
-        return FALSE;
-    line += 4;
-    len -= 4;
+    FILE* ssl_keylog;
+    ws_statb64 st;
 
-    if (len < 16)
+    if (ws_stat64(ssl_keylog_filename, &st) != 0) {
+        ssl_debug_printf("failed to stat SSL keylog\n");
         return FALSE;
-
-    for (i = 0; i < 8; i++) {
-        if (from_hex_char(line[2*i]) != (encrypted_pre_master->data[i] >> 4) ||
-            from_hex_char(line[2*i+1]) != (encrypted_pre_master->data[i] & 15)) {
-            ssl_debug_printf("    line does not match encrypted pre-master secret");
-            return FALSE;
-        }
     }
 
-    line += 16;
-    len -= 16;
-
-    if (len != 1 + kRSAPremasterLength*2 || line[0] != ' ')
-        return FALSE;
-    line++;
-    len--;
-
-    if (!from_hex(&ssl_session->pre_master_secret, line, len))
-        return FALSE;
-    ssl_session->state &= ~(SSL_MASTER_SECRET|SSL_HAVE_SESSION_KEY);
-    ssl_session->state |= SSL_PRE_MASTER_SECRET;
-    ssl_debug_printf("found pre-master secret in key log\n");
-
-    return TRUE;
-}
-
-int
-ssl_keylog_lookup(SslDecryptSession* ssl_session,
-                  const gchar* ssl_keylog_filename,
-                  StringInfo* encrypted_pre_master) {
-    FILE* ssl_keylog;
-    int ret = -1;
-
-    if (!ssl_keylog_filename)
-        return -1;
-
-    ssl_debug_printf("trying to use SSL keylog in %s\n", ssl_keylog_filename);
+    if (ssl_keylog_cached_filename &&
+        strcmp(ssl_keylog_cached_filename, ssl_keylog_filename) == 0 &&
+        ssl_keylog_cached_size == (gint64)st.st_size &&
+        ssl_keylog_cached_mtime == st.st_mtime) {
+        return TRUE;
+    }
 
     ssl_keylog = ws_fopen(ssl_keylog_filename, "r");
     if (!ssl_keylog) {
         ssl_debug_printf("failed to open SSL keylog\n");
-        return -1;
+        return FALSE;
     }
 
+    if (ssl_keylog_session_ids) {
+        g_hash_table_remove_all(ssl_keylog_session_ids);
+        g_hash_table_remove_all(ssl_keylog_client_randoms);
+        g_hash_table_remove_all(ssl_keylog_rsa_premasters);
+    } else {
+        ssl_keylog_session_ids = g_hash_table_new_full(ssl_hash, ssl_equal, g_free, g_free);
+        ssl_keylog_client_randoms = g_hash_table_new_full(ssl_hash, ssl_equal, g_free, g_free);
+        ssl_keylog_rsa_premasters = g_hash_table_new_full(ssl_hash, ssl_equal, g_free, g_free);
+    }
+    g_free(ssl_keylog_cached_filename);
+    ssl_keylog_cached_filename = g_strdup(ssl_keylog_filename);
+    ssl_keylog_cached_size = (gint64)st.st_size;
+    ssl_keylog_cached_mtime = st.st_mtime;
+
+    ssl_debug_printf("loading SSL keylog %s\n", ssl_keylog_filename);
+
     /* The format of the file is a series of records with one of the following formats:
      *   - "RSA xxxx yyyy"
      *     Where xxxx are the first 8 bytes of the encrypted pre-master secret (hex-encoded)
@@ -3867,26 +3857,85 @@ ssl_keylog_lookup(SslDecryptSession* ssl_session,
 
         bytes_read = strlen(line);
         /* fgets includes the \n at the end of the line. */
-        if (bytes_read > 0) {
+        if (bytes_read > 0 && line[bytes_read - 1] == '\n') {
             line[bytes_read - 1] = 0;
             bytes_read--;
         }
 
-        ssl_debug_printf("  checking keylog line: %s\n", line);
-
-        if (ssl_keylog_parse_session_id(line, ssl_session) ||
-            ssl_keylog_parse_rsa_premaster(line, ssl_session,
-                                           encrypted_pre_master) ||
-            ssl_keylog_parse_client_random(line, ssl_session)) {
-            ret = 1;
-            break;
-        } else {
-            ssl_debug_printf("    line does not match\n");
+        if (ssl_keylog_parse_line(line, ssl_keylog_session_ids,
+                                  "RSA Session-ID:", 0, " Master-Key:",
+                                  kRSAMasterSecretLength) ||
+            ssl_keylog_parse_line(line, ssl_keylog_rsa_premasters,
+                                  "RSA ", 16, " ", kRSAPremasterLength) ||
+            ssl_keylog_parse_line(line, ssl_keylog_client_randoms,
+                                  "CLIENT_RANDOM ", kTLSRandomSize*2, " ",
+                                  kRSAMasterSecretLength)) {
+            continue;
         }
+        ssl_debug_printf("  ignoring keylog line: %s\n", line);
     }
 
     fclose(ssl_keylog);
-    return ret;
+    ssl_debug_printf("SSL keylog has %u session ids, %u client randoms and %u RSA pre-master secrets\n",
+        g_hash_table_size(ssl_keylog_session_ids),
+        g_hash_table_size(ssl_keylog_client_randoms),
+        g_hash_table_size(ssl_keylog_rsa_premasters));
+    return TRUE;
+}
+
+int
+ssl_keylog_lookup(SslDecryptSession* ssl_session,
+                  const gchar* ssl_keylog_filename,
+                  StringInfo* encrypted_pre_master) {
+    StringInfo* secret;
+    StringInfo  prefix;
+
+    if (!ssl_keylog_filename)
+        return -1;
+
+    ssl_debug_printf("trying to use SSL keylog in %s\n", ssl_keylog_filename);
+
+    if (!ssl_keylog_load(ssl_keylog_filename))
+        return -1;
+
+    if (ssl_session->session_id.data_len > 0) {
+        secret = g_hash_table_lookup(ssl_keylog_session_ids, &ssl_session->session_id);
+        if (secret) {
+            ssl_data_set(&ssl_session->master_secret, secret->data, secret->data_len);
+            ssl_session->state &= ~(SSL_PRE_MASTER_SECRET|SSL_HAVE_SESSION_KEY);
+            ssl_session->state |= SSL_MASTER_SECRET;
+            ssl_debug_printf("found master secret in key log\n");
+            return 0;
+        }
+    }
+
+    if (encrypted_pre_master && encrypted_pre_master->data_len >= 8) {
+        prefix.data = encrypted_pre_master->data;
+        prefix.data_len = 8;
+        secret = g_hash_table_lookup(ssl_keylog_rsa_premasters, &prefix);
+        if (secret) {
+            ssl_session->pre_master_secret.data = se_alloc(secret->data_len);
+            ssl_data_set(&ssl_session->pre_master_secret, secret->data, secret->data_len);
+            ssl_session->state &= ~(SSL_MASTER_SECRET|SSL_HAVE_SESSION_KEY);
+            ssl_session->state |= SSL_PRE_MASTER_SECRET;
+            ssl_debug_printf("found pre-master secret in key log\n");
+            return 0;
+        }
+    }
+
+    if (ssl_session->client_random.data_len == kTLSRandomSize) {
+        secret = g_hash_table_lookup(ssl_keylog_client_randoms, &ssl_session->client_random);
+        if (secret) {
+            ssl_data_set(&ssl_session->master_secret, secret->data, secret->data_len);
+            ssl_session->state &= ~(SSL_PRE_MASTER_SECRET|SSL_HAVE_SESSION_KEY);
+            ssl_session->state |= SSL_MASTER_SECRET;
+            ssl_debug_printf("found master secret in key log\n");
+            return 0;
+        }
+    }
+
+    ssl_debug_printf("no matching secret in key log\n");
+    return -1;
 }
 
 #ifdef SSL_DECRYPT_DEBUG
@@ -436,7 +436,8 @@ extern void
 ssl_change_cipher(SslDecryptSession *ssl_session, gboolean server);
 
 /** Try to find the pre-master secret for the given encrypted pre-master secret
-    from a log of secrets.
+    from a log of secrets. The log is read once and read again only when it
+    changes.
  @param ssl_session the store for the decrypted pre_master_secret
  @param ssl_keylog_filename a file that contains a log of secrets (may be NULL)
  @param encrypted_pre_master the rsa encrypted pre_master_secret (may be NULL)
@@ -446,7 +447,8 @@ ssl_keylog_lookup(SslDecryptSession* ssl_session,
                   const gchar* ssl_keylog_filename,
                   StringInfo* encrypted_pre_master);
 
-/** Try to decrypt in place the encrypted pre_master_secret
+/** Try to decrypt in place the encrypted pre_master_secret. Decrypted
+    secrets are cached until the private keys are reloaded.
  @param ssl_session the store for the decrypted pre_master_secret
  @param encrypted_pre_master the rsa encrypted pre_master_secret
  @param pk the private key to be used for decryption
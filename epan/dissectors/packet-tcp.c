@@ -27,6 +27,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <glib.h>
 #include <epan/in_cksum.h>
@@ -43,7 +44,6 @@
 #include <epan/conversation.h>
 #include <epan/reassemble.h>
 #include <epan/tap.h>
-#include <epan/slab.h>
 #include <epan/expert.h>
 
 static int tcp_tap = -1;
@@ -408,16 +408,6 @@ static gboolean tcp_relative_seq          = TRUE;
 static gboolean tcp_track_bytes_in_flight = TRUE;
 static gboolean tcp_calculate_ts          = FALSE;
 
-/* SLAB allocator for tcp_unacked structures
- */
-SLAB_ITEM_TYPE_DEFINE(tcp_unacked_t)
-static SLAB_FREE_LIST_DEFINE(tcp_unacked_t)
-#define TCP_UNACKED_NEW(fi)                 \
-    SLAB_ALLOC(fi, tcp_unacked_t)
-#define TCP_UNACKED_FREE(fi)                    \
-    SLAB_FREE(fi, tcp_unacked_t)
-
-
 #define TCP_A_RETRANSMISSION        0x0001
 #define TCP_A_LOST_PACKET           0x0002
 #define TCP_A_ACK_LOST_PACKET       0x0004
@@ -778,26 +768,297 @@ tcp_analyze_get_acked_struct(guint32 frame, guint32 seq, guint32 ack, gboolean c
 }
 
 
-/* fwd contains a list of all segments processed but not yet ACKed in the
- *     same direction as the current segment.
- * rev contains a list of all segments received but not yet ACKed in the
- *     opposite direction to the current segment.
+/* Unacked segment rings.
  *
- * New segments are always added to the head of the fwd/rev lists.
+ * The segments in a ring are sorted by seq-base, and every seq-base and
+ * nextseq-base is kept below TCP_UNACKED_SPAN.  For any ACK less than 2^31
+ * above base, comparing ack-base with those offsets then gives the same
+ * answer as GT_SEQ() and friends, so a cumulative ACK only touches the
+ * segments at the front of the ring.  A ring whose segments can't be kept
+ * within TCP_UNACKED_SPAN is marked unordered and searched linearly until
+ * it is empty again.
  *
+ * The rings can grow past what se_alloc() will hand out, so their buffers
+ * are g_malloc()ed and remembered in tcp_unacked_bufs, which tcp_init()
+ * frees along with the seasonal memory holding the rings themselves.
+ */
+#define TCP_UNACKED_SPAN    0x40000000
+#define TCP_UNACKED_AT(r, i)    (&(r)->buf[((r)->head + (i)) & ((r)->size - 1)])
+
+static GHashTable *tcp_unacked_bufs = NULL;
+
+static void
+tcp_unacked_grow(tcp_unacked_ring_t *r)
+{
+    tcp_unacked_t *buf;
+    guint32 size, i;
+
+    size = r->size ? r->size * 2 : 4;
+    buf = g_malloc(size * sizeof(tcp_unacked_t));
+    for (i = 0; i < r->count; i++) {
+        buf[i] = *TCP_UNACKED_AT(r, i);
+    }
+    if (r->buf) {
+        g_hash_table_remove(tcp_unacked_bufs, r->buf);
+    }
+    g_hash_table_insert(tcp_unacked_bufs, buf, buf);
+    r->buf = buf;
+    r->size = size;
+    r->head = 0;
+}
+
+static void
+tcp_unacked_add(tcp_unacked_ring_t *r, guint32 frame, guint32 seq, guint32 nextseq, nstime_t *ts)
+{
+    tcp_unacked_t *ual;
+    guint32 len = nextseq - seq;
+    guint32 s = 0, d, lo, up, mid, i;
+
+    if (r->count == r->size) {
+        tcp_unacked_grow(r);
+    }
+    if (r->count == 0) {
+        r->base = seq;
+        r->hi = 0;
+        r->maxlen = 0;
+        r->unordered = FALSE;
+    }
+    if (len >= TCP_UNACKED_SPAN) {
+        r->unordered = TRUE;
+    }
+
+    if (!r->unordered) {
+        s = seq - r->base;
+        if (s >= TCP_UNACKED_SPAN || s + len >= TCP_UNACKED_SPAN) {
+            if (s < 0x80000000) {
+                /* Past the end: move base up to the first segment */
+                d = TCP_UNACKED_AT(r, 0)->seq - r->base;
+                r->base += d;
+                r->hi -= d;
+                s -= d;
+            } else if ((guint64)r->hi + (r->base - seq) < TCP_UNACKED_SPAN) {
+                /* Before the start: move base down to this segment */
+                r->hi += r->base - seq;
+                r->base = seq;
+                s = 0;
+            }
+            if (s >= TCP_UNACKED_SPAN || s + len >= TCP_UNACKED_SPAN) {
+                r->unordered = TRUE;
+            }
+        }
+    }
+
+    if (r->unordered) {
+        i = r->count;
+    } else {
+        if (s + len > r->hi) {
+            r->hi = s + len;
+        }
+        if (len > r->maxlen) {
+            r->maxlen = len;
+        }
+
+        /* New segments normally go at the end; find the place of the
+         * others after any segments with the same seq.
+         */
+        lo = r->count;
+        if (r->count && TCP_UNACKED_AT(r, r->count - 1)->seq - r->base > s) {
+            lo = 0;
+            up = r->count - 1;
+            while (lo < up) {
+                mid = lo + (up - lo) / 2;
+                if (TCP_UNACKED_AT(r, mid)->seq - r->base > s) {
+                    up = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+        }
+        i = lo;
+    }
+
+    /* Make room at i, moving whichever side of the ring is shorter */
+    if (i < r->count / 2) {
+        r->head = (r->head - 1) & (r->size - 1);
+        for (d = 0; d < i; d++) {
+            *TCP_UNACKED_AT(r, d) = *TCP_UNACKED_AT(r, d + 1);
+        }
+    } else {
+        for (d = r->count; d > i; d--) {
+            *TCP_UNACKED_AT(r, d) = *TCP_UNACKED_AT(r, d - 1);
+        }
+    }
+    r->count++;
+
+    ual = TCP_UNACKED_AT(r, i);
+    ual->frame = frame;
+    ual->seq = seq;
+    ual->nextseq = nextseq;
+    ual->ts = *ts;
+}
+
+static int
+tcp_unacked_newest_first(const void *a, const void *b)
+{
+    const tcp_unacked_t *ua = a, *ub = b;
+
+    if (ua->frame != ub->frame) {
+        return ua->frame > ub->frame ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Remove the segments ack acknowledges from the ring, and trim the ones it
+ * acknowledges part of.  Returns TRUE and copies the segment to *acked if
+ * ack is exactly the end of a segment (of the earliest one if there are
+ * several).  If maxsizeacked isn't NULL, it's raised to the size of the
+ * largest segment removed.
+ */
+static gboolean
+tcp_unacked_ack(tcp_unacked_ring_t *r, guint32 ack, tcp_unacked_t *acked, guint16 *maxsizeacked)
+{
+    tcp_unacked_t *ual, *removed = NULL;
+    guint32 a, n, w, i, nremoved = 0;
+    gboolean found = FALSE;
+
+    if (r->count == 0) {
+        return FALSE;
+    }
+    a = ack - r->base;
+    if (!r->unordered && a >= 0x80000000 + TCP_UNACKED_SPAN) {
+        /* before every segment in the ring */
+        return FALSE;
+    }
+    if (maxsizeacked) {
+        removed = ep_alloc(r->count * sizeof(tcp_unacked_t));
+    }
+
+    if (!r->unordered && a < 0x80000000) {
+        /* Only the segments starting before ack are affected.  Walk them
+         * backwards, packing the ones that are kept against the rest of
+         * the ring.
+         */
+        for (n = 0; n < r->count && TCP_UNACKED_AT(r, n)->seq - r->base < a; n++)
+            ;
+        w = n;
+        for (i = n; i-- > 0; ) {
+            ual = TCP_UNACKED_AT(r, i);
+            if (ual->nextseq - r->base > a) {
+                ual->seq = ack;
+                *TCP_UNACKED_AT(r, --w) = *ual;
+                continue;
+            }
+            if (ual->nextseq == ack && (!found || ual->frame < acked->frame)) {
+                *acked = *ual;
+                found = TRUE;
+            }
+            if (removed) {
+                removed[nremoved++] = *ual;
+            }
+        }
+        r->head = (r->head + w) & (r->size - 1);
+        r->count -= w;
+    } else {
+        w = 0;
+        for (i = 0; i < r->count; i++) {
+            ual = TCP_UNACKED_AT(r, i);
+            if (ack == ual->nextseq) {
+                if (!found || ual->frame < acked->frame) {
+                    *acked = *ual;
+                    found = TRUE;
+                }
+            } else if (GT_SEQ(ack, ual->seq) && LE_SEQ(ack, ual->nextseq)) {
+                /* this acknowledges part of the segment */
+                ual->seq = ack;
+                r->unordered = TRUE;
+                *TCP_UNACKED_AT(r, w++) = *ual;
+                continue;
+            } else if (GT_SEQ(ual->nextseq, ack)) {
+                *TCP_UNACKED_AT(r, w++) = *ual;
+                continue;
+            }
+            if (removed) {
+                removed[nremoved++] = *ual;
+            }
+        }
+        r->count = w;
+    }
+
+    if (nremoved) {
+        /* maxsizeacked is only 16 bits wide, so update it in the order
+         * the segments were sent, newest first.
+         */
+        qsort(removed, nremoved, sizeof(tcp_unacked_t), tcp_unacked_newest_first);
+        for (i = 0; i < nremoved; i++) {
+            if ((removed[i].nextseq - removed[i].seq) > *maxsizeacked) {
+                *maxsizeacked = (removed[i].nextseq - removed[i].seq);
+            }
+        }
+    }
+    return found;
+}
+
+/* Returns the distance from the start of the first segment in the ring to
+ * the end of the last one, both taken relative to base_seq.
+ */
+static guint32
+tcp_unacked_in_flight(tcp_unacked_ring_t *r, guint32 base_seq)
+{
+    tcp_unacked_t *ual;
+    guint32 first_seq, last_seq, i;
+
+    if (!r->unordered && (guint64)(r->base - base_seq) + r->hi <= G_MAXUINT32) {
+        /* None of the offsets from base_seq wrap, so the first segment
+         * has the lowest one and the highest end is at most maxlen past
+         * the start of the last few segments.
+         */
+        first_seq = TCP_UNACKED_AT(r, 0)->seq - r->base;
+        last_seq = 0;
+        for (i = r->count; i-- > 0; ) {
+            ual = TCP_UNACKED_AT(r, i);
+            if (ual->seq - r->base + r->maxlen <= last_seq) {
+                break;
+            }
+            if ((ual->nextseq - r->base) > last_seq) {
+                last_seq = ual->nextseq - r->base;
+            }
+        }
+        return last_seq - first_seq;
+    }
+
+    ual = TCP_UNACKED_AT(r, 0);
+    first_seq = ual->seq - base_seq;
+    last_seq = ual->nextseq - base_seq;
+    for (i = 1; i < r->count; i++) {
+        ual = TCP_UNACKED_AT(r, i);
+        if ((ual->nextseq - base_seq) > last_seq) {
+            last_seq = ual->nextseq - base_seq;
+        }
+        if ((ual->seq - base_seq) < first_seq) {
+            first_seq = ual->seq - base_seq;
+        }
+    }
+    return last_seq - first_seq;
+}
+
+/* fwd contains all segments processed but not yet ACKed in the
+ *     same direction as the current segment.
+ * rev contains all segments received but not yet ACKed in the
+ *     opposite direction to the current segment.
  */
 static void
 tcp_analyze_sequence_number(packet_info *pinfo, guint32 seq, guint32 ack, guint32 seglen, guint16 flags, guint32 window, struct tcp_analysis *tcpd)
 {
-    tcp_unacked_t *ual=NULL;
-    tcp_unacked_t *prevual=NULL;
+    tcp_unacked_t acked;
     guint32 nextseq;
-    int ackcount;
+#ifdef REMOVED
+    guint32 i;
+#endif
 
 #ifdef REMOVED
 printf("analyze_sequence numbers   frame:%u  direction:%s\n",pinfo->fd->num,direction>=0?"FWD":"REW");
-printf("FWD list lastflags:0x%04x base_seq:0x%08x:\n",tcpd->fwd->lastsegmentflags,tcpd->fwd->base_seq);for(ual=tcpd->fwd->segments;ual;ual=ual->next)printf("Frame:%d Seq:%d Nextseq:%d\n",ual->frame,ual->seq,ual->nextseq);
-printf("REV list lastflags:0x%04x base_seq:0x%08x:\n",tcpd->rev->lastsegmentflags,tcpd->rev->base_seq);for(ual=tcpd->rev->segments;ual;ual=ual->next)printf("Frame:%d Seq:%d Nextseq:%d\n",ual->frame,ual->seq,ual->nextseq);
+printf("FWD list lastflags:0x%04x base_seq:0x%08x:\n",tcpd->fwd->lastsegmentflags,tcpd->fwd->base_seq);for(i=0;i<tcpd->fwd->segments.count;i++)printf("Frame:%d Seq:%d Nextseq:%d\n",TCP_UNACKED_AT(&tcpd->fwd->segments,i)->frame,TCP_UNACKED_AT(&tcpd->fwd->segments,i)->seq,TCP_UNACKED_AT(&tcpd->fwd->segments,i)->nextseq);
+printf("REV list lastflags:0x%04x base_seq:0x%08x:\n",tcpd->rev->lastsegmentflags,tcpd->rev->base_seq);for(i=0;i<tcpd->rev->segments.count;i++)printf("Frame:%d Seq:%d Nextseq:%d\n",TCP_UNACKED_AT(&tcpd->rev->segments,i)->frame,TCP_UNACKED_AT(&tcpd->rev->segments,i)->seq,TCP_UNACKED_AT(&tcpd->rev->segments,i)->nextseq);
 #endif
 
     if (!tcpd) {
@@ -1091,19 +1352,12 @@ finished_checking_retransmission_type:
 
         nextseq = seq+seglen;
         if (seglen || flags&(TH_SYN|TH_FIN)) {
-        /* add this new sequence number to the fwd list */
-        TCP_UNACKED_NEW(ual);
-        ual->next=tcpd->fwd->segments;
-        tcpd->fwd->segments=ual;
-        ual->frame=pinfo->fd->num;
-        ual->seq=seq;
-        ual->ts=pinfo->fd->abs_ts;
-
-        /* next sequence number is seglen bytes away, plus SYN/FIN which counts as one byte */
-        if( (flags&(TH_SYN|TH_FIN)) ){
-        nextseq+=1;
+            /* next sequence number is seglen bytes away, plus SYN/FIN which counts as one byte */
+            if( (flags&(TH_SYN|TH_FIN)) ){
+                nextseq+=1;
             }
-            ual->nextseq=nextseq;
+            /* add this new sequence number to the fwd list */
+            tcp_unacked_add(&tcpd->fwd->segments, pinfo->fd->num, seq, nextseq, &pinfo->fd->abs_ts);
         }
 
     /* Store the highest number seen so far for nextseq so we can detect
@@ -1149,72 +1403,20 @@ finished_checking_retransmission_type:
 
     /* remove all segments this ACKs and we don't need to keep around any more
      */
-    ackcount=0;
-    prevual = NULL;
-    ual = tcpd->rev->segments;
-    while(ual){
-        tcp_unacked_t *tmpual;
-
-        /* If this ack matches the segment, process accordingly */
-        if(ack==ual->nextseq){
-            tcp_analyze_get_acked_struct(pinfo->fd->num, seq, ack, TRUE, tcpd);
-            tcpd->ta->frame_acked=ual->frame;
-            nstime_delta(&tcpd->ta->ts, &pinfo->fd->abs_ts, &ual->ts);
-        }
-        /* If this acknowledges part of the segment, adjust the segment info for the acked part */
-        else if (GT_SEQ(ack, ual->seq) && LE_SEQ(ack, ual->nextseq)) {
-            ual->seq = ack;
-            continue;
-        }
-        /* If this acknowledges a segment prior to this one, leave this segment alone and move on */
-        else if (GT_SEQ(ual->nextseq,ack)){
-            prevual = ual;
-            ual = ual->next;
-            continue;
-        }
-
-        /* This segment is old, or an exact match.  Delete the segment from the list */
-        ackcount++;
-        tmpual=ual->next;
-
-        if (tcpd->rev->scps_capable) {
-          /* Track largest segment successfully sent for SNACK analysis*/
-          if ((ual->nextseq - ual->seq) > tcpd->fwd->maxsizeacked){
-            tcpd->fwd->maxsizeacked = (ual->nextseq - ual->seq);
-          }
-        }
-
-        if (!prevual){
-            tcpd->rev->segments = tmpual;
-            TCP_UNACKED_FREE(ual);
-            ual = tmpual;
-        }
-        else{
-            prevual->next = tmpual;
-            TCP_UNACKED_FREE(ual);
-            ual = tmpual;
-        }
+    if (tcp_unacked_ack(&tcpd->rev->segments, ack, &acked,
+                        tcpd->rev->scps_capable ? &tcpd->fwd->maxsizeacked : NULL)) {
+        tcp_analyze_get_acked_struct(pinfo->fd->num, seq, ack, TRUE, tcpd);
+        tcpd->ta->frame_acked=acked.frame;
+        nstime_delta(&tcpd->ta->ts, &pinfo->fd->abs_ts, &acked.ts);
     }
 
     /* how many bytes of data are there in flight after this frame
      * was sent
      */
-    ual=tcpd->fwd->segments;
-    if (tcp_track_bytes_in_flight && seglen!=0 && ual && tcpd->fwd->valid_bif) {
-        guint32 first_seq, last_seq, in_flight;
-
-        first_seq = ual->seq - tcpd->fwd->base_seq;
-        last_seq = ual->nextseq - tcpd->fwd->base_seq;
-        while (ual) {
-            if ((ual->nextseq-tcpd->fwd->base_seq)>last_seq) {
-                last_seq = ual->nextseq-tcpd->fwd->base_seq;
-            }
-            if ((ual->seq-tcpd->fwd->base_seq)<first_seq) {
-                first_seq = ual->seq-tcpd->fwd->base_seq;
-            }
-            ual = ual->next;
-        }
-        in_flight = last_seq-first_seq;
+    if (tcp_track_bytes_in_flight && seglen!=0 && tcpd->fwd->segments.count && tcpd->fwd->valid_bif) {
+        guint32 in_flight;
+
+        in_flight = tcp_unacked_in_flight(&tcpd->fwd->segments, tcpd->fwd->base_seq);
 
         if (in_flight>0 && in_flight<2000000000) {
             if(!tcpd->ta){
@@ -1660,6 +1862,8 @@ static GHashTable *tcp_fragment_table = NULL;
 /* functions to trace tcp segments */
 /* Enable desegmenting of TCP streams */
 static gboolean tcp_desegment = TRUE;
+/* Hold segments that arrive ahead of a gap until the gap is filled */
+static gboolean tcp_reassemble_out_of_order = FALSE;
 
 static void
 desegment_tcp(tvbuff_t *tvb, packet_info *pinfo, int offset,
@@ -1739,6 +1943,24 @@ again:
 
         /* Else, find the most previous PDU starting before this sequence number */
         msp = se_tree_lookup32_le(tcpd->fwd->multisegment_pdus, seq-1);
+
+        /* The segments of an out-of-order PDU are added to it by
+         * tcp_ooo_segment(), so anything else that lands inside one is
+         * a retransmission of data we already have.
+         */
+        if (msp && (msp->flags & MSP_FLAGS_OUT_OF_ORDER)
+            && LE_SEQ(msp->seq, seq) && GT_SEQ(msp->nxtpdu, seq)) {
+            nbytes = (LT_SEQ(nxtseq, msp->nxtpdu) ? nxtseq : msp->nxtpdu) - seq;
+            proto_tree_add_bytes_format(tcp_tree, hf_tcp_data, tvb, offset,
+                nbytes, NULL, "Retransmitted TCP segment data (%u byte%s)", nbytes,
+                plurality(nbytes, "", "s"));
+            if (!LT_SEQ(msp->nxtpdu, nxtseq)) {
+                return;
+            }
+            offset += nbytes;
+            seq += nbytes;
+            goto again;
+        }
     }
 
     if (msp && msp->seq <= seq && msp->nxtpdu > seq) {
@@ -3986,6 +4208,310 @@ process_tcp_payload(tvbuff_t *tvb, volatile int offset, packet_info *pinfo,
     ENDTRY;
 }
 
+/*
+ * Out-of-order desegmentation.
+ *
+ * Without this a segment that arrives ahead of a gap is handed to the
+ * subdissector as if it started a PDU, and whatever PDU the gap was in
+ * is never put back together.  When "reassemble_out_of_order" is set,
+ * a segment beyond the highest sequence number seen so far that is not
+ * part of a PDU we already know about starts a multisegment PDU at the
+ * start of the gap instead.  Further segments are added to it until the
+ * gap is filled, at which point everything from the start of the gap to
+ * the highest byte seen is handed to the subdissector in one go.
+ *
+ * We give up on the gap if the other side ACKs data in it (we are not
+ * going to see it), or if the buffered data would exceed
+ * TCP_OOO_MAX_FLOW_BYTES.  There is no limit across flows, as a gap
+ * that is never ACKed (the stream ends, or only one direction was
+ * captured) would hold on to its share of such a limit for the rest
+ * of the capture.
+ */
+#define TCP_OOO_MAX_FLOW_BYTES  (1024*1024)
+
+/* What happened to out-of-order desegmentation in a frame, so that we
+ * can show the same thing when the frame is dissected again.
+ */
+struct tcp_ooo_frame {
+    struct tcp_multisegment_pdu *msp;   /* pdu the segment was added to */
+    struct tcp_multisegment_pdu *lost;  /* pdu given up on in this frame */
+};
+
+static struct tcp_ooo_frame *
+tcp_ooo_get_frame(tcp_flow_t *flow, packet_info *pinfo, gboolean create)
+{
+    struct tcp_ooo_frame *oof = NULL;
+
+    if (flow->ooo_frames) {
+        oof = se_tree_lookup32(flow->ooo_frames, PINFO_FD_NUM(pinfo));
+    }
+    if (!oof && create) {
+        if (!flow->ooo_frames) {
+            flow->ooo_frames = se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "tcp_ooo_frames");
+        }
+        oof = se_alloc0(sizeof(struct tcp_ooo_frame));
+        se_tree_insert32(flow->ooo_frames, PINFO_FD_NUM(pinfo), oof);
+    }
+    return oof;
+}
+
+/* Stop waiting for the gap in front of the pending pdu of a flow.  The
+ * segments buffered so far are never handed to a subdissector.
+ */
+static void
+tcp_ooo_give_up(packet_info *pinfo, tcp_flow_t *flow)
+{
+    struct tcp_multisegment_pdu *msp = flow->ooo_msp;
+
+    /* An empty pdu, so that later segments are not taken to be part of it */
+    msp->nxtpdu = msp->seq;
+    flow->ooo_msp = NULL;
+
+    tcp_ooo_get_frame(flow, pinfo, TRUE)->lost = msp;
+}
+
+static void
+tcp_ooo_print_lost(packet_info *pinfo, tvbuff_t *tvb, proto_tree *tcp_tree,
+                   struct tcp_multisegment_pdu *msp)
+{
+    proto_item *item;
+
+    item = proto_tree_add_text(tcp_tree, tvb, 0, 0,
+                               "Gap before out-of-order segments from frame %u was never filled",
+                               msp->first_frame);
+    PROTO_ITEM_SET_GENERATED(item);
+    expert_add_info_format(pinfo, item, PI_SEQUENCE, PI_WARN,
+                           "Gap before out-of-order segments from frame %u was never filled (segments not reassembled)",
+                           msp->first_frame);
+}
+
+/* An ACK for data in the gap means that it made it to the other side
+ * without us seeing it, so there is no point in waiting for it.  Also
+ * reports the gaps given up on in this frame, whether because of an
+ * ACK or because a segment of this frame would have gone over the
+ * buffering limit.
+ */
+static void
+tcp_ooo_check_acked(packet_info *pinfo, tvbuff_t *tvb, proto_tree *tcp_tree,
+                    struct tcp_analysis *tcpd, guint16 flags, guint32 ack)
+{
+    struct tcp_ooo_frame *oof;
+
+    if (!PINFO_FD_VISITED(pinfo)) {
+        if (tcpd->rev->ooo_msp && (flags & TH_ACK)
+            && GT_SEQ(ack, tcpd->rev->ooo_msp->seq)) {
+            tcp_ooo_give_up(pinfo, tcpd->rev);
+        }
+    }
+
+    oof = tcp_ooo_get_frame(tcpd->fwd, pinfo, FALSE);
+    if (oof && oof->lost) {
+        tcp_ooo_print_lost(pinfo, tvb, tcp_tree, oof->lost);
+    }
+    oof = tcp_ooo_get_frame(tcpd->rev, pinfo, FALSE);
+    if (oof && oof->lost) {
+        tcp_ooo_print_lost(pinfo, tvb, tcp_tree, oof->lost);
+    }
+}
+
+/* Returns TRUE if the segment was added to an out-of-order pdu, in which
+ * case the caller must not desegment it any further.
+ */
+static gboolean
+tcp_ooo_segment(tvbuff_t *tvb, packet_info *pinfo, int offset,
+                guint32 seq, guint32 nxtseq,
+                guint32 sport, guint32 dport,
+                proto_tree *tree, proto_tree *tcp_tree,
+                struct tcp_analysis *tcpd)
+{
+    struct tcpinfo *tcpinfo = pinfo->private_data;
+    tcp_flow_t *flow = tcpd->fwd;
+    struct tcp_multisegment_pdu *msp = NULL;
+    struct tcp_ooo_frame *oof;
+    fragment_data *ipfd_head;
+    proto_item *item;
+    guint32 start;
+    gint nbytes;
+    int save_can_desegment;
+
+    if (!PINFO_FD_VISITED(pinfo)) {
+        if (flow->ooo_msp && GT_SEQ(nxtseq, flow->ooo_msp->seq)) {
+            /* This segment fills (some of) the gap or adds to what
+             * we have buffered after it.
+             */
+            msp = flow->ooo_msp;
+            if (GT_SEQ(nxtseq, msp->nxtpdu)) {
+                if (nxtseq - msp->seq > TCP_OOO_MAX_FLOW_BYTES) {
+                    tcp_ooo_give_up(pinfo, flow);
+                    msp = NULL;
+                } else {
+                    msp->nxtpdu = nxtseq;
+                    fragment_set_tot_len(pinfo, msp->first_frame,
+                                         tcp_fragment_table, msp->nxtpdu - msp->seq);
+                }
+            }
+            if (msp) {
+                msp->last_frame = pinfo->fd->num;
+                msp->last_frame_time = pinfo->fd->abs_ts;
+            }
+        } else if (!flow->ooo_msp && flow->maxnextseq && GT_SEQ(seq, flow->maxnextseq)
+                   && !(flow->flags & TCP_FLOW_REASSEMBLE_UNTIL_FIN)) {
+            /* There is a gap in front of this segment.  If it is
+             * inside a pdu we already know about, the gap is handled
+             * by ordinary desegmentation, and if this segment starts
+             * right where a pdu ended the subdissector can start on it.
+             */
+            struct tcp_multisegment_pdu *prev;
+
+            start = flow->maxnextseq;
+            prev = se_tree_lookup32_le(flow->multisegment_pdus, seq-1);
+            if (prev && GT_SEQ(prev->nxtpdu, start)) {
+                start = prev->nxtpdu;
+            }
+            if (GT_SEQ(seq, start)
+                && nxtseq - start <= TCP_OOO_MAX_FLOW_BYTES) {
+                msp = pdu_store_sequencenumber_of_next_pdu(pinfo, start,
+                    nxtseq, flow->multisegment_pdus);
+                msp->flags |= MSP_FLAGS_OUT_OF_ORDER;
+                flow->ooo_msp = msp;
+            }
+        }
+
+        if (!flow->maxnextseq || GT_SEQ(nxtseq, flow->maxnextseq)) {
+            flow->maxnextseq = nxtseq;
+        }
+        if (!msp) {
+            return FALSE;
+        }
+        tcp_ooo_get_frame(flow, pinfo, TRUE)->msp = msp;
+    } else {
+        oof = tcp_ooo_get_frame(flow, pinfo, FALSE);
+        if (!oof || !oof->msp) {
+            return FALSE;
+        }
+        msp = oof->msp;
+    }
+
+    /* A segment that fills the end of the gap can start in front of the
+     * pdu, in data that belongs to a pdu we already knew about (the one
+     * "prev" was found for above) or that is a retransmission.  That
+     * part goes through ordinary desegmentation, the rest is added here.
+     */
+    if (LT_SEQ(seq, msp->seq)) {
+        tvbuff_t *head_tvb;
+        gint head_len = msp->seq - seq;
+
+        head_tvb = tvb_new_subset(tvb, offset,
+                                  MIN(head_len, tvb_length_remaining(tvb, offset)),
+                                  head_len);
+        save_can_desegment = pinfo->can_desegment;
+        desegment_tcp(head_tvb, pinfo, 0, seq, msp->seq, sport, dport,
+                      tree, tcp_tree, tcpd);
+        pinfo->can_desegment = save_can_desegment;
+        pinfo->desegment_offset = 0;
+        pinfo->desegment_len = 0;
+    }
+
+    start = GT_SEQ(seq, msp->seq) ? seq : msp->seq;
+    offset += start - seq;
+    ipfd_head = fragment_add(tvb, offset, pinfo, msp->first_frame,
+                             tcp_fragment_table, start - msp->seq, nxtseq - start,
+                             TRUE);
+    if (!PINFO_FD_VISITED(pinfo) && msp->first_frame == PINFO_FD_NUM(pinfo)) {
+        /* The first segment; now that there is a fragment head we can
+         * tell reassembly where the pdu ends.
+         */
+        fragment_set_tot_len(pinfo, msp->first_frame, tcp_fragment_table,
+                             msp->nxtpdu - msp->seq);
+    }
+
+    if (ipfd_head && ipfd_head->reassembled_in == PINFO_FD_NUM(pinfo)) {
+        tvbuff_t *next_tvb;
+
+        if (!PINFO_FD_VISITED(pinfo)) {
+            flow->ooo_msp = NULL;
+        }
+
+        /* create a new TVB structure for desegmented data */
+        next_tvb = tvb_new_child_real_data(tvb, ipfd_head->data,
+                                           ipfd_head->datalen,
+                                           ipfd_head->datalen);
+
+        /* add desegmented data to the data source list */
+        add_new_data_source(pinfo, next_tvb, "Reassembled TCP");
+
+        /*
+         * Supply the sequence number of the first of the
+         * reassembled bytes.
+         */
+        tcpinfo->seq = msp->seq;
+
+        /* indicate that this is reassembled data */
+        tcpinfo->is_reassembled = TRUE;
+
+        pinfo->desegment_offset = 0;
+        pinfo->desegment_len = 0;
+
+        /* call subdissector */
+        process_tcp_payload(next_tvb, 0, pinfo, tree, tcp_tree, sport,
+                            dport, 0, 0, FALSE, tcpd);
+
+        /* Did the subdissector stop at a pdu that continues beyond
+         * what we have?  If so the rest starts an ordinary
+         * multisegment pdu.
+         */
+        if (pinfo->desegment_len && !PINFO_FD_VISITED(pinfo)) {
+            struct tcp_multisegment_pdu *next_msp;
+            guint32 deseg_seq = msp->seq + pinfo->desegment_offset;
+
+            if (pinfo->desegment_len == DESEGMENT_UNTIL_FIN) {
+                flow->flags |= TCP_FLOW_REASSEMBLE_UNTIL_FIN;
+            }
+            /* The reassembled data may end after this segment does */
+            if ((msp->nxtpdu - deseg_seq) <= 1024*1024) {
+                if (pinfo->desegment_len == DESEGMENT_ONE_MORE_SEGMENT) {
+                    next_msp = pdu_store_sequencenumber_of_next_pdu(pinfo, deseg_seq,
+                        msp->nxtpdu+1, flow->multisegment_pdus);
+                    next_msp->flags |= MSP_FLAGS_REASSEMBLE_ENTIRE_SEGMENT;
+                } else {
+                    next_msp = pdu_store_sequencenumber_of_next_pdu(pinfo, deseg_seq,
+                        msp->nxtpdu+pinfo->desegment_len, flow->multisegment_pdus);
+                }
+                fragment_add(next_tvb, pinfo->desegment_offset, pinfo,
+                             next_msp->first_frame, tcp_fragment_table, 0,
+                             msp->nxtpdu - deseg_seq, TRUE);
+            }
+        }
+
+        nbytes = tvb_reported_length_remaining(tvb, offset);
+        proto_tree_add_bytes_format(tcp_tree, hf_tcp_data, tvb, offset,
+            nbytes, NULL, "TCP segment data (%u byte%s)", nbytes,
+            plurality(nbytes, "", "s"));
+
+        print_tcp_fragment_tree(ipfd_head, tree, tcp_tree, pinfo, next_tvb);
+    } else {
+        col_set_str(pinfo->cinfo, COL_PROTOCOL, "TCP");
+        col_set_str(pinfo->cinfo, COL_INFO, "[TCP segment of a reassembled PDU]");
+
+        nbytes = tvb_reported_length_remaining(tvb, offset);
+        proto_tree_add_bytes_format(tcp_tree, hf_tcp_data, tvb, offset,
+            nbytes, NULL, "Out-of-order TCP segment data (%u byte%s)", nbytes,
+            plurality(nbytes, "", "s"));
+
+        if (ipfd_head && ipfd_head->reassembled_in != 0) {
+            item = proto_tree_add_uint(tcp_tree, hf_tcp_reassembled_in, tvb, 0,
+                                       0, ipfd_head->reassembled_in);
+            PROTO_ITEM_SET_GENERATED(item);
+        }
+    }
+
+    pinfo->can_desegment = 0;
+    pinfo->desegment_offset = 0;
+    pinfo->desegment_len = 0;
+
+    return TRUE;
+}
+
 void
 dissect_tcp_payload(tvbuff_t *tvb, packet_info *pinfo, int offset, guint32 seq,
             guint32 nxtseq, guint32 sport, guint32 dport,
@@ -3997,6 +4523,11 @@ dissect_tcp_payload(tvbuff_t *tvb, packet_info *pinfo, int offset, guint32 seq,
     /* Can we desegment this segment? */
     if (pinfo->can_desegment) {
         /* Yes. */
+        if (tcp_reassemble_out_of_order && tcpd &&
+            tcp_ooo_segment(tvb, pinfo, offset, seq, nxtseq, sport, dport,
+                            tree, tcp_tree, tcpd)) {
+            return;
+        }
         desegment_tcp(tvb, pinfo, offset, seq, nxtseq, sport, dport, tree,
                       tcp_tree, tcpd);
     } else {
@@ -4648,6 +5179,9 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 
     tap_queue_packet(tcp_tap, pinfo, tcph);
 
+    if (tcp_reassemble_out_of_order && tcpd && tcph->th_have_seglen) {
+        tcp_ooo_check_acked(pinfo, tvb, tcp_tree, tcpd, tcph->th_flags, tcph->th_ack);
+    }
 
     /* A FIN packet might complete reassembly so we need to explicitly
      * check for this here.
@@ -4756,6 +5290,11 @@ tcp_init(void)
 {
     tcp_stream_index = 0;
     fragment_table_init(&tcp_fragment_table);
+
+    if (tcp_unacked_bufs) {
+        g_hash_table_destroy(tcp_unacked_bufs);
+    }
+    tcp_unacked_bufs = g_hash_table_new_full(g_direct_hash, g_direct_equal, g_free, NULL);
 }
 
 void
@@ -5555,6 +6094,12 @@ proto_register_tcp(void)
         "Allow subdissector to reassemble TCP streams",
         "Whether subdissector can request TCP streams to be reassembled",
         &tcp_desegment);
+    prefs_register_bool_preference(tcp_module, "reassemble_out_of_order",
+        "Reassemble out-of-order segments",
+        "Whether out-of-order segments should be held back until the gap in front of them is filled "
+        "instead of being handed to the subdissector as they arrive. Up to 1 MB is buffered per direction. "
+        "To use this option you must also enable \"Allow subdissector to reassemble TCP streams\".",
+        &tcp_reassemble_out_of_order);
     prefs_register_bool_preference(tcp_module, "analyze_sequence_numbers",
         "Analyze TCP sequence numbers",
         "Make the TCP dissector analyze TCP sequence numbers to find and flag segment retransmissions, missing segments and RTT",
@@ -105,13 +105,31 @@ extern struct tcp_multisegment_pdu *
 pdu_store_sequencenumber_of_next_pdu(packet_info *pinfo, guint32 seq, guint32 nxtpdu, emem_tree_t *multisegment_pdus);
 
 typedef struct _tcp_unacked_t {
-	struct _tcp_unacked_t *next;
 	guint32 frame;
 	guint32	seq;
 	guint32	nextseq;
 	nstime_t ts;
 } tcp_unacked_t;
 
+/* The segments sent in one direction that have not been ACKed yet.
+ * They are kept in a ring buffer sorted by sequence number relative to
+ * 'base', so that a cumulative ACK releases a run of segments from the
+ * front of the ring and the bytes in flight can be read off both ends.
+ * If the segments ever span too much of the sequence space to be sorted
+ * unambiguously, 'unordered' is set and they are kept in arrival order
+ * until the ring drains.
+ */
+typedef struct _tcp_unacked_ring_t {
+	tcp_unacked_t *buf;	/* 'size' entries, a power of 2 */
+	guint32 size;
+	guint32 head;		/* index of the first segment */
+	guint32 count;		/* number of segments in the ring */
+	guint32 base;		/* seq the sort order is relative to */
+	guint32 hi;		/* upper bound of nextseq-base of all segments */
+	guint32 maxlen;		/* upper bound of nextseq-seq of all segments */
+	gboolean unordered;
+} tcp_unacked_ring_t;
+
 struct tcp_acked {
 	guint32 frame_acked;
 	nstime_t ts;
@@ -136,13 +154,14 @@ struct tcp_multisegment_pdu {
 	nstime_t last_frame_time;
 	guint32 flags;
 #define MSP_FLAGS_REASSEMBLE_ENTIRE_SEGMENT	0x00000001
+#define MSP_FLAGS_OUT_OF_ORDER	0x00000002	/* started with a segment that arrived ahead of a gap */
 };
 
 typedef struct _tcp_flow_t {
 	guint32 base_seq;		/* base seq number (used by relative sequence numbers)
 							 * or 0 if not yet known.
 							 */
-	tcp_unacked_t *segments;
+	tcp_unacked_ring_t segments;	/* segments not yet ACKed */
 	guint32 lastack;		/* last seen ack */
 	nstime_t lastacktime;	/* Time of the last ack packet */
 	guint32 lastnondupack;	/* frame number of last seen non dupack */
@@ -176,6 +195,13 @@ typedef struct _tcp_flow_t {
 	 */
 	emem_tree_t *multisegment_pdus;
 
+	/* Out-of-order desegmentation, only used when the
+	 * reassemble_out_of_order preference is set.
+	 */
+	guint32 maxnextseq;	/* highest nextseq handed to desegmentation, 0 if not yet known */
+	struct tcp_multisegment_pdu *ooo_msp;	/* pdu waiting for the gap before it to be filled */
+	emem_tree_t *ooo_frames;	/* indexed by frame number, see tcp_ooo_get_frame() */
+
 	/* Process info, currently discovered via IPFIX */
 	guint32 process_uid;    /* UID of local process */
 	guint32 process_pid;    /* PID of local process */
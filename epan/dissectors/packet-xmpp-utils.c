@@ -802,8 +802,15 @@ proto_item_get_text(proto_item *item)
     if(fi==NULL)
         return NULL;
 
-    if (fi->rep == NULL)
-        return NULL;
+    if (fi->rep == NULL) {
+        if (fi->deferred_rep == NULL)
+            return NULL;
+
+        /* The label hasn't been rendered yet */
+        result = ep_alloc(ITEM_LABEL_LENGTH);
+        proto_item_fill_label(fi, result);
+        return result;
+    }
 
 
     result = ep_strdup(fi->rep->representation);
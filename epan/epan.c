@@ -233,6 +233,32 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 		ep_free_all();
 }
 
+void
+epan_dissect_reset(epan_dissect_t* edt)
+{
+	g_assert(edt);
+
+	g_slist_free(edt->pi.dependent_frames);
+	edt->pi.dependent_frames = NULL;
+
+	/* Free the data sources list. */
+	free_data_sources(&edt->pi);
+
+	/* Free all tvb's chained from this tvb */
+	tvb_free_chain(edt->tvb);
+	edt->tvb = NULL;
+
+	/* Empty the tree, but keep it (and its memory) for the next packet */
+	if (edt->tree) {
+		proto_tree_reset(edt->tree);
+	}
+
+	/* We're still counted in edt_refs; if nobody else is, the
+	 * packet-scoped memory can go. */
+	if (edt_refs == 1)
+		ep_free_all();
+}
+
 void
 epan_dissect_free(epan_dissect_t* edt)
 {
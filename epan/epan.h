@@ -166,6 +166,14 @@ epan_dissect_fill_in_columns(epan_dissect_t *edt, const gboolean fill_col_exprs,
 void
 epan_dissect_cleanup(epan_dissect_t* edt);
 
+/** releases the resources attached to the packet dissection, like
+ * epan_dissect_cleanup(), but leaves it ready for the next packet
+ * dissection with the same settings, holding on to its protocol tree's
+ * memory. Use this instead of cleaning up and initializing again when
+ * dissecting one packet after another. */
+void
+epan_dissect_reset(epan_dissect_t* edt);
+
 /** free a single packet dissection */
 void
 epan_dissect_free(epan_dissect_t* edt);
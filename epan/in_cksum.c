@@ -62,6 +62,7 @@ in_cksum(const vec_t *vec, int veclen)
 	register int sum = 0;
 	register int mlen = 0;
 	int byte_swapped = 0;
+	guint64 lsum;
 
 	union {
 		guint8	c[2];
@@ -103,22 +104,37 @@ in_cksum(const vec_t *vec, int veclen)
 			byte_swapped = 1;
 		}
 		/*
-		 * Unroll the loop to make overhead from
-		 * branches &c small.
+		 * Force to a 4-byte boundary, and add up 32-bit words
+		 * into a 64-bit sum; the one's complement sum of the
+		 * two 16-bit halves of a word is the same as that of
+		 * the word with its carries folded back in (RFC 1071).
+		 * Unroll the loop to make overhead from branches &c
+		 * small.
 		 */
-		while ((mlen -= 32) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			sum += w[4]; sum += w[5]; sum += w[6]; sum += w[7];
-			sum += w[8]; sum += w[9]; sum += w[10]; sum += w[11];
-			sum += w[12]; sum += w[13]; sum += w[14]; sum += w[15];
-			w += 16;
+		if ((2 & (unsigned long) w) && (mlen >= 2)) {
+			sum += *w++;
+			mlen -= 2;
 		}
-		mlen += 32;
-		while ((mlen -= 8) >= 0) {
-			sum += w[0]; sum += w[1]; sum += w[2]; sum += w[3];
-			w += 4;
+		if (mlen >= 4) {
+			const guint32 *lw = (const guint32 *)(const void *)w;
+
+			lsum = 0;
+			while ((mlen -= 32) >= 0) {
+				lsum += lw[0]; lsum += lw[1]; lsum += lw[2]; lsum += lw[3];
+				lsum += lw[4]; lsum += lw[5]; lsum += lw[6]; lsum += lw[7];
+				lw += 8;
+			}
+			mlen += 32;
+			while ((mlen -= 4) >= 0) {
+				lsum += *lw++;
+			}
+			mlen += 4;
+			w = (const guint16 *)(const void *)lw;
+			lsum = (lsum & 0xffffffff) + (lsum >> 32);
+			lsum = (lsum & 0xffff) + ((lsum >> 16) & 0xffff) + (lsum >> 32);
+			REDUCE;
+			sum += (int)lsum;
 		}
-		mlen += 8;
 		if (mlen == 0 && byte_swapped == 0)
 			continue;
 		REDUCE;
@@ -144,6 +144,9 @@ init_dissection(void)
 
 	/* Initialize the expert infos */
 	expert_init();
+
+	/* Forget any decompressed data from the previous session */
+	tvb_uncompress_cache_clear();
 }
 
 void
@@ -169,6 +172,9 @@ cleanup_dissection(void)
 
 	/* Initialize the expert infos */
 	expert_cleanup();
+
+	/* Free the decompressed data cache */
+	tvb_uncompress_cache_clear();
 }
 
 /* Allow protocols to register a "cleanup" routine to be
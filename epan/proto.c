@@ -141,8 +141,8 @@ wrs_count_bitshift(const guint32 bitmask)
 #define TRY_TO_FAKE_THIS_REPR(tree, pi)
 #endif
 
-static gboolean
-proto_tree_free_node(proto_node *node, gpointer data);
+static void
+free_node_tree_data(tree_data_t *tree_data);
 
 static void fill_label_boolean(field_info *fi, gchar *label_str);
 static void fill_label_uint(field_info *fi, gchar *label_str);
@@ -150,6 +150,8 @@ static void fill_label_uint64(field_info *fi, gchar *label_str);
 static void fill_label_bitfield(field_info *fi, gchar *label_str);
 static void fill_label_int(field_info *fi, gchar *label_str);
 static void fill_label_int64(field_info *fi, gchar *label_str);
+static void label_fill_default(field_info *fi, gchar *label_str);
+static void label_materialize(proto_item *pi, field_info *fi);
 
 static const char* hfinfo_uint_vals_format(const header_field_info *hfinfo);
 static const char* hfinfo_uint_format(const header_field_info *hfinfo);
@@ -243,6 +245,10 @@ proto_item_add_bitmask_tree(proto_item *item, tvbuff_t *tvb, const int offset,
 
 static int proto_register_field_init(header_field_info *hfinfo, const int parent);
 
+static const char *hf_match_strval(const guint32 val, const header_field_info *hfinfo);
+static const char *hf_val_to_str(const guint32 val, const header_field_info *hfinfo, const char *fmt);
+static const char *hf_val_to_str_const(const guint32 val, const header_field_info *hfinfo, const char *unknown_str);
+
 /* special-case header field used within proto.c */
 int hf_text_only = -1;
 
@@ -264,38 +270,165 @@ static GList *protocols = NULL;
 
 #define INITIAL_NUM_PROTOCOL_HFINFO	1500
 
-/* Contains information about a field when a dissector calls
- * proto_tree_add_item.  */
-static struct ws_memory_slab field_info_slab =
-	WS_MEMORY_SLAB_INIT(field_info, 128);
-
-static field_info *field_info_tmp = NULL;
-#define FIELD_INFO_NEW(fi)					\
-	fi = sl_alloc(&field_info_slab)
-#define FIELD_INFO_FREE(fi)					\
-	sl_free(&field_info_slab, fi)
-
-/* Contains the space for proto_nodes. */
+/* Root nodes of protocol trees; every other node of a tree, with its
+ * field_info and label, is allocated from the tree's arena (below). */
 static struct ws_memory_slab proto_node_slab =
 	WS_MEMORY_SLAB_INIT(proto_node, 128);
 
-#define PROTO_NODE_NEW(node)				\
-	node = sl_alloc(&proto_node_slab); \
+#define PROTO_NODE_INIT(node)				\
 	node->first_child = NULL;			\
 	node->last_child = NULL;			\
 	node->next = NULL;
 
-#define PROTO_NODE_FREE(node)				\
+#define PROTO_ROOT_NEW(node)				\
+	node = sl_alloc(&proto_node_slab);		\
+	PROTO_NODE_INIT(node)
+
+#define PROTO_ROOT_FREE(node)				\
 	sl_free(&proto_node_slab, node)
 
+#define PROTO_NODE_NEW(tree_data, node)			\
+	node = tree_arena_alloc(tree_data, sizeof(proto_node)); \
+	PROTO_NODE_INIT(node)
+
+/* Contains information about a field when a dissector calls
+ * proto_tree_add_item.  */
+#define FIELD_INFO_NEW(tree_data, fi)			\
+	fi = tree_arena_alloc(tree_data, sizeof(field_info))
+
 /* String space for protocol and field items for the GUI */
-static struct ws_memory_slab item_label_slab =
-	WS_MEMORY_SLAB_INIT(item_label_t, 128);
+#define ITEM_LABEL_NEW(tree_data, il)			\
+	il = tree_arena_alloc(tree_data, sizeof(item_label_t))
+
+/*
+ * Memory that lives exactly as long as a tree (its nodes, field_infos
+ * and labels, the field_info lists of the interesting fields, deferred
+ * label text) comes from a bump allocator hung off the tree_data_t and
+ * is released all at once when the tree is freed or reset; nothing is
+ * freed node by node.  Released chunks are kept for the next tree, so
+ * that dissecting packet after packet doesn't keep going back to malloc.
+ */
+#define TREE_ARENA_CHUNK_SIZE	(16 * 1024)
+#define TREE_ARENA_MAX_SPARE	64
+
+typedef struct _tree_arena_chunk {
+	struct _tree_arena_chunk *next;
+	gsize                     size;	/* usable bytes after the header */
+	gsize                     used;
+} tree_arena_chunk_t;
+
+#define TREE_ARENA_HEADER_SIZE \
+	((sizeof(tree_arena_chunk_t) + (WS_MEM_ALIGN - 1)) & ~(WS_MEM_ALIGN - 1))
+
+static tree_arena_chunk_t *tree_arena_spare = NULL;
+static guint               tree_arena_spare_count = 0;
+
+/*
+ * Field values that own memory (strings, byte arrays, ...) must still
+ * have it freed before the arena is released, so the trees keep a list
+ * of them, in the arena as well.
+ */
+typedef struct _tree_fvalue_link {
+	struct _tree_fvalue_link *next;
+	fvalue_t                 *fv;
+} tree_fvalue_link_t;
+
+static void *
+tree_arena_alloc(tree_data_t *tree_data, gsize size)
+{
+	tree_arena_chunk_t *chunk = tree_data->arena;
+	void               *p;
+
+	size = (size + (WS_MEM_ALIGN - 1)) & ~(WS_MEM_ALIGN - 1);
+
+	if (chunk == NULL || chunk->used + size > chunk->size) {
+		if (tree_arena_spare != NULL &&
+		    size <= TREE_ARENA_CHUNK_SIZE - TREE_ARENA_HEADER_SIZE) {
+			chunk = tree_arena_spare;
+			tree_arena_spare = chunk->next;
+			tree_arena_spare_count--;
+		} else {
+			gsize chunk_size = MAX(TREE_ARENA_CHUNK_SIZE,
+					       TREE_ARENA_HEADER_SIZE + size);
+
+			chunk = g_malloc(chunk_size);
+			chunk->size = chunk_size - TREE_ARENA_HEADER_SIZE;
+		}
+		chunk->used = 0;
+		chunk->next = tree_data->arena;
+		tree_data->arena = chunk;
+	}
+
+	p = (guint8 *)chunk + TREE_ARENA_HEADER_SIZE + chunk->used;
+	chunk->used += size;
+	return p;
+}
 
-#define ITEM_LABEL_NEW(il)				\
-	il = sl_alloc(&item_label_slab);
-#define ITEM_LABEL_FREE(il)				\
-	sl_free(&item_label_slab, il);
+static void
+tree_arena_free(tree_data_t *tree_data)
+{
+	tree_arena_chunk_t *chunk, *next;
+
+	for (chunk = tree_data->arena; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		if (tree_arena_spare_count < TREE_ARENA_MAX_SPARE &&
+		    chunk->size == TREE_ARENA_CHUNK_SIZE - TREE_ARENA_HEADER_SIZE) {
+			chunk->next = tree_arena_spare;
+			tree_arena_spare = chunk;
+			tree_arena_spare_count++;
+		} else
+			g_free(chunk);
+	}
+	tree_data->arena = NULL;
+	tree_data->fvalues = NULL;
+}
+
+static void
+tree_arena_free_spare(void)
+{
+	tree_arena_chunk_t *chunk;
+
+	while ((chunk = tree_arena_spare) != NULL) {
+		tree_arena_spare = chunk->next;
+		g_free(chunk);
+	}
+	tree_arena_spare_count = 0;
+}
+
+/*
+ * Every field a filter has been primed with gets a small "interesting
+ * slot" number, so that each tree can find the field_infos of such a
+ * field by indexing a short array rather than through a hash table.
+ * Slot 0 means "none".  Filters hold a reference to the slots of their
+ * fields (see proto_hold_interesting_hfid()), and a slot is handed out
+ * again once the last filter holding it is freed, so the index stays as
+ * small as the set of fields the current filters use.
+ */
+typedef struct {
+	gint  hfid;     /* -1 if the slot is free */
+	guint refs;     /* number of filters holding the slot */
+} interesting_slot_t;
+
+static guint  *interesting_slot_by_hfid     = NULL;
+static guint   interesting_slot_by_hfid_len = 0;
+static GArray *interesting_slots            = NULL;
+
+#define INTERESTING_SLOT(hfid) \
+	((guint)(hfid) < interesting_slot_by_hfid_len ? interesting_slot_by_hfid[hfid] : 0)
+
+/*
+ * The field_infos of one interesting field in a tree.  It starts out
+ * like a GPtrArray, so proto_get_finfo_ptr_array() can hand it out and
+ * its callers can keep using len, pdata and g_ptr_array_index() on it,
+ * but its storage comes from the tree arena: it must never be passed to
+ * the g_ptr_array_*() functions.
+ */
+typedef struct {
+	gpointer *pdata;
+	guint     len;
+	guint     alloc;
+	gint      hfid;	/* the slot may have changed hands since */
+} interesting_finfos_t;
 
 #define PROTO_REGISTRAR_GET_NTH(hfindex, hfinfo) \
 	DISSECTOR_ASSERT((guint)hfindex < gpa_hfinfo.len); \
@@ -309,6 +442,40 @@ typedef struct _gpa_hfinfo_t {
 } gpa_hfinfo_t;
 gpa_hfinfo_t gpa_hfinfo;
 
+/*
+ * Fields with a plain value_string get an index for it the first time a
+ * value is looked up, so that labels and column values don't have to scan
+ * the array linearly.  Fields that share an array share its index; arrays
+ * too short to be worth it get a NULL index.
+ *
+ * Only arrays that some field was registered with are indexed, as, like
+ * the arrays behind a value_string_ext, they are expected to stay as they
+ * are for as long as the field exists.  Arrays that dissectors build and
+ * rebuild at run time and hand to a field later (e.g. DCE/RPC's opnums)
+ * are looked up linearly, as the index of the old array can't be told
+ * apart from that of a new array that happens to get the same address.
+ * The shared indexes are keyed on the array's length and contents as well
+ * as its address, so an array registered for a new field at the address
+ * of one that has been freed gets an index of its own.
+ */
+#define VS_INDEX_MIN_ENTRIES 16
+
+typedef struct {
+	const void             *strings;	/* hfinfo->strings when indexed */
+	const value_string_ext *vse;
+} vs_index_t;
+
+typedef struct {
+	const value_string *vs;
+	guint               num_entries;
+	guint               hash;	/* of the values and string pointers */
+} vs_index_key_t;
+
+static vs_index_t *vs_index_by_hfid     = NULL;
+static guint       vs_index_by_hfid_len = 0;
+static GHashTable *vs_indexes           = NULL;	/* vs_index_key_t -> value_string_ext */
+static GHashTable *vs_registered        = NULL;	/* value_strings fields were registered with */
+
 /* Balanced tree of abbreviations and IDs */
 static GTree *gpa_name_tree = NULL;
 static header_field_info *same_name_hfinfo;
@@ -422,9 +589,26 @@ proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_da
 	tree_is_expanded = g_new0(gboolean, num_tree_types);
 }
 
+static void
+free_vs_index(gpointer key, gpointer value, gpointer user_data _U_)
+{
+	vs_index_key_t   *vs_key = key;
+	value_string_ext *vse    = value;
+
+	if (vse != NULL) {
+		/* An unsorted array was indexed through a sorted copy */
+		if (VALUE_STRING_EXT_VS_P(vse) != vs_key->vs)
+			g_free((gpointer) VALUE_STRING_EXT_VS_P(vse));
+		g_free(vse);
+	}
+	g_free(vs_key);
+}
+
 void
 proto_cleanup(void)
 {
+	tree_arena_free_spare();
+
 	/* Free the abbrev/ID GTree */
 	if (gpa_name_tree) {
 		g_tree_destroy(gpa_name_tree);
@@ -466,6 +650,27 @@ proto_cleanup(void)
 	}
 	g_free(tree_is_expanded);
 	tree_is_expanded = NULL;
+
+	g_free(interesting_slot_by_hfid);
+	interesting_slot_by_hfid = NULL;
+	interesting_slot_by_hfid_len = 0;
+
+	g_free(vs_index_by_hfid);
+	vs_index_by_hfid = NULL;
+	vs_index_by_hfid_len = 0;
+	if (vs_indexes) {
+		g_hash_table_foreach(vs_indexes, free_vs_index, NULL);
+		g_hash_table_destroy(vs_indexes);
+		vs_indexes = NULL;
+	}
+	if (vs_registered) {
+		g_hash_table_destroy(vs_registered);
+		vs_registered = NULL;
+	}
+	if (interesting_slots) {
+		g_array_free(interesting_slots, TRUE);
+		interesting_slots = NULL;
+	}
 }
 
 static gboolean
@@ -540,14 +745,23 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 void
 proto_tree_free(proto_tree *tree)
 {
-	proto_tree_traverse_post_order(tree, proto_tree_free_node, NULL);
+	free_node_tree_data(PTREE_DATA(tree));
+	g_free(PTREE_DATA(tree));
+	PROTO_ROOT_FREE(tree);
+}
+
+/* Empties a proto_tree so that it can be used for the next dissection,
+   keeping its visibility settings and, for reuse, its memory. */
+void
+proto_tree_reset(proto_tree *tree)
+{
+	free_node_tree_data(PTREE_DATA(tree));
+	PROTO_NODE_INIT(tree);
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+unreference_interesting_hfid(gint hfid)
 {
-	GPtrArray         *ptrs = value;
-	gint               hfid = (gint)(long)key;
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
@@ -563,84 +777,34 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		}
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
-
-	g_ptr_array_free(ptrs, TRUE);
 }
 
+/* Release everything the tree's items hold; the tree_data_t and the
+   root node themselves are left alone. */
 static void
 free_node_tree_data(tree_data_t *tree_data)
 {
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
-	}
-
-	/* And finally the tree_data_t itself. */
-	g_free(tree_data);
-}
+	tree_fvalue_link_t *link;
+	interesting_finfos_t *ptrs;
+	guint slot;
 
-#define FREE_NODE_FIELD_INFO(finfo)	\
-	if (finfo->rep) {			\
-		ITEM_LABEL_FREE(finfo->rep);	\
-	}				\
-	FVALUE_CLEANUP(&finfo->value);	\
-	FIELD_INFO_FREE(finfo);
+	for (link = tree_data->fvalues; link != NULL; link = link->next)
+		FVALUE_CLEANUP(link->fv);
 
-static gboolean
-proto_tree_free_node(proto_node *node, gpointer data _U_)
-{
-	field_info *finfo  = PNODE_FINFO(node);
-#if 0
-	proto_node *parent = node->parent;
-#endif
-
-	if (finfo == NULL) {
-		/* This is the root node. Destroy the per-tree data.
-		 * There is no field_info to destroy. */
-		if (PTREE_DATA(node))
-			free_node_tree_data(PTREE_DATA(node));
-	}
-	else {
-		/* This is a child node. Don't free the per-tree data, but
-		 * do free the field_info data. */
-		FREE_NODE_FIELD_INFO(finfo);
-	}
-
-#if 0
-	/* NOTE: This code is required when this function is used to free individual
-	 * nodes only. Current use is for the destruction of complete trees, so the
-	 * inconsistancies have no ill effect.
-	 */
-	/* Remove node from parent */
-	if (parent) {
-		proto_item *prev_item = NULL;
-		if (parent->first_child == node) {
-			parent->first_child = node->next;
-		} else {
-			/* find previous and change its next */
-			for (prev_item = parent->first_child; prev_item; prev_item = prev_item->next) {
-				if (prev_item->next == node) {
-					break;
-				}
-			}
-			DISSECTOR_ASSERT(prev_item);
-			prev_item->next = node->next;
-		}
-		/* fix last_child if required */
-		if (parent->last_child == node) {
-			parent->last_child = prev_item;
+	if (tree_data->interesting_hfids) {
+		/* The field_info lists live in the arena; just drop the
+		 * filter references of the fields that were seen. */
+		for (slot = 1; slot < tree_data->interesting_count; slot++) {
+			ptrs = (interesting_finfos_t *)tree_data->interesting_hfids[slot];
+			if (ptrs != NULL)
+				unreference_interesting_hfid(ptrs->hfid);
 		}
+		tree_data->interesting_hfids = NULL;
+		tree_data->interesting_count = 0;
 	}
-	DISSECTOR_ASSERT(node->first_child == NULL && node->last_child == NULL);
-#endif
-	/* Free the proto_node. */
-	PROTO_NODE_FREE(node);
 
-	return FALSE; /* FALSE = do not end traversal of protocol tree */
+	tree_arena_free(tree_data);
+	tree_data->count = 0;
 }
 
 /* Is the parsing being done for a visible proto_tree or an invisible one?
@@ -1163,35 +1327,70 @@ get_int_value(tvbuff_t *tvb, gint offset, gint length, const guint encoding)
 	return value;
 }
 
-static GPtrArray *
+static interesting_finfos_t *
 proto_lookup_or_create_interesting_hfids(proto_tree *tree,
 					 header_field_info *hfinfo)
 {
-	GPtrArray *ptrs = NULL;
+	tree_data_t          *tree_data;
+	interesting_finfos_t *ptrs = NULL;
+	GPtrArray           **hfids;
+	guint                 slot;
 
 	DISSECTOR_ASSERT(tree);
 	DISSECTOR_ASSERT(hfinfo);
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		if (PTREE_DATA(tree)->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			PTREE_DATA(tree)->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
+		tree_data = PTREE_DATA(tree);
+		slot = INTERESTING_SLOT(hfinfo->id);
+		DISSECTOR_ASSERT(slot != 0);
+
+		if (slot >= tree_data->interesting_count) {
+			/* Initialize (or grow) the index because we now know
+			 * that it is needed; it covers every slot handed out
+			 * so far. */
+			hfids = tree_arena_alloc(tree_data,
+				interesting_slots->len * sizeof(GPtrArray *));
+			memset(hfids, 0, interesting_slots->len * sizeof(GPtrArray *));
+			if (tree_data->interesting_hfids != NULL) {
+				memcpy(hfids, tree_data->interesting_hfids,
+				       tree_data->interesting_count * sizeof(GPtrArray *));
+			}
+			tree_data->interesting_hfids = hfids;
+			tree_data->interesting_count = interesting_slots->len;
 		}
 
-		ptrs = g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
-		if (!ptrs) {
+		ptrs = (interesting_finfos_t *)tree_data->interesting_hfids[slot];
+		if (!ptrs || ptrs->hfid != hfinfo->id) {
 			/* First element triggers the creation of pointer array */
-			ptrs = g_ptr_array_new();
-			g_hash_table_insert(PTREE_DATA(tree)->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+			ptrs = tree_arena_alloc(tree_data, sizeof(interesting_finfos_t));
+			ptrs->pdata = NULL;
+			ptrs->len   = 0;
+			ptrs->alloc = 0;
+			ptrs->hfid  = hfinfo->id;
+			tree_data->interesting_hfids[slot] = (GPtrArray *)ptrs;
 		}
 	}
 
 	return ptrs;
 }
 
+/* Append a field_info to the list of an interesting field. */
+static void
+interesting_finfos_add(proto_tree *tree, interesting_finfos_t *ptrs,
+		       field_info *fi)
+{
+	gpointer *pdata;
+
+	if (ptrs->len == ptrs->alloc) {
+		ptrs->alloc = ptrs->alloc ? ptrs->alloc * 2 : 4;
+		pdata = tree_arena_alloc(PTREE_DATA(tree), ptrs->alloc * sizeof(gpointer));
+		if (ptrs->len)
+			memcpy(pdata, ptrs->pdata, ptrs->len * sizeof(gpointer));
+		ptrs->pdata = pdata;
+	}
+	ptrs->pdata[ptrs->len++] = fi;
+}
+
 /* Add an item to a proto_tree, using the text label registered to that item;
    the item is extracted from the tvbuff handed to it. */
 static proto_item *
@@ -1206,29 +1405,12 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 	double	    doubleval;
 	const char *string;
 	nstime_t    time_stamp;
-	GPtrArray  *ptrs;
+	interesting_finfos_t *ptrs;
 
-	/* there is a possibility here that we might raise an exception
-	 * and thus would lose track of the field_info.
-	 * store it in a temp so that if we come here again we can reclaim
-	 * the field_info without leaking memory.
-	 */
-	/* XXX this only keeps track of one field_info struct,
-	   if we ever go multithreaded for calls to this function
-	   we have to change this code to use per thread variable.
-	*/
-	if (field_info_tmp) {
-		/* oops, last one we got must have been lost due
-		 * to an exception.
-		 * good thing we saved it, now we can reverse the
-		 * memory leak and reclaim it.
-		 */
-		FIELD_INFO_FREE(field_info_tmp);
-	}
-	/* we might throw an exception, keep track of this one
-	 * across the "dangerous" section below.
-	*/
-	field_info_tmp = new_fi;
+	/* We might raise an exception below and lose track of new_fi;
+	 * that's harmless, as it lives in the tree's arena, and its
+	 * value (if it owns any memory) is on the tree's list of values
+	 * to clean up. */
 
 	switch (new_fi->hfinfo->type) {
 		case FT_NONE:
@@ -1677,16 +1859,11 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 	 * raised by a tvbuff access method doesn't leave junk in the proto_tree. */
 	pi = proto_tree_add_node(tree, new_fi);
 
-	/* we did not raise an exception so we dont have to remember this
-	 * field_info struct any more.
-	 */
-	field_info_tmp = NULL;
-
 	/* If the proto_tree wants to keep a record of this finfo
 	 * for quick lookup, then record it. */
 	ptrs = proto_lookup_or_create_interesting_hfids(tree, new_fi->hfinfo);
 	if (ptrs)
-		g_ptr_array_add(ptrs, new_fi);
+		interesting_finfos_add(tree, ptrs, new_fi);
 
 	return pi;
 }
@@ -2580,6 +2757,10 @@ proto_item_append_string(proto_item *pi, const char *str)
 		return;
 	}
 	DISSECTOR_ASSERT(hfinfo->type == FT_STRING || hfinfo->type == FT_STRINGZ);
+	/* A label rendered when text was appended to it kept the old
+	 * value; render a deferred one now, so that it does too. */
+	if (fi->rep == NULL && fi->deferred_rep != NULL)
+		label_materialize(pi, fi);
 	old_str = fvalue_get(&fi->value);
 	new_str = ep_strdup_printf("%s%s", old_str, str);
 	fvalue_set(&fi->value, new_str, FALSE);
@@ -3354,7 +3535,7 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 	DISSECTOR_ASSERT(tfi == NULL ||
 		(tfi->tree_type >= 0 && tfi->tree_type < num_tree_types));
 
-	PROTO_NODE_NEW(pnode);
+	PROTO_NODE_NEW(PTREE_DATA(tree), pnode);
 	pnode->parent = tnode;
 	PNODE_FINFO(pnode) = fi;
 	pnode->tree_data = PTREE_DATA(tree);
@@ -3380,7 +3561,7 @@ proto_tree_add_pi(proto_tree *tree, int hfindex, tvbuff_t *tvb, gint start,
 {
 	proto_item *pi;
 	field_info *fi;
-	GPtrArray  *ptrs;
+	interesting_finfos_t *ptrs;
 
 	if (!tree)
 		return NULL;
@@ -3392,7 +3573,7 @@ proto_tree_add_pi(proto_tree *tree, int hfindex, tvbuff_t *tvb, gint start,
 	 * for quick lookup, then record it. */
 	ptrs = proto_lookup_or_create_interesting_hfids(tree, fi->hfinfo);
 	if (ptrs)
-		g_ptr_array_add(ptrs, fi);
+		interesting_finfos_add(tree, ptrs, fi);
 
 	/* Does the caller want to know the fi pointer? */
 	if (pfi) {
@@ -3541,9 +3722,10 @@ static field_info *
 new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	       const gint start, const gint item_length)
 {
-	field_info *fi;
+	tree_data_t *tree_data = PTREE_DATA(tree);
+	field_info  *fi;
 
-	FIELD_INFO_NEW(fi);
+	FIELD_INFO_NEW(tree_data, fi);
 
 	fi->hfinfo     = hfinfo;
 	fi->start      = start;
@@ -3554,7 +3736,16 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	if (!PTREE_DATA(tree)->visible)
 		FI_SET_FLAG(fi, FI_HIDDEN);
 	fvalue_init(&fi->value, fi->hfinfo->type);
+	if (fi->value.ftype->free_value) {
+		tree_fvalue_link_t *link;
+
+		link = tree_arena_alloc(tree_data, sizeof(tree_fvalue_link_t));
+		link->fv = &fi->value;
+		link->next = tree_data->fvalues;
+		tree_data->fvalues = link;
+	}
 	fi->rep        = NULL;
+	fi->deferred_rep = NULL;
 
 	/* add the data source tvbuff */
 	fi->ds_tvb = tvb ? tvb_get_ds_tvb(tvb) : NULL;
@@ -3576,66 +3767,99 @@ alloc_field_info(proto_tree *tree, int hfindex, tvbuff_t *tvb, const gint start,
 	return new_field_info(tree, hfinfo, tvb, start, item_length);
 }
 
+/* Keep a label string, or a piece of one, in the tree's label storage
+   until the label is rendered or the tree is freed. */
+static const gchar *
+tree_label_keep(proto_item *pi, const gchar *str)
+{
+	gsize  len = strlen(str) + 1;
+	gchar *copy = tree_arena_alloc(PTREE_DATA(pi), len);
+
+	memcpy(copy, str, len);
+	return copy;
+}
+
 /* If the protocol tree is to be visible, set the representation of a
    proto_tree entry with the name of the field for the item and with
    the value formatted with the supplied printf-style format and
-   argument list. */
+   argument list.
+
+   Only the value is formatted here, as the arguments may not outlive
+   this call; the field name (and bitfield) part of the label is added
+   by label_fill_value() when the label is asked for. */
 static void
 proto_tree_set_representation_value(proto_item *pi, const char *format, va_list ap)
 {
-	int                ret;	/*tmp return value */
-	field_info        *fi = PITEM_FINFO(pi);
-	header_field_info *hf;
+	field_info *fi = PITEM_FINFO(pi);
+	char        value[ITEM_LABEL_LENGTH];
 
 	DISSECTOR_ASSERT(fi);
 
-	hf = fi->hfinfo;
-
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
-		ITEM_LABEL_NEW(fi->rep);
-		if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
-			char tmpbuf[64];
-			guint32 val;
-
-			val = fvalue_get_uinteger(&fi->value);
-			if (hf->bitshift > 0) {
-				val <<= hf->bitshift;
-			}
-			decode_bitfield_value(tmpbuf, val, hf->bitmask, hfinfo_bitwidth(hf));
-			/* put in the hf name */
-			ret = g_snprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
-					 "%s%s: ", tmpbuf, fi->hfinfo->name);
-		} else {
-			/* put in the hf name */
-			ret = g_snprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
-					 "%s: ", fi->hfinfo->name);
-		}
+		/* The label holds less than this anyway; if the value is
+		   cut short here, label_fill_value() will mark the label
+		   as truncated. */
+		g_vsnprintf(value, ITEM_LABEL_LENGTH, format, ap);
+		fi->deferred_rep = tree_label_keep(pi, value);
+		FI_SET_FLAG(fi, FI_DEFERRED_VALUE);
+	}
+}
 
-		/* If possible, Put in the value of the string */
-		if (ret < ITEM_LABEL_LENGTH) {
-			ret += g_vsnprintf(fi->rep->representation + ret,
-					  ITEM_LABEL_LENGTH - ret, format, ap);
-		}
-		if (ret >= ITEM_LABEL_LENGTH) {
-			/* Uh oh, we don't have enough room.  Tell the user
-			 * that the field is truncated.
-			 */
-			char *oldrep;
+/* Render the label of an item added with a ..._format_value() call. */
+static void
+label_fill_value(field_info *fi, gchar *label_str, const gchar *value)
+{
+	int                ret;	/*tmp return value */
+	header_field_info *hf = fi->hfinfo;
 
-			/*	Argh, we cannot reuse 'ap' here.  So make a copy
-			 *	of what we formatted for (re)use below.
-			 */
-			oldrep = g_strdup(fi->rep->representation);
+	if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
+		char tmpbuf[64];
+		guint32 val;
 
-			g_snprintf(fi->rep->representation,
-				   ITEM_LABEL_LENGTH,
-				   "[truncated] %s",
-				   oldrep);
-			g_free(oldrep);
+		val = fvalue_get_uinteger(&fi->value);
+		if (hf->bitshift > 0) {
+			val <<= hf->bitshift;
 		}
+		decode_bitfield_value(tmpbuf, val, hf->bitmask, hfinfo_bitwidth(hf));
+		/* put in the hf name */
+		ret = g_snprintf(label_str, ITEM_LABEL_LENGTH,
+				 "%s%s: ", tmpbuf, hf->name);
+	} else {
+		/* put in the hf name */
+		ret = g_snprintf(label_str, ITEM_LABEL_LENGTH,
+				 "%s: ", hf->name);
+	}
+
+	/* If possible, Put in the value of the string */
+	if (ret < ITEM_LABEL_LENGTH) {
+		ret += g_snprintf(label_str + ret,
+				  ITEM_LABEL_LENGTH - ret, "%s", value);
+	}
+	if (ret >= ITEM_LABEL_LENGTH) {
+		/* Uh oh, we don't have enough room.  Tell the user
+		 * that the field is truncated.
+		 */
+		char *oldrep;
+
+		oldrep = g_strdup(label_str);
+
+		g_snprintf(label_str, ITEM_LABEL_LENGTH,
+			   "[truncated] %s", oldrep);
+		g_free(oldrep);
 	}
 }
 
+/* Turn a deferred label into a real one, for the functions that edit
+   fi->rep in place. */
+static void
+label_materialize(proto_item *pi, field_info *fi)
+{
+	ITEM_LABEL_NEW(PTREE_DATA(pi), fi->rep);
+	proto_item_fill_label(fi, fi->rep->representation);
+	fi->deferred_rep = NULL;
+	FI_RESET_FLAG(fi, FI_DEFERRED_VALUE);
+}
+
 /* If the protocol tree is to be visible, set the representation of a
    proto_tree entry with the representation formatted with the supplied
    printf-style format and argument list. */
@@ -3648,7 +3872,8 @@ proto_tree_set_representation(proto_item *pi, const char *format, va_list ap)
 	DISSECTOR_ASSERT(fi);
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
-		ITEM_LABEL_NEW(fi->rep);
+		if (fi->rep == NULL)
+			ITEM_LABEL_NEW(PTREE_DATA(pi), fi->rep);
 		ret = g_vsnprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
 				  format, ap);
 		if (ret >= ITEM_LABEL_LENGTH) {
@@ -3839,7 +4064,7 @@ proto_custom_set(proto_tree* tree, const int field_id, gint occurrence,
 									 "%u"), size-offset_r);
 					} else {
 						g_strlcpy(result+offset_r,
-							  val_to_str(u_integer, cVALS(hfinfo->strings), "%u"),
+							  hf_val_to_str(u_integer, hfinfo, "%u"),
 							  size-offset_r);
 					}
 				} else if (IS_BASE_DUAL(hfinfo->display)) {
@@ -3908,7 +4133,7 @@ proto_custom_set(proto_tree* tree, const int field_id, gint occurrence,
 							  size-offset_r);
 					} else {
 						g_strlcpy(result+offset_r,
-							  val_to_str(integer, cVALS(hfinfo->strings), "%d"),
+							  hf_val_to_str(integer, hfinfo, "%d"),
 							  size-offset_r);
 					}
 				} else if (IS_BASE_DUAL(hfinfo->display)) {
@@ -4057,9 +4282,11 @@ proto_item_set_text(proto_item *pi, const char *format, ...)
 	if (fi == NULL)
 		return;
 
-	if (fi->rep) {
-		ITEM_LABEL_FREE(fi->rep);
-	}
+	/* A visible item's label storage is reused for the new text. */
+	if (PROTO_ITEM_IS_HIDDEN(pi))
+		fi->rep = NULL;
+	fi->deferred_rep = NULL;
+	FI_RESET_FLAG(fi, FI_DEFERRED_VALUE);
 
 	va_start(ap, format);
 	proto_tree_set_representation(pi, format, ap);
@@ -4084,15 +4311,30 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 	}
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
-		/*
-		 * If we don't already have a representation,
-		 * generate the default representation.
-		 */
-		if (fi->rep == NULL) {
-			ITEM_LABEL_NEW(fi->rep);
-			proto_item_fill_label(fi, fi->rep->representation);
+		if (fi->rep == NULL && !FI_GET_FLAG(fi, FI_DEFERRED_VALUE)) {
+			/*
+			 * The label is the default representation, which
+			 * isn't rendered until it's asked for; just remember
+			 * what's to be appended to it.
+			 */
+			char suffix[ITEM_LABEL_LENGTH];
+
+			curlen = 0;
+			if (fi->deferred_rep != NULL)
+				curlen = g_strlcpy(suffix, fi->deferred_rep, ITEM_LABEL_LENGTH);
+			if (ITEM_LABEL_LENGTH > curlen) {
+				va_start(ap, format);
+				g_vsnprintf(suffix + curlen,
+					ITEM_LABEL_LENGTH - (gulong) curlen, format, ap);
+				va_end(ap);
+			}
+			fi->deferred_rep = tree_label_keep(pi, suffix);
+			return;
 		}
 
+		if (fi->rep == NULL)
+			label_materialize(pi, fi);
+
 		curlen = strlen(fi->rep->representation);
 		if (ITEM_LABEL_LENGTH > curlen) {
 			va_start(ap, format);
@@ -4123,12 +4365,10 @@ proto_item_prepend_text(proto_item *pi, const char *format, ...)
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		/*
 		 * If we don't already have a representation,
-		 * generate the default representation.
+		 * generate the default (or deferred) representation.
 		 */
-		if (fi->rep == NULL) {
-			ITEM_LABEL_NEW(fi->rep);
-			proto_item_fill_label(fi, fi->rep->representation);
-		}
+		if (fi->rep == NULL)
+			label_materialize(pi, fi);
 
 		g_strlcpy(representation, fi->rep->representation, ITEM_LABEL_LENGTH);
 		va_start(ap, format);
@@ -4159,8 +4399,14 @@ proto_item_set_len(proto_item *pi, const gint length)
 	 * larger, if there's no data to back that length;
 	 * you can only make it smaller.
 	 */
-	if (fi->value.ftype->ftype == FT_BYTES && length <= (gint)fi->value.value.bytes->len)
+	if (fi->value.ftype->ftype == FT_BYTES && length <= (gint)fi->value.value.bytes->len) {
+		/* The label shows the bytes; render a deferred one with
+		 * those it had when text was appended to it. */
+		if (fi->rep == NULL && fi->deferred_rep != NULL &&
+		    length < (gint)fi->value.value.bytes->len)
+			label_materialize(pi, fi);
 		fi->value.value.bytes->len = length;
+	}
 }
 
 /*
@@ -4224,13 +4470,16 @@ proto_tree_create_root(void)
 	proto_node *pnode;
 
 	/* Initialize the proto_node */
-	PROTO_NODE_NEW(pnode);
+	PROTO_ROOT_NEW(pnode);
 	pnode->parent = NULL;
 	PNODE_FINFO(pnode) = NULL;
 	pnode->tree_data = g_new(tree_data_t, 1);
 
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
 	pnode->tree_data->interesting_hfids = NULL;
+	pnode->tree_data->interesting_count = 0;
+	pnode->tree_data->arena = NULL;
+	pnode->tree_data->fvalues = NULL;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -4248,6 +4497,74 @@ proto_tree_create_root(void)
 }
 
 
+/* Return the interesting slot of a field, giving it a free one if it
+ * doesn't have one yet. */
+static interesting_slot_t *
+interesting_slot_get(const gint hfid)
+{
+	interesting_slot_t *islot;
+	guint slot;
+
+	slot = INTERESTING_SLOT(hfid);
+	if (slot != 0)
+		return &g_array_index(interesting_slots, interesting_slot_t, slot);
+
+	if ((guint)hfid >= interesting_slot_by_hfid_len) {
+		interesting_slot_by_hfid = g_renew(guint, interesting_slot_by_hfid, gpa_hfinfo.len);
+		memset(interesting_slot_by_hfid + interesting_slot_by_hfid_len, 0,
+		       (gpa_hfinfo.len - interesting_slot_by_hfid_len) * sizeof(guint));
+		interesting_slot_by_hfid_len = gpa_hfinfo.len;
+	}
+	if (interesting_slots == NULL) {
+		/* Slot 0 means "none" */
+		interesting_slots = g_array_new(FALSE, TRUE, sizeof(interesting_slot_t));
+		g_array_set_size(interesting_slots, 1);
+	}
+	for (slot = 1; slot < interesting_slots->len; slot++) {
+		if (g_array_index(interesting_slots, interesting_slot_t, slot).hfid == -1)
+			break;
+	}
+	if (slot == interesting_slots->len)
+		g_array_set_size(interesting_slots, slot + 1);
+
+	islot = &g_array_index(interesting_slots, interesting_slot_t, slot);
+	islot->hfid = hfid;
+	islot->refs = 0;
+	interesting_slot_by_hfid[hfid] = slot;
+	return islot;
+}
+
+/* A filter that will prime trees with a field holds on to the field's
+ * interesting slot until it is freed. */
+void
+proto_hold_interesting_hfid(const int hfid)
+{
+	DISSECTOR_ASSERT((guint)hfid < gpa_hfinfo.len);
+	interesting_slot_get(hfid)->refs++;
+}
+
+void
+proto_release_interesting_hfid(const int hfid)
+{
+	interesting_slot_t *islot;
+	guint slot;
+
+	/* Nothing to do if the filter outlived proto_cleanup() */
+	slot = INTERESTING_SLOT(hfid);
+	if (slot == 0)
+		return;
+	islot = &g_array_index(interesting_slots, interesting_slot_t, slot);
+	DISSECTOR_ASSERT(islot->refs != 0);
+	if (--islot->refs == 0) {
+		/* Trees built from now on no longer track the field; ones
+		 * that still have its field_infos in the slot notice that
+		 * the slot has changed hands by the hfid in them. */
+		unreference_interesting_hfid(hfid);
+		interesting_slot_by_hfid[hfid] = 0;
+		islot->hfid = -1;
+	}
+}
+
 /* "prime" a proto_tree with a single hfid that a dfilter
  * is interested in. */
 void
@@ -4256,6 +4573,11 @@ proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
+
+	/* Give the field a slot in the trees' interesting field index,
+	 * if no filter holds one for it. */
+	interesting_slot_get(hfid);
+
 	/* this field is referenced by a filter so increase the refcount.
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
@@ -5072,12 +5394,119 @@ tmp_fld_check_assert(header_field_info *hfinfo)
 }
 
 #define PROTO_PRE_ALLOC_HF_FIELDS_MEM 120000
+static guint
+vs_index_key_hash(gconstpointer key)
+{
+	const vs_index_key_t *vs_key = key;
+
+	return g_direct_hash(vs_key->vs) ^ vs_key->hash;
+}
+
+static gboolean
+vs_index_key_equal(gconstpointer key1, gconstpointer key2)
+{
+	const vs_index_key_t *vs_key1 = key1;
+	const vs_index_key_t *vs_key2 = key2;
+
+	return vs_key1->vs == vs_key2->vs &&
+	       vs_key1->num_entries == vs_key2->num_entries &&
+	       vs_key1->hash == vs_key2->hash;
+}
+
+/* Set up the value_string index for a field */
+static void
+hfinfo_index_vals(const header_field_info *hfinfo)
+{
+	const value_string *vs = cVALS(hfinfo->strings);
+	value_string_ext   *vse;
+	vs_index_key_t      vs_key, *new_key;
+	gpointer            orig_key, value;
+
+	if (vs_registered == NULL || !g_hash_table_lookup(vs_registered, vs)) {
+		vse = NULL;
+	} else {
+		if (vs_indexes == NULL)
+			vs_indexes = g_hash_table_new(vs_index_key_hash, vs_index_key_equal);
+
+		vs_key.vs   = vs;
+		vs_key.hash = 0;
+		for (vs_key.num_entries = 0; vs[vs_key.num_entries].strptr != NULL; vs_key.num_entries++) {
+			vs_key.hash = (vs_key.hash * 31) ^ vs[vs_key.num_entries].value;
+			vs_key.hash = (vs_key.hash * 31) ^ GPOINTER_TO_UINT(vs[vs_key.num_entries].strptr);
+		}
+
+		if (g_hash_table_lookup_extended(vs_indexes, &vs_key, &orig_key, &value)) {
+			vse = value;
+		} else {
+			vse = value_string_ext_new_index(vs, VS_INDEX_MIN_ENTRIES, hfinfo->abbrev);
+			new_key = g_memdup(&vs_key, sizeof vs_key);
+			g_hash_table_insert(vs_indexes, new_key, vse);
+		}
+	}
+
+	if ((guint)hfinfo->id >= vs_index_by_hfid_len) {
+		guint new_len = MAX(gpa_hfinfo.len, (guint)hfinfo->id + 1);
+
+		vs_index_by_hfid = g_renew(vs_index_t, vs_index_by_hfid, new_len);
+		memset(vs_index_by_hfid + vs_index_by_hfid_len, 0,
+		       (new_len - vs_index_by_hfid_len) * sizeof(vs_index_t));
+		vs_index_by_hfid_len = new_len;
+	}
+	vs_index_by_hfid[hfinfo->id].strings = hfinfo->strings;
+	vs_index_by_hfid[hfinfo->id].vse     = vse;
+}
+
+/* Looks a value up in a field's plain value_string, through its index if
+ * it has one; the result is what match_strval() would return. */
+static const char *
+hf_match_strval(const guint32 val, const header_field_info *hfinfo)
+{
+	const value_string_ext *vse;
+
+	if ((guint)hfinfo->id >= vs_index_by_hfid_len ||
+	    vs_index_by_hfid[hfinfo->id].strings != hfinfo->strings)
+		hfinfo_index_vals(hfinfo);
+
+	vse = vs_index_by_hfid[hfinfo->id].vse;
+	if (vse != NULL)
+		return match_strval_ext(val, vse);
+
+	return match_strval(val, cVALS(hfinfo->strings));
+}
+
+static const char *
+hf_val_to_str(const guint32 val, const header_field_info *hfinfo, const char *fmt)
+{
+	const char *str = hf_match_strval(val, hfinfo);
+
+	return str ? str : ep_strdup_printf(fmt, val);
+}
+
+static const char *
+hf_val_to_str_const(const guint32 val, const header_field_info *hfinfo, const char *unknown_str)
+{
+	const char *str = hf_match_strval(val, hfinfo);
+
+	return str ? str : unknown_str;
+}
+
 static int
 proto_register_field_init(header_field_info *hfinfo, const int parent)
 {
 
 	tmp_fld_check_assert(hfinfo);
 
+	/* only the value_strings that fields are registered with get an
+	   index (see hfinfo_index_vals()) */
+	if ((IS_FT_INT(hfinfo->type) || IS_FT_UINT(hfinfo->type)) &&
+	    hfinfo->strings != NULL &&
+	    !(hfinfo->display & (BASE_RANGE_STRING|BASE_EXT_STRING)) &&
+	    (hfinfo->display & BASE_DISPLAY_E_MASK) != BASE_CUSTOM) {
+		if (vs_registered == NULL)
+			vs_registered = g_hash_table_new(g_direct_hash, g_direct_equal);
+		g_hash_table_insert(vs_registered, (gpointer) hfinfo->strings, (gpointer) hfinfo->strings);
+	}
+
 	/* if this is a bitfield, compute bitshift */
 	if (hfinfo->bitmask) {
 		hfinfo->bitshift = wrs_count_bitshift(hfinfo->bitmask);
@@ -5199,6 +5628,22 @@ proto_register_subtree_array(gint *const *indices, const int num_indices)
 
 void
 proto_item_fill_label(field_info *fi, gchar *label_str)
+{
+	if (fi && fi->deferred_rep) {
+		if (FI_GET_FLAG(fi, FI_DEFERRED_VALUE)) {
+			label_fill_value(fi, label_str, fi->deferred_rep);
+		} else {
+			/* The default label followed by the appended text. */
+			label_fill_default(fi, label_str);
+			g_strlcat(label_str, fi->deferred_rep, ITEM_LABEL_LENGTH);
+		}
+		return;
+	}
+	label_fill_default(fi, label_str);
+}
+
+static void
+label_fill_default(field_info *fi, gchar *label_str)
 {
 	header_field_info *hfinfo;
 	guint8		  *bytes;
@@ -5482,7 +5927,7 @@ fill_label_bitfield(field_info *fi, gchar *label_str)
 		} else {
 			g_snprintf(p, ITEM_LABEL_LENGTH - bitfield_byte_length,
 				   format,  hfinfo->name,
-				   val_to_str_const(value, cVALS(hfinfo->strings), "Unknown"), value);
+				   hf_val_to_str_const(value, hfinfo, "Unknown"), value);
 		}
 	}
 	else {
@@ -5528,7 +5973,7 @@ fill_label_uint(field_info *fi, gchar *label_str)
 		} else {
 			g_snprintf(label_str, ITEM_LABEL_LENGTH,
 				   format,  hfinfo->name,
-				   val_to_str_const(value, cVALS(hfinfo->strings), "Unknown"), value);
+				   hf_val_to_str_const(value, hfinfo, "Unknown"), value);
 		}
 	}
 	else {
@@ -5595,7 +6040,7 @@ fill_label_int(field_info *fi, gchar *label_str)
 		} else {
 			g_snprintf(label_str, ITEM_LABEL_LENGTH,
 				   format,  hfinfo->name,
-				   val_to_str_const(value, cVALS(hfinfo->strings), "Unknown"), value);
+				   hf_val_to_str_const(value, hfinfo, "Unknown"), value);
 		}
 	}
 	else {
@@ -6220,19 +6665,24 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 /* Return GPtrArray* of field_info pointers for all hfindex that appear in tree.
  * This only works if the hfindex was "primed" before the dissection
  * took place, as we just pass back the already-created GPtrArray*.
- * The caller should *not* free the GPtrArray*; proto_tree_free_node()
+ * The caller should *not* free the GPtrArray*; proto_tree_free()
  * handles that. */
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	interesting_finfos_t *ptrs;
+	guint slot;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
-		return NULL;
+	slot = INTERESTING_SLOT(id);
+	if (slot < PTREE_DATA(tree)->interesting_count) {
+		ptrs = (interesting_finfos_t *)PTREE_DATA(tree)->interesting_hfids[slot];
+		if (ptrs != NULL && ptrs->hfid == id)
+			return (GPtrArray *)ptrs;
+	}
+	return NULL;
 }
 
 gboolean
@@ -6941,7 +7391,7 @@ construct_match_selected_string(field_info *finfo, epan_dissect_t *edt,
 			} else if (hfinfo->display & BASE_EXT_STRING) {
 				str = match_strval_ext(fvalue_get_sinteger(&finfo->value), hfinfo->strings);
 			} else {
-				str = match_strval(fvalue_get_sinteger(&finfo->value), hfinfo->strings);
+				str = hf_match_strval(fvalue_get_sinteger(&finfo->value), hfinfo);
 			}
 			break;
 
@@ -6954,7 +7404,7 @@ construct_match_selected_string(field_info *finfo, epan_dissect_t *edt,
 			} else if (hfinfo->display & BASE_EXT_STRING) {
 				str = match_strval_ext(fvalue_get_uinteger(&finfo->value), hfinfo->strings);
 			} else {
-				str = match_strval(fvalue_get_uinteger(&finfo->value), hfinfo->strings);
+				str = hf_match_strval(fvalue_get_uinteger(&finfo->value), hfinfo);
 			}
 			break;
 
@@ -7253,7 +7703,7 @@ proto_item_add_bitmask_tree(proto_item *item, tvbuff_t *tvb, const int offset,
 							       hf->name, val_to_str_ext_const(tmpval, (value_string_ext *) (hf->strings), "Unknown"));
 				} else {
 					proto_item_append_text(item, "%s%s: %s", first ? "" : ", ",
-							       hf->name, val_to_str_const(tmpval, cVALS(hf->strings), "Unknown"));
+							       hf->name, hf_val_to_str_const(tmpval, hf, "Unknown"));
 				}
 				first = FALSE;
 			}
@@ -398,6 +398,7 @@ typedef struct field_info {
 	gint				 appendix_length; /**< length of appendix data */
 	gint				 tree_type;       /**< one of ETT_ or -1 */
 	item_label_t		*rep;             /**< string for GUI tree */
+	const gchar			*deferred_rep;    /**< label text not rendered into rep yet, see proto_item_fill_label() */
 	guint32				 flags;           /**< bitfield like FI_GENERATED, ... */
 	tvbuff_t			*ds_tvb;          /**< data source tvbuff */
 	fvalue_t			 value;
@@ -444,6 +445,9 @@ typedef struct
 /** Field value takes n bits (values from 0x100 - 0x4000) */
 /* if 0, it means that field takes fi->length * 8 */
 #define FI_BITS_SIZE(n)         (((n) & 63) << 8)
+/** field_info.deferred_rep is the formatted value of a ..._format_value()
+ * item, rather than text appended to the default label */
+#define FI_DEFERRED_VALUE       0x00004000
 
 /** convenience macro to get field_info.flags */
 #define FI_GET_FLAG(fi, flag)   ((fi) ? ((fi)->flags & (flag)) : 0)
@@ -466,7 +470,12 @@ typedef struct
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable  *interesting_hfids;
+    GPtrArray   **interesting_hfids;  /**< field_infos of each primed field, indexed
+                                           by the field's interesting slot (see
+                                           proto_tree_prime_hfid()); allocated from arena */
+    guint       interesting_count;    /**< number of entries in interesting_hfids */
+    struct _tree_arena_chunk *arena;  /**< memory that lives exactly as long as the tree */
+    struct _tree_fvalue_link *fvalues; /**< values to clean up before the arena is released */
     gboolean    visible;
     gboolean    fake_protocols;
     gint        count;
@@ -703,6 +712,13 @@ extern proto_tree* proto_tree_create_root(void);
  @param tree the tree to free */
 extern void proto_tree_free(proto_tree *tree);
 
+/** Empty a proto_tree so that it can be used for another dissection.
+ The tree keeps its settings (visibility, fake protocols) and holds on
+ to its memory, so that this is much cheaper than freeing the tree and
+ creating a new one.
+ @param tree the tree to reset */
+extern void proto_tree_reset(proto_tree *tree);
+
 /** Set the tree visible or invisible.
  Is the parsing being done for a visible proto_tree or an invisible one?
  By setting this correctly, the proto_tree creation is sped up by not
@@ -726,6 +742,19 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 extern void
 proto_tree_prime_hfid(proto_tree *tree, const int hfid);
 
+/** Keep a field's slot in the interesting field index of trees, for a
+ filter that will prime trees with it, until the matching
+ proto_release_interesting_hfid().
+ @param hfid the interesting field id */
+extern void
+proto_hold_interesting_hfid(const int hfid);
+
+/** Let go of a slot taken with proto_hold_interesting_hfid(); the slot is
+ reused once nothing holds it.
+ @param hfid the interesting field id */
+extern void
+proto_release_interesting_hfid(const int hfid);
+
 /** Get a parent item of a subtree.
  @param tree the tree to get the parent from
  @return parent item */
@@ -1605,7 +1634,9 @@ proto_item_append_string(proto_item *pi, const char *str);
 
 
 
-/** Fill given label_str with string representation of field
+/** Fill given label_str with string representation of field.
+ Use this when fi->rep is NULL; labels that weren't set with
+ proto_item_set_text() are only rendered when asked for.
  @param fi the item to get the info from
  @param label_str the string to fill
  @todo think about changing the parameter profile */
@@ -53,13 +53,47 @@ static void LINK_FRAG(fragment_data *fd_head,fragment_data *fd)
 {
 	fragment_data *fd_i;
 
-	/* add fragment to list, keep list sorted */
-	for(fd_i= fd_head; fd_i->next;fd_i=fd_i->next) {
-		if (fd->offset < fd_i->next->offset )
-			break;
+	/* add fragment to list, keep list sorted.
+	 * Fragments mostly arrive in order or fill the first gap, so
+	 * start looking at the last fragment or the first gap rather
+	 * than at the start of the list.
+	 */
+	if (fd_head->last && fd->offset >= fd_head->last->offset) {
+		fd_i = fd_head->last;
+	} else {
+		fd_i = fd_head;
+		if (fd_head->first_gap && fd->offset >= fd_head->first_gap->offset)
+			fd_i = fd_head->first_gap;
+		for(; fd_i->next;fd_i=fd_i->next) {
+			if (fd->offset < fd_i->next->offset )
+				break;
+		}
 	}
 	fd->next=fd_i->next;
 	fd_i->next=fd;
+	if (fd->next == NULL)
+		fd_head->last = fd;
+
+	/* update the amount of contiguous data from the start */
+	if (fd->offset > fd_head->contiguous_len)
+		return;
+	fd_i = fd_head->first_gap ? fd_head->first_gap : fd_head;
+	if (fd_head->flags & FD_BLOCKSEQUENCE) {
+		for(; fd_i->next && fd_i->next->offset <= fd_head->contiguous_len; fd_i=fd_i->next) {
+			if (fd_i->next->offset == fd_head->contiguous_len)
+				fd_head->contiguous_len++;
+		}
+	} else {
+		/* fd may be in front of the first gap already */
+		if (fd->offset+fd->len > fd_head->contiguous_len)
+			fd_head->contiguous_len = fd->offset+fd->len;
+		for(; fd_i->next && fd_i->next->offset <= fd_head->contiguous_len; fd_i=fd_i->next) {
+			if (fd_i->next->offset+fd_i->next->len > fd_head->contiguous_len)
+				fd_head->contiguous_len = fd_i->next->offset+fd_i->next->len;
+		}
+	}
+	if (fd_i != fd_head)
+		fd_head->first_gap = fd_i;
 }
 
 /* copy a fragment key to heap store to insert in the hash */
@@ -750,21 +784,10 @@ fragment_add_work(fragment_data *fd_head, tvbuff_t *tvb, const int offset,
 
 	/*
 	 * Check if we have received the entire fragment.
-	 * This is easy since the list is sorted and the head is faked.
-	 *
-	 * First, we compute the amount of contiguous data that's
-	 * available.  (The check for fd_i->offset <= max rules out
-	 * fragments that don't start before or at the end of the
-	 * previous fragment, i.e. fragments that have a gap between
-	 * them and the previous fragment.)
+	 * LINK_FRAG() keeps track of the amount of contiguous data
+	 * that's available.
 	 */
-	max = 0;
-	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if ( ((fd_i->offset)<=max) &&
-			((fd_i->offset+fd_i->len)>max) ){
-			max = fd_i->offset+fd_i->len;
-		}
-	}
+	max = fd_head->contiguous_len;
 
 	if (max < (fd_head->datalen)) {
 		/*
@@ -1345,17 +1368,12 @@ fragment_add_seq_work(fragment_data *fd_head, tvbuff_t *tvb, const int offset,
 	}
 
 
-	/* check if we have received the entire fragment
-	 * this is easy since the list is sorted and the head is faked.
-	 * common case the whole list is scanned.
+	/* check if we have received the entire fragment.
+	 * LINK_FRAG() keeps track of the number of fragments from the
+	 * first one on without a gap; it will be datalen+1 if all
+	 * fragments have been seen.
 	 */
-	max = 0;
-	for(fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-	  if ( fd_i->offset==max ){
-		max++;
-	  }
-	}
-	/* max will now be datalen+1 if all fragments have been seen */
+	max = fd_head->contiguous_len;
 
 	if (max <= fd_head->datalen) {
 		/* we have not received all packets yet */
@@ -1491,16 +1509,15 @@ fragment_add_seq_key(tvbuff_t *tvb, const int offset, const packet_info *pinfo,
 			frag_number = 0;
 	} else {
 		if (flags & REASSEMBLE_FLAGS_NO_FRAG_NUMBER) {
-			fragment_data *fd;
 			/*
 			 * If we weren't given an initial fragment number,
 			 * use the next expected fragment number as the fragment
 			 * number for this fragment.
 			 */
-			for (fd = fd_head; fd != NULL; fd = fd->next) {
-				if (fd->next == NULL)
-					frag_number = fd->offset + 1;
-			}
+			if (fd_head->last != NULL)
+				frag_number = fd_head->last->offset + 1;
+			else
+				frag_number = fd_head->offset + 1;
 		}
 	}
 
@@ -1724,6 +1741,9 @@ fragment_start_seq_check(const packet_info *pinfo, const guint32 id, GHashTable
 		fd_head->flags = FD_BLOCKSEQUENCE|FD_DATALEN_SET;
 		fd_head->data = NULL;
 		fd_head->reassembled_in = 0;
+		fd_head->last = NULL;
+		fd_head->first_gap = NULL;
+		fd_head->contiguous_len = 0;
 		/*
 		 * We're going to use the key to insert the fragment,
 		 * so copy it to a long-term store.
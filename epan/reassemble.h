@@ -81,6 +81,14 @@ typedef struct _fragment_data {
 				   and when FD_DEFRAGMENTED is set*/
 	guint32 flags;
 	unsigned char *data;
+	/* The following are only valid in the first item of the list; they
+	 * let fragments be added without walking the whole list.
+	 */
+	struct _fragment_data *last;	/* last fragment in the list */
+	struct _fragment_data *first_gap; /* last fragment before the first gap,
+					   * NULL if there is none */
+	guint32 contiguous_len;	/* bytes (or, if FD_BLOCKSEQUENCE, fragments)
+				 * present without a gap from the start */
 } fragment_data;
 
 
@@ -1,10 +1,10 @@
 /* Standalone program to test functionality of reassemble.h API
  *
  * These aren't particularly complete - they just test a few corners of
- * functionality which I was interested in. In particular, they only test the
- * fragment_add_seq_* (ie, FD_BLOCKSEQUENCE) family of routines. However,
- * hopefully they will inspire people to write additional tests, and provide a
- * useful basis on which to do so.
+ * functionality which I was interested in. In particular, they mostly test the
+ * fragment_add_seq_* (ie, FD_BLOCKSEQUENCE) family of routines; fragment_add
+ * itself only gets a few. However, hopefully they will inspire people to write
+ * additional tests, and provide a useful basis on which to do so.
  *
  * December 2010:
  * 1. reassemble_test can be run under valgrind to detect any memory leaks in the
@@ -1000,6 +1000,56 @@ test_fragment_add_seq_duplicate_conflict(void)
 #endif
 }
 
+/* Test lots of fragments arriving out of order: the first one last, the
+ * odd ones in reverse, and the even ones in order.  The list must still
+ * come out sorted, and reassembly must only happen on the last one.
+ */
+#define MANY_FRAGS 200
+
+static void
+test_fragment_add_seq_many_out_of_order(void)
+{
+    fragment_data *fd_head, *fd;
+    guint32 i, seqno;
+
+    printf("Starting test test_fragment_add_seq_many_out_of_order\n");
+
+    for(i=MANY_FRAGS-1; i>0; i--) {
+        if((i&1) == 0)
+            continue;
+        pinfo.fd->num = MANY_FRAGS-i;
+        fd_head=fragment_add_seq(tvb, i, &pinfo, 12, fragment_table,
+                                 i, 1, i != MANY_FRAGS-1);
+        ASSERT_EQ(NULL,fd_head);
+    }
+    for(i=2; i<MANY_FRAGS; i+=2) {
+        pinfo.fd->num = MANY_FRAGS+i;
+        fd_head=fragment_add_seq(tvb, i, &pinfo, 12, fragment_table,
+                                 i, 1, TRUE);
+        ASSERT_EQ(NULL,fd_head);
+    }
+
+    pinfo.fd->num = 2*MANY_FRAGS;
+    fd_head=fragment_add_seq(tvb, 0, &pinfo, 12, fragment_table,
+                             0, 1, TRUE);
+
+    ASSERT_EQ(1,g_hash_table_size(fragment_table));
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(MANY_FRAGS,fd_head->len);
+    ASSERT_EQ(MANY_FRAGS-1,fd_head->datalen);
+    ASSERT_EQ(2*MANY_FRAGS,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_BLOCKSEQUENCE|FD_DATALEN_SET,fd_head->flags);
+    ASSERT(!memcmp(fd_head->data,data,MANY_FRAGS));
+
+    seqno = 0;
+    for(fd=fd_head->next; fd; fd=fd->next) {
+        ASSERT_EQ(seqno,fd->offset);
+        ASSERT_EQ(0,fd->flags);
+        seqno++;
+    }
+    ASSERT_EQ(MANY_FRAGS,seqno);
+}
+
 /**********************************************************************************
  *
  * fragment_add_dcerpc_dg
@@ -1619,6 +1669,272 @@ test_missing_data_fragment_add_seq_next_3(void)
 }
 
 
+/**********************************************************************************
+ *
+ * fragment_add
+ *
+ *********************************************************************************/
+
+/* Check the fragment list of a reassembled datagram: each fragment's
+ * offset and frame, in list order, and that none of them still hold data.
+ */
+static void
+check_fragment_list(fragment_data *fd_head, const guint32 *offsets,
+                    const guint32 *frames, guint32 count)
+{
+    fragment_data *fd;
+    guint32 i;
+
+    for(i=0, fd=fd_head->next; fd; i++, fd=fd->next) {
+        ASSERT(i < count);
+        ASSERT_EQ(offsets[i],fd->offset);
+        ASSERT_EQ(frames[i],fd->frame);
+        ASSERT_EQ(NULL,fd->data);
+    }
+    ASSERT_EQ(count,i);
+}
+
+/* Byte-offset fragments arriving out of order, tail first.
+ *
+ *    frame  offset  len  more_frags  tvb_offset
+ *    -----  ------  ---  ----------  ----------
+ *      1      100    50    F           105
+ *      2        0    40    T             5
+ *      3       60    40    T            65
+ *      4       40    20    T            45
+ */
+static void
+test_fragment_add_out_of_order(void)
+{
+    fragment_data *fd_head;
+    static const guint32 offsets[] = {0, 40, 60, 100};
+    static const guint32 frames[] = {2, 4, 3, 1};
+
+    printf("Starting test test_fragment_add_out_of_order\n");
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add(tvb, 105, &pinfo, 20, fragment_table,
+                         100, 50, FALSE);
+    ASSERT_EQ(1,g_hash_table_size(fragment_table));
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add(tvb, 5, &pinfo, 20, fragment_table,
+                         0, 40, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    /* this one leaves a gap between 40 and 60 */
+    pinfo.fd->num = 3;
+    fd_head=fragment_add(tvb, 65, &pinfo, 20, fragment_table,
+                         60, 40, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    /* and this one fills it */
+    pinfo.fd->num = 4;
+    fd_head=fragment_add(tvb, 45, &pinfo, 20, fragment_table,
+                         40, 20, TRUE);
+    ASSERT_EQ(1,g_hash_table_size(fragment_table));
+    ASSERT_NE(NULL,fd_head);
+
+    ASSERT_EQ(150,fd_head->datalen);
+    ASSERT_EQ(4,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    ASSERT(!memcmp(fd_head->data,data+5,150));
+    check_fragment_list(fd_head, offsets, frames, 4);
+}
+
+/* Overlapping byte-offset fragments: one that is entirely inside data we
+ * already have, one that overlaps with the same data, and one that
+ * overlaps with different data.
+ *
+ *    frame  offset  len  more_frags  tvb_offset
+ *    -----  ------  ---  ----------  ----------
+ *      1        0    60    T            10
+ *      2       10    20    T            20   (inside frame 1)
+ *      3       50    50    T            60   (same data as frame 1)
+ *      4       90    30    F            10   (differs from frame 3)
+ */
+static void
+test_fragment_add_overlap(void)
+{
+    fragment_data *fd_head, *fd;
+    static const guint32 offsets[] = {0, 10, 50, 90};
+    static const guint32 frames[] = {1, 2, 3, 4};
+
+    printf("Starting test test_fragment_add_overlap\n");
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add(tvb, 10, &pinfo, 21, fragment_table,
+                         0, 60, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add(tvb, 20, &pinfo, 21, fragment_table,
+                         10, 20, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 3;
+    fd_head=fragment_add(tvb, 60, &pinfo, 21, fragment_table,
+                         50, 50, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 4;
+    fd_head=fragment_add(tvb, 10, &pinfo, 21, fragment_table,
+                         90, 30, FALSE);
+    ASSERT_NE(NULL,fd_head);
+
+    ASSERT_EQ(120,fd_head->datalen);
+    ASSERT_EQ(4,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP|FD_OVERLAPCONFLICT,fd_head->flags);
+    check_fragment_list(fd_head, offsets, frames, 4);
+
+    /* the first fragment to supply a byte wins */
+    ASSERT(!memcmp(fd_head->data,data+10,100));
+    ASSERT(!memcmp(fd_head->data+100,data+20,20));
+
+    /* a fragment with nothing new in it isn't looked at, so isn't
+     * flagged as an overlap */
+    fd = fd_head->next;
+    ASSERT_EQ(0,fd->flags);
+    fd = fd->next;
+    ASSERT_EQ(0,fd->flags);
+    fd = fd->next;
+    ASSERT_EQ(FD_OVERLAP,fd->flags);
+    fd = fd->next;
+    ASSERT_EQ(FD_OVERLAP|FD_OVERLAPCONFLICT,fd->flags);
+}
+
+/* Byte-offset fragments that leave several gaps, so that the first gap
+ * moves as it is filled, and fragments that land in front of it or
+ * straddle it.
+ *
+ *    frame  offset  len  more_frags  tvb_offset
+ *    -----  ------  ---  ----------  ----------
+ *      1        0    10    T             0
+ *      2       20    10    T            20
+ *      3       40    10    T            40
+ *      4       60    20    F            60
+ *      5        0     5    T             0   (in front of the first gap)
+ *      6        5    20    T             5   (straddles the first gap)
+ *      7       30    10    T            30   (fills the next gap)
+ *      8       50    10    T            50   (completes the datagram)
+ */
+static void
+test_fragment_add_first_gap(void)
+{
+    fragment_data *fd_head;
+    static const guint32 offsets[] = {0, 0, 5, 20, 30, 40, 50, 60};
+    static const guint32 frames[] = {1, 5, 6, 2, 7, 3, 8, 4};
+
+    printf("Starting test test_fragment_add_first_gap\n");
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add(tvb, 0, &pinfo, 22, fragment_table,
+                         0, 10, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add(tvb, 20, &pinfo, 22, fragment_table,
+                         20, 10, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 3;
+    fd_head=fragment_add(tvb, 40, &pinfo, 22, fragment_table,
+                         40, 10, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 4;
+    fd_head=fragment_add(tvb, 60, &pinfo, 22, fragment_table,
+                         60, 20, FALSE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 5;
+    fd_head=fragment_add(tvb, 0, &pinfo, 22, fragment_table,
+                         0, 5, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 6;
+    fd_head=fragment_add(tvb, 5, &pinfo, 22, fragment_table,
+                         5, 20, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 7;
+    fd_head=fragment_add(tvb, 30, &pinfo, 22, fragment_table,
+                         30, 10, TRUE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 8;
+    fd_head=fragment_add(tvb, 50, &pinfo, 22, fragment_table,
+                         50, 10, TRUE);
+    ASSERT_NE(NULL,fd_head);
+
+    ASSERT_EQ(80,fd_head->datalen);
+    ASSERT_EQ(8,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP,fd_head->flags);
+    ASSERT(!memcmp(fd_head->data,data,80));
+    check_fragment_list(fd_head, offsets, frames, 8);
+}
+
+/* This tests the functionality of fragment_set_partial_reassembly for
+ * byte-offset reassembly, as TCP uses it to extend a PDU.
+ *
+ *    frame  offset  len  more_frags  tvb_offset
+ *    -----  ------  ---  ----------  ----------
+ *      1        0    50    F            10
+ *      2       50    40    F            60
+ *      3      100    20    F           110   (leaves a gap)
+ *      4       90    10    T           100
+ */
+static void
+test_fragment_add_partial_reassembly(void)
+{
+    fragment_data *fd_head;
+    static const guint32 offsets[] = {0, 50, 90, 100};
+    static const guint32 frames[] = {1, 2, 4, 3};
+
+    printf("Starting test test_fragment_add_partial_reassembly\n");
+
+    pinfo.fd->num = 1;
+    fd_head=fragment_add(tvb, 10, &pinfo, 23, fragment_table,
+                         0, 50, FALSE);
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(50,fd_head->datalen);
+    ASSERT_EQ(1,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    ASSERT(!memcmp(fd_head->data,data+10,50));
+
+    /* it turns out not to be complete after all */
+    fragment_set_partial_reassembly(&pinfo,23,fragment_table);
+
+    pinfo.fd->num = 2;
+    fd_head=fragment_add(tvb, 60, &pinfo, 23, fragment_table,
+                         50, 40, FALSE);
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(90,fd_head->datalen);
+    ASSERT_EQ(2,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    ASSERT(!memcmp(fd_head->data,data+10,90));
+
+    /* nor is that; this time the new data doesn't follow on */
+    fragment_set_partial_reassembly(&pinfo,23,fragment_table);
+
+    pinfo.fd->num = 3;
+    fd_head=fragment_add(tvb, 110, &pinfo, 23, fragment_table,
+                         100, 20, FALSE);
+    ASSERT_EQ(NULL,fd_head);
+
+    pinfo.fd->num = 4;
+    fd_head=fragment_add(tvb, 100, &pinfo, 23, fragment_table,
+                         90, 10, TRUE);
+    ASSERT_NE(NULL,fd_head);
+    ASSERT_EQ(120,fd_head->datalen);
+    ASSERT_EQ(4,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET,fd_head->flags);
+    ASSERT(!memcmp(fd_head->data,data+10,120));
+    check_fragment_list(fd_head, offsets, frames, 4);
+}
+
+
 /**********************************************************************************
  *
  * main
@@ -1638,6 +1954,7 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_seq_duplicate_middle,
         test_fragment_add_seq_duplicate_last,
         test_fragment_add_seq_duplicate_conflict,
+        test_fragment_add_seq_many_out_of_order,
         test_fragment_add_dcerpc_dg,
         test_fragment_add_seq_check,               /* frag + reassemble */
         test_fragment_add_seq_check_1,
@@ -1647,6 +1964,10 @@ main(int argc _U_, char **argv _U_)
         test_missing_data_fragment_add_seq_next,
         test_missing_data_fragment_add_seq_next_2,
         test_missing_data_fragment_add_seq_next_3,
+        test_fragment_add_out_of_order,
+        test_fragment_add_overlap,
+        test_fragment_add_first_gap,
+        test_fragment_add_partial_reassembly,
 #if 0
         test_fragment_add_seq_check_multiple
 #endif
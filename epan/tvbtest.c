@@ -48,6 +48,10 @@ test(tvbuff_t *tvb, gchar* name,
 	volatile guint32	val32;
 	guint32			expected32;
 	guint			incr, i;
+	tvb_chunk_iter_t	iter;
+	const guint8		*chunk;
+	guint			chunk_length;
+	const guint8		*found;
 
 	length = tvb_length(tvb);
 
@@ -223,6 +227,51 @@ test(tvbuff_t *tvb, gchar* name,
 		}
 	}
 
+	/* Sweep across data checking tvb_get_ntohl(), which has to read
+	 * across member boundaries of composite tvbuffs. */
+	for (i = 0; length >= 4 && i <= length - 4; i++) {
+		val32 = tvb_get_ntohl(tvb, i);
+		expected32 = pntohl(&expected_data[i]);
+		if (val32 != expected32) {
+			printf("13: Failed TVB=%s guint32 @ %u %u != expected %u\n",
+					name, i, val32, expected32);
+			failed = TRUE;
+			return FALSE;
+		}
+	}
+
+	/* Walk the data a chunk at a time */
+	i = 0;
+	tvb_chunk_iter_init(&iter, tvb, 0, -1);
+	while ((chunk = tvb_chunk_iter_next(&iter, &chunk_length)) != NULL) {
+		if (chunk_length == 0 || i + chunk_length > length ||
+		    memcmp(chunk, &expected_data[i], chunk_length) != 0) {
+			printf("14: Failed TVB=%s Offset=%u Length=%u "
+					"Bad chunk\n", name, i, chunk_length);
+			failed = TRUE;
+			return FALSE;
+		}
+		i += chunk_length;
+	}
+	if (i != length) {
+		printf("14: Failed TVB=%s Chunks covered %u bytes, not %u\n",
+				name, i, length);
+		failed = TRUE;
+		return FALSE;
+	}
+
+	/* Search for every byte from its own offset */
+	for (i = 0; i < length; i++) {
+		found = memchr(&expected_data[i], expected_data[i], length - i);
+		if (tvb_find_guint8(tvb, i, -1, expected_data[i]) !=
+		    (gint) (found - expected_data)) {
+			printf("15: Failed TVB=%s Offset=%u Bad find\n",
+					name, i);
+			failed = TRUE;
+			return FALSE;
+		}
+	}
+
 	/* Sweep across data in various sized increments checking
 	 * tvb_memdup() */
 	for (incr = 1; incr < length; incr++) {
@@ -470,16 +519,72 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+#define BENCH_BUF_LEN	1500
+#define BENCH_PASSES	20000
+
+/* Time a sweep of 32-bit reads over a packet-sized buffer, once through
+ * the inline accessor and once through the out-of-line function, to
+ * see what the inline fast path buys. Not run by default. */
+static void
+run_benchmark(void)
+{
+	tvbuff_t	*tvb;
+	guint8		*buf;
+	GTimer		*timer;
+	volatile guint32 sink;
+	guint32		sum;
+	gdouble		inline_secs, call_secs;
+	gint		offset, pass;
+
+	buf = g_malloc(BENCH_BUF_LEN);
+	for (offset = 0; offset < BENCH_BUF_LEN; offset++)
+		buf[offset] = (guint8)offset;
+	tvb = tvb_new_real_data(buf, BENCH_BUF_LEN, BENCH_BUF_LEN);
+	timer = g_timer_new();
+
+	sum = 0;
+	g_timer_start(timer);
+	for (pass = 0; pass < BENCH_PASSES; pass++)
+		for (offset = 0; offset <= BENCH_BUF_LEN - 4; offset++)
+			sum += tvb_get_ntohl(tvb, offset);
+	g_timer_stop(timer);
+	inline_secs = g_timer_elapsed(timer, NULL);
+	sink = sum;
+
+	sum = 0;
+	g_timer_start(timer);
+	for (pass = 0; pass < BENCH_PASSES; pass++)
+		for (offset = 0; offset <= BENCH_BUF_LEN - 4; offset++)
+			sum += (tvb_get_ntohl)(tvb, offset);
+	g_timer_stop(timer);
+	call_secs = g_timer_elapsed(timer, NULL);
+
+	if (sum != sink) {
+		printf("Benchmark: inline and out-of-line sums differ\n");
+		failed = TRUE;
+	}
+
+	printf("tvb_get_ntohl, %d reads: inline %.3fs, out-of-line %.3fs\n",
+		BENCH_PASSES * (BENCH_BUF_LEN - 3), inline_secs, call_secs);
+
+	g_timer_destroy(timer);
+	tvb_free(tvb);
+	g_free(buf);
+}
+
 /* Note: valgrind can be used to check for tvbuff memory leaks */
 int
-main(void)
+main(int argc, char **argv)
 {
 	/* For valgrind: See GLib documentation: "Running GLib Applications" */
 	g_setenv("G_DEBUG", "gc-friendly", 1);
 	g_setenv("G_SLICE", "always-malloc", 1);
 
 	except_init();
-	run_tests();
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+		run_benchmark();
+	else
+		run_tests();
 	except_deinit();
 	exit(failed?1:0);
 }
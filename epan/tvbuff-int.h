@@ -46,9 +46,31 @@ typedef struct {
 	guint		*start_offsets;
 	guint		*end_offsets;
 
+	/** The members in order, for binary searching by offset */
+	struct tvbuff	**members;
+	guint		num_members;
+
+	/** Holds a small value read across member boundaries, so
+	 * that the fixed-size getters don't flatten the composite */
+	guint8		scratch[8];
+
 } tvb_comp_t;
 
 struct tvbuff {
+	/* These two must stay first and in this order: the inline
+	 * accessors in tvbuff.h read them through tvb_inline_prefix_t. */
+
+	/** We're either a TVBUFF_REAL_DATA or a
+	 * TVBUFF_SUBSET that has a backing buffer that
+	 * has real_data != NULL, or a TVBUFF_COMPOSITE
+	 * which has flattened its data due to a call
+	 * to tvb_get_ptr().
+	 */
+	const guint8		*real_data;
+
+	/** Length of virtual buffer (and/or real_data). */
+	guint			length;
+
 	/* Doubly linked list pointers */
 	tvbuff_t                *next;
 	tvbuff_t                *previous;
@@ -65,17 +87,6 @@ struct tvbuff {
 		tvb_comp_t	composite;
 	} tvbuffs;
 
-	/** We're either a TVBUFF_REAL_DATA or a
-	 * TVBUFF_SUBSET that has a backing buffer that
-	 * has real_data != NULL, or a TVBUFF_COMPOSITE
-	 * which has flattened its data due to a call
-	 * to tvb_get_ptr().
-	 */
-	const guint8		*real_data;
-
-	/** Length of virtual buffer (and/or real_data). */
-	guint			length;
-
 	/** Reported length. */
 	guint			reported_length;
 
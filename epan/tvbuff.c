@@ -39,6 +39,9 @@
 # include "config.h"
 #endif
 
+/* We define the accessors, so we don't want tvbuff.h's inline wrappers. */
+#define TVB_NO_INLINE_ACCESSORS
+
 #include <string.h>
 
 #ifdef HAVE_LIBZ
@@ -98,6 +101,8 @@ tvb_init(tvbuff_t *tvb, const tvbuff_type type)
 			composite->tvbs		 = NULL;
 			composite->start_offsets = NULL;
 			composite->end_offsets	 = NULL;
+			composite->members	 = NULL;
+			composite->num_members	 = 0;
 			break;
 
 		default:
@@ -158,6 +163,7 @@ tvb_free_internal(tvbuff_t* tvb)
 
 			g_free(composite->start_offsets);
 			g_free(composite->end_offsets);
+			g_free(composite->members);
 			if (tvb->real_data) {
 				/*
 				 * XXX - do this with a union?
@@ -637,10 +643,13 @@ tvb_composite_finalize(tvbuff_t* tvb)
 
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 
 	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
 		DISSECTOR_ASSERT((guint) i < num_members);
 		member_tvb = slist->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
@@ -859,30 +868,43 @@ tvb_offset_from_real_beginning(const tvbuff_t *tvb)
 	return offset_from_real_beginning(tvb, 0);
 }
 
+/* Returns the index of the member of a composite that holds abs_offset.
+ * The members are sorted by offset, so this is a binary search for the
+ * first member that ends after abs_offset (end_offsets[] + 1 is the
+ * offset just past a member, which also makes empty members sort right). */
+static guint
+composite_find_member(const tvb_comp_t *composite, const guint abs_offset)
+{
+	guint low, high, mid;
+
+	low  = 0;
+	high = composite->num_members;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (composite->end_offsets[mid] + 1 <= abs_offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	DISSECTOR_ASSERT(low < composite->num_members);
+	return low;
+}
+
 static const guint8*
 composite_ensure_contiguous_no_exception(tvbuff_t *tvb, const guint abs_offset, const guint abs_length)
 {
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
 
 	DISSECTOR_ASSERT(tvb->type == TVBUFF_COMPOSITE);
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &tvb->tvbuffs.composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = slist->data;
-			break;
-		}
-	}
-	DISSECTOR_ASSERT(member_tvb);
+	i = composite_find_member(composite, abs_offset);
+	member_tvb = composite->members[i];
 
 	if (check_offset_length_no_exception(member_tvb->length, member_tvb->reported_length,
 					     abs_offset - composite->start_offsets[i],
@@ -925,7 +947,7 @@ ensure_contiguous_no_exception(tvbuff_t *tvb, const gint offset, const gint leng
 				DISSECTOR_ASSERT_NOT_REACHED();
 			case TVBUFF_SUBSET:
 				return ensure_contiguous_no_exception(tvb->tvbuffs.subset.tvb,
-						abs_offset - tvb->tvbuffs.subset.offset,
+						abs_offset + tvb->tvbuffs.subset.offset,
 						abs_length, NULL);
 			case TVBUFF_COMPOSITE:
 				return composite_ensure_contiguous_no_exception(tvb, abs_offset, abs_length);
@@ -950,6 +972,35 @@ ensure_contiguous(tvbuff_t *tvb, const gint offset, const gint length)
 	return p;
 }
 
+static const guint8*
+fast_ensure_contiguous(tvbuff_t *tvb, const gint offset, const guint length);
+
+static void*
+composite_memcpy(tvbuff_t *tvb, guint8* target, guint abs_offset, size_t abs_length);
+
+/* The fixed-size getters only look at the bytes for as long as it takes
+ * to decode them, so a value straddling two members is copied into the
+ * composite's scratch buffer instead of flattening the whole composite. */
+static const guint8*
+composite_fast_ensure_contiguous(tvbuff_t *tvb, const gint offset, const guint length)
+{
+	tvb_comp_t *composite;
+	guint	    abs_offset, abs_length, i;
+
+	check_offset_length(tvb->length, tvb->reported_length, offset, length,
+			    &abs_offset, &abs_length);
+
+	composite = &tvb->tvbuffs.composite;
+	i = composite_find_member(composite, abs_offset);
+	if (abs_offset + abs_length - 1 <= composite->end_offsets[i]) {
+		return fast_ensure_contiguous(composite->members[i],
+				abs_offset - composite->start_offsets[i], abs_length);
+	}
+
+	composite_memcpy(tvb, composite->scratch, abs_offset, abs_length);
+	return composite->scratch;
+}
+
 static const guint8*
 fast_ensure_contiguous(tvbuff_t *tvb, const gint offset, const guint length)
 {
@@ -960,6 +1011,21 @@ fast_ensure_contiguous(tvbuff_t *tvb, const gint offset, const guint length)
 	/* We don't check for overflow in this fast path so we only handle simple types */
 	DISSECTOR_ASSERT(length <= 8);
 
+	if (!tvb->real_data) {
+		/* Only a composite, or a subset of one, lacks real data */
+		switch(tvb->type) {
+			case TVBUFF_COMPOSITE:
+				return composite_fast_ensure_contiguous(tvb, offset, length);
+			case TVBUFF_SUBSET:
+				check_offset_length(tvb->length, tvb->reported_length, offset, length,
+						    &u_offset, &end_offset);
+				return fast_ensure_contiguous(tvb->tvbuffs.subset.tvb,
+						u_offset + tvb->tvbuffs.subset.offset, length);
+			default:
+				break;
+		}
+	}
+
 	if (offset < 0 || !tvb->real_data) {
 		return ensure_contiguous(tvb, offset, length);
 	}
@@ -1002,64 +1068,142 @@ guint8_pbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles, g
 }
 
 
+/* Returns a pointer to the data at abs_offset and sets *run_length to how
+ * many of the next max_length bytes are contiguous there.  Composites are
+ * walked member by member rather than flattened. */
+static const guint8*
+contiguous_run(tvbuff_t *tvb, const guint abs_offset, const guint max_length, guint *run_length)
+{
+	tvb_comp_t *composite;
+	guint	    i, member_offset, member_length;
 
-/************** ACCESSORS **************/
+	if (tvb->real_data) {
+		*run_length = max_length;
+		return tvb->real_data + abs_offset;
+	}
 
-static void*
-composite_memcpy(tvbuff_t *tvb, guint8* target, guint abs_offset, size_t abs_length)
+	switch(tvb->type) {
+		case TVBUFF_REAL_DATA:
+			DISSECTOR_ASSERT_NOT_REACHED();
+
+		case TVBUFF_SUBSET:
+			return contiguous_run(tvb->tvbuffs.subset.tvb,
+					abs_offset + tvb->tvbuffs.subset.offset,
+					max_length, run_length);
+
+		case TVBUFF_COMPOSITE:
+			composite = &tvb->tvbuffs.composite;
+			i = composite_find_member(composite, abs_offset);
+			member_offset = abs_offset - composite->start_offsets[i];
+			member_length = composite->members[i]->length - member_offset;
+			if (member_length > max_length)
+				member_length = max_length;
+			return contiguous_run(composite->members[i], member_offset,
+					member_length, run_length);
+	}
+
+	DISSECTOR_ASSERT_NOT_REACHED();
+	return NULL;
+}
+
+void
+tvb_chunk_iter_init(tvb_chunk_iter_t *iter, tvbuff_t *tvb, const gint offset, const gint length)
 {
-	guint	    i, num_members;
-	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
-	guint	    member_offset, member_length;
-	gboolean    retval;
-	GSList	   *slist;
+	DISSECTOR_ASSERT(tvb && tvb->initialized);
 
-	DISSECTOR_ASSERT(tvb->type == TVBUFF_COMPOSITE);
+	check_offset_length(tvb->length, tvb->reported_length, offset, length,
+			    &iter->offset, &iter->remaining);
+	iter->tvb = tvb;
+}
 
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &tvb->tvbuffs.composite;
-	num_members = g_slist_length(composite->tvbs);
+const guint8*
+tvb_chunk_iter_next(tvb_chunk_iter_t *iter, guint *chunk_length)
+{
+	const guint8 *chunk;
 
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = slist->data;
-			break;
-		}
+	if (iter->remaining == 0)
+		return NULL;
+
+	chunk = contiguous_run(iter->tvb, iter->offset, iter->remaining, chunk_length);
+	iter->offset	+= *chunk_length;
+	iter->remaining -= *chunk_length;
+	return chunk;
+}
+
+static gint
+composite_find_guint8(tvbuff_t *tvb, const guint abs_offset, const guint limit, const guint8 needle)
+{
+	tvb_chunk_iter_t iter;
+	const guint8	*chunk, *result;
+	guint		 chunk_offset, chunk_length;
+
+	chunk_offset = abs_offset;
+	tvb_chunk_iter_init(&iter, tvb, abs_offset, limit);
+	while ((chunk = tvb_chunk_iter_next(&iter, &chunk_length)) != NULL) {
+		result = memchr(chunk, needle, chunk_length);
+		if (result != NULL)
+			return (gint) (chunk_offset + (result - chunk));
+		chunk_offset += chunk_length;
 	}
-	DISSECTOR_ASSERT(member_tvb);
+	return -1;
+}
 
-	if (check_offset_length_no_exception(member_tvb->length, member_tvb->reported_length, abs_offset - composite->start_offsets[i],
-				(gint) abs_length, &member_offset, &member_length, NULL)) {
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, const guint abs_offset, const guint limit, const guint8 *needles, guchar *found_needle)
+{
+	tvb_chunk_iter_t iter;
+	const guint8	*chunk, *result;
+	guint		 chunk_offset, chunk_length;
 
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, member_length);
+	chunk_offset = abs_offset;
+	tvb_chunk_iter_init(&iter, tvb, abs_offset, limit);
+	while ((chunk = tvb_chunk_iter_next(&iter, &chunk_length)) != NULL) {
+		result = guint8_pbrk(chunk, chunk_length, needles, found_needle);
+		if (result != NULL)
+			return (gint) (chunk_offset + (result - chunk));
+		chunk_offset += chunk_length;
 	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		retval = compute_offset_length(member_tvb->length, member_tvb->reported_length, abs_offset - composite->start_offsets[i], -1,
-				&member_offset, &member_length, NULL);
-		DISSECTOR_ASSERT(retval);
+	return -1;
+}
 
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
+/************** ACCESSORS **************/
 
-		return target;
+static void*
+composite_memcpy(tvbuff_t *tvb, guint8* target, guint abs_offset, size_t abs_length)
+{
+	guint	    i;
+	tvb_comp_t *composite;
+	tvbuff_t   *member_tvb;
+	guint	    member_offset, member_length;
+	guint8	   *dst = target;
+
+	DISSECTOR_ASSERT(tvb->type == TVBUFF_COMPOSITE);
+
+	/* Find the member holding the first byte, then copy the part
+	 * that's in each member until we have copied all data. */
+	composite = &tvb->tvbuffs.composite;
+	i = composite_find_member(composite, abs_offset);
+
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb    = composite->members[i];
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = member_tvb->length - member_offset;
+		if (member_length > abs_length)
+			member_length = (guint) abs_length;
+
+		if (member_length > 0) {
+			DISSECTOR_ASSERT(!tvb->real_data);
+			tvb_memcpy(member_tvb, dst, member_offset, member_length);
+			dst		+= member_length;
+			abs_offset	+= member_length;
+			abs_length	-= member_length;
+		}
+		i++;
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return target;
 }
 
 void*
@@ -1093,11 +1237,11 @@ tvb_memcpy(tvbuff_t *tvb, void* target, const gint offset, size_t length)
 
 		case TVBUFF_SUBSET:
 			return tvb_memcpy(tvb->tvbuffs.subset.tvb, target,
-					abs_offset - tvb->tvbuffs.subset.offset,
+					abs_offset + tvb->tvbuffs.subset.offset,
 					abs_length);
 
 		case TVBUFF_COMPOSITE:
-			return composite_memcpy(tvb, target, offset, length);
+			return composite_memcpy(tvb, target, abs_offset, abs_length);
 	}
 
 	DISSECTOR_ASSERT_NOT_REACHED();
@@ -1865,6 +2009,7 @@ gint
 tvb_find_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const guint8 needle)
 {
 	const guint8 *result;
+	gint	      result_offset;
 	guint	      abs_offset, junk_length;
 	guint	      tvbufflen;
 	guint	      limit;
@@ -1906,13 +2051,15 @@ tvb_find_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 			DISSECTOR_ASSERT_NOT_REACHED();
 
 		case TVBUFF_SUBSET:
-			return tvb_find_guint8(tvb->tvbuffs.subset.tvb,
-					abs_offset - tvb->tvbuffs.subset.offset,
+			result_offset = tvb_find_guint8(tvb->tvbuffs.subset.tvb,
+					abs_offset + tvb->tvbuffs.subset.offset,
 					limit, needle);
+			if (result_offset == -1)
+				return -1;
+			return result_offset - (gint) tvb->tvbuffs.subset.offset;
 
 		case TVBUFF_COMPOSITE:
-			DISSECTOR_ASSERT_NOT_REACHED();
-			/* XXX - return composite_find_guint8(tvb, offset, limit, needle); */
+			return composite_find_guint8(tvb, abs_offset, limit, needle);
 	}
 
 	DISSECTOR_ASSERT_NOT_REACHED();
@@ -1930,6 +2077,7 @@ gint
 tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const guint8 *needles, guchar *found_needle)
 {
 	const guint8 *result;
+	gint	      result_offset;
 	guint	      abs_offset, junk_length;
 	guint	      tvbufflen;
 	guint	      limit;
@@ -1971,13 +2119,15 @@ tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 			DISSECTOR_ASSERT_NOT_REACHED();
 
 		case TVBUFF_SUBSET:
-			return tvb_pbrk_guint8(tvb->tvbuffs.subset.tvb,
-					abs_offset - tvb->tvbuffs.subset.offset,
+			result_offset = tvb_pbrk_guint8(tvb->tvbuffs.subset.tvb,
+					abs_offset + tvb->tvbuffs.subset.offset,
 					limit, needles, found_needle);
+			if (result_offset == -1)
+				return -1;
+			return result_offset - (gint) tvb->tvbuffs.subset.offset;
 
 		case TVBUFF_COMPOSITE:
-			DISSECTOR_ASSERT_NOT_REACHED();
-			/* XXX - return composite_pbrk_guint8(tvb, offset, limit, needle); */
+			return composite_pbrk_guint8(tvb, abs_offset, limit, needles, found_needle);
 	}
 
 	DISSECTOR_ASSERT_NOT_REACHED();
@@ -3324,53 +3474,154 @@ tvb_find_tvb(tvbuff_t *haystack_tvb, tvbuff_t *needle_tvb, const gint haystack_o
 }
 
 #ifdef HAVE_LIBZ
-/*
- * Uncompresses a zlib compressed packet inside a message of tvb at offset with
- * length comprlen.  Returns an uncompressed tvbuffer if uncompression
- * succeeded or NULL if uncompression failed.
- */
 #define TVB_Z_MIN_BUFSIZ 32768
 #define TVB_Z_MAX_BUFSIZ 1048576 * 10
 /* #define TVB_Z_DEBUG 1 */
 #undef TVB_Z_DEBUG
 
-tvbuff_t *
-tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
+/*
+ * Inflating a large HTTP or SPDY body is by far the most expensive thing
+ * that happens when such a packet is dissected, and the GUI dissects the
+ * same packets over and over (selecting, refiltering, retapping).  So the
+ * results are kept in a cache, keyed by the compressed bytes themselves,
+ * so that nothing needs to know which frame or data source they came from
+ * and a changed packet can never be handed a stale result.  The cache is
+ * bounded by TVB_Z_CACHE_MAX_BYTES and evicts the least recently used
+ * entries first; it's emptied whenever dissection is (re)initialized.
+ */
+#define TVB_Z_CACHE_MAX_BYTES	(64 * 1024 * 1024)
+#define TVB_Z_CACHE_MAX_ENTRY	(TVB_Z_CACHE_MAX_BYTES / 4)
+
+typedef struct {
+	guint8	*compr;
+	guint	 compr_len;
+	guint	 hash;
+	guint8	*uncompr;
+	guint	 uncompr_len;
+	GList	*lru_link;	/* our link in z_cache_lru */
+} z_cache_entry_t;
+
+static GHashTable *z_cache = NULL;
+static GQueue      z_cache_lru = G_QUEUE_INIT;	/* most recently used first */
+static gsize       z_cache_bytes = 0;
+static guint       z_cache_hits = 0;
+static guint       z_cache_misses = 0;
+
+static guint
+z_cache_hash_data(const guint8 *data, guint len)
+{
+	guint hash = 2166136261U;	/* FNV-1a */
+
+	while (len--)
+		hash = (hash ^ *data++) * 16777619U;
+	return hash;
+}
+
+static guint
+z_cache_hash(gconstpointer key)
+{
+	return ((const z_cache_entry_t *)key)->hash;
+}
+
+static gboolean
+z_cache_equal(gconstpointer a, gconstpointer b)
+{
+	const z_cache_entry_t *ea = a, *eb = b;
+
+	return ea->hash == eb->hash && ea->compr_len == eb->compr_len &&
+	    memcmp(ea->compr, eb->compr, ea->compr_len) == 0;
+}
+
+static void
+z_cache_entry_free(gpointer data)
+{
+	z_cache_entry_t *entry = data;
+
+	g_free(entry->compr);
+	g_free(entry->uncompr);
+	g_free(entry);
+}
+
+static void
+z_cache_remove(z_cache_entry_t *entry)
+{
+	g_queue_delete_link(&z_cache_lru, entry->lru_link);
+	z_cache_bytes -= entry->compr_len + entry->uncompr_len;
+	g_hash_table_remove(z_cache, entry);
+}
+
+/* Takes ownership of compr; uncompr is copied only if the entry is kept. */
+static void
+z_cache_insert(guint8 *compr, guint compr_len, guint hash, const guint8 *uncompr, guint uncompr_len)
+{
+	z_cache_entry_t *entry;
+	gsize            size = (gsize)compr_len + uncompr_len;
+
+	if (size > TVB_Z_CACHE_MAX_ENTRY) {
+		g_free(compr);
+		return;
+	}
+
+	if (z_cache == NULL)
+		z_cache = g_hash_table_new_full(z_cache_hash, z_cache_equal, NULL, z_cache_entry_free);
+
+	while (z_cache_bytes + size > TVB_Z_CACHE_MAX_BYTES)
+		z_cache_remove(g_queue_peek_tail(&z_cache_lru));
+
+	entry = g_new(z_cache_entry_t, 1);
+	entry->compr       = compr;
+	entry->compr_len   = compr_len;
+	entry->hash        = hash;
+	entry->uncompr     = g_memdup(uncompr, uncompr_len);
+	entry->uncompr_len = uncompr_len;
+	g_queue_push_head(&z_cache_lru, entry);
+	entry->lru_link    = g_queue_peek_head_link(&z_cache_lru);
+	z_cache_bytes     += size;
+	g_hash_table_insert(z_cache, entry, entry);
+}
+
+void
+tvb_uncompress_cache_clear(void)
+{
+	if (z_cache != NULL) {
+		g_hash_table_destroy(z_cache);
+		z_cache = NULL;
+	}
+	g_queue_clear(&z_cache_lru);
+	z_cache_bytes  = 0;
+	z_cache_hits   = 0;
+	z_cache_misses = 0;
+}
+
+void
+tvb_uncompress_cache_get_stats(tvb_uncompress_cache_stats_t *stats)
+{
+	stats->hits    = z_cache_hits;
+	stats->misses  = z_cache_misses;
+	stats->entries = z_cache_lru.length;
+	stats->bytes   = z_cache_bytes;
+}
+
+/*
+ * Inflates comprlen bytes at compr.  Returns the uncompressed data, which
+ * the caller must g_free(), and sets *bytes_out_p to its length, or returns
+ * NULL if uncompression failed.  bufsiz is the size of the buffer to
+ * inflate into on each pass.
+ */
+static guint8 *
+uncompress_data(guint8 *compr, int comprlen, guint bufsiz, guint *bytes_out_p)
 {
 	gint       err            = Z_OK;
 	guint      bytes_out      = 0;
-	guint8    *compr          = NULL;
 	guint8    *uncompr        = NULL;
-	tvbuff_t  *uncompr_tvb    = NULL;
 	z_streamp  strm           = NULL;
 	Bytef     *strmbuf        = NULL;
 	guint      inits_done     = 0;
 	gint       wbits          = MAX_WBITS;
 	guint8    *next           = NULL;
-	guint      bufsiz         = TVB_Z_MIN_BUFSIZ;
 #ifdef TVB_Z_DEBUG
 	guint      inflate_passes = 0;
-	guint      bytes_in       = tvb_length_remaining(tvb, offset);
-#endif
-
-	if (tvb == NULL) {
-		return NULL;
-	}
-
-	compr = tvb_memdup(tvb, offset, comprlen);
-
-	if (!compr)
-		return NULL;
-
-	/*
-	 * Assume that the uncompressed data is at least twice as big as
-	 * the compressed size.
-	 */
-	bufsiz = tvb_length_remaining(tvb, offset) * 2;
-	bufsiz = CLAMP(bufsiz, TVB_Z_MIN_BUFSIZ, TVB_Z_MAX_BUFSIZ);
-
-#ifdef TVB_Z_DEBUG
-	printf("bufsiz: %u bytes\n", bufsiz);
+	guint      bytes_in       = comprlen;
 #endif
 
 	next = compr;
@@ -3388,7 +3639,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 	if (err != Z_OK) {
 		inflateEnd(strm);
 		g_free(strm);
-		g_free(compr);
 		g_free(strmbuf);
 		return NULL;
 	}
@@ -3450,7 +3700,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 			if (uncompr != NULL) {
 				break;
 			} else {
-				g_free(compr);
 				return NULL;
 			}
 
@@ -3479,7 +3728,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 			} else {
 				inflateEnd(strm);
 				g_free(strm);
-				g_free(compr);
 				g_free(strmbuf);
 				return NULL;
 			}
@@ -3524,7 +3772,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 			if (c - compr > comprlen) {
 				inflateEnd(strm);
 				g_free(strm);
-				g_free(compr);
 				g_free(strmbuf);
 				return NULL;
 			}
@@ -3562,7 +3809,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 			if (err != Z_OK) {
 				g_free(strm);
 				g_free(strmbuf);
-				g_free(compr);
 				g_free(uncompr);
 
 				return NULL;
@@ -3573,7 +3819,6 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 			g_free(strmbuf);
 
 			if (uncompr == NULL) {
-				g_free(compr);
 				return NULL;
 			}
 
@@ -3586,11 +3831,76 @@ tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
 	printf("bytes  in: %u\nbytes out: %u\n\n", bytes_in, bytes_out);
 #endif
 
-	if (uncompr != NULL) {
-		uncompr_tvb =  tvb_new_real_data((guint8*) uncompr, bytes_out, bytes_out);
-		tvb_set_free_cb(uncompr_tvb, g_free);
+	*bytes_out_p = bytes_out;
+	return uncompr;
+}
+
+/*
+ * Uncompresses a zlib compressed packet inside a message of tvb at offset with
+ * length comprlen.  Returns an uncompressed tvbuffer if uncompression
+ * succeeded or NULL if uncompression failed.
+ */
+tvbuff_t *
+tvb_uncompress(tvbuff_t *tvb, const int offset, int comprlen)
+{
+	z_cache_entry_t  key, *entry;
+	guint8          *uncompr;
+	guint            bytes_out    = 0;
+	tvbuff_t        *uncompr_tvb  = NULL;
+	guint            bufsiz;
+
+	if (tvb == NULL) {
+		return NULL;
+	}
+
+	key.compr = tvb_memdup(tvb, offset, comprlen);
+
+	if (!key.compr)
+		return NULL;
+
+	key.compr_len = comprlen;
+	key.hash      = z_cache_hash_data(key.compr, key.compr_len);
+
+	entry = z_cache ? g_hash_table_lookup(z_cache, &key) : NULL;
+	if (entry != NULL) {
+		z_cache_hits++;
+		g_queue_unlink(&z_cache_lru, entry->lru_link);
+		g_queue_push_head_link(&z_cache_lru, entry->lru_link);
+		g_free(key.compr);
+
+		/*
+		 * Hand out a copy; the entry might be evicted while the
+		 * tvbuff is still in use.
+		 */
+		uncompr = entry->uncompr_len ?
+				g_memdup(entry->uncompr, entry->uncompr_len) :
+				(guint8 *)g_strdup("");
+		bytes_out = entry->uncompr_len;
+	} else {
+		z_cache_misses++;
+
+		/*
+		 * Assume that the uncompressed data is at least twice as big as
+		 * the compressed size.
+		 */
+		bufsiz = tvb_length_remaining(tvb, offset) * 2;
+		bufsiz = CLAMP(bufsiz, TVB_Z_MIN_BUFSIZ, TVB_Z_MAX_BUFSIZ);
+
+#ifdef TVB_Z_DEBUG
+		printf("bufsiz: %u bytes\n", bufsiz);
+#endif
+
+		uncompr = uncompress_data(key.compr, comprlen, bufsiz, &bytes_out);
+		if (uncompr == NULL) {
+			g_free(key.compr);
+			return NULL;
+		}
+		z_cache_insert(key.compr, key.compr_len, key.hash,
+		    uncompr, bytes_out);
 	}
-	g_free(compr);
+
+	uncompr_tvb =  tvb_new_real_data((guint8*) uncompr, bytes_out, bytes_out);
+	tvb_set_free_cb(uncompr_tvb, g_free);
 	return uncompr_tvb;
 }
 #else
@@ -3599,6 +3909,17 @@ tvb_uncompress(tvbuff_t *tvb _U_, const int offset _U_, int comprlen _U_)
 {
 	return NULL;
 }
+
+void
+tvb_uncompress_cache_clear(void)
+{
+}
+
+void
+tvb_uncompress_cache_get_stats(tvb_uncompress_cache_stats_t *stats)
+{
+	memset(stats, 0, sizeof *stats);
+}
 #endif
 
 tvbuff_t *
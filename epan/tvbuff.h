@@ -39,6 +39,7 @@
 #include <epan/ipv6-utils.h>
 #include <epan/guid-utils.h>
 #include "exceptions.h"
+#include "pint.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -286,6 +287,69 @@ extern guint64 tvb_get_letoh64(tvbuff_t*, const gint offset);
 extern gfloat tvb_get_letohieee_float(tvbuff_t*, const gint offset);
 extern gdouble tvb_get_letohieee_double(tvbuff_t*, const gint offset);
 
+/* The inline fast path for the integer accessors.
+ *
+ * Most tvbuffs that dissectors read from are backed by contiguous
+ * real data, and most reads are in bounds, so the cost of the
+ * accessors above is dominated by the out-of-line call and its
+ * checks.  For those reads the inline versions below fetch the bytes
+ * directly; anything else (a negative offset, a read that would run
+ * past the captured length, a composite tvbuff that hasn't been
+ * flattened) falls through to the out-of-line accessor, which does
+ * the full checking and throws exactly as before.
+ *
+ * Code that needs the real functions (e.g. to take their address) can
+ * still get them by writing the name in parentheses, or by defining
+ * TVB_NO_INLINE_ACCESSORS before including this file.
+ */
+
+/** Only for the inline accessors; it mirrors the first members of
+ * struct tvbuff in tvbuff-int.h, which must be kept in step with it. */
+typedef struct {
+	const guint8	*real_data;
+	guint		length;
+} tvb_inline_prefix_t;
+
+#define TVB_INLINE_PTR(tvb, offset, len) \
+	((tvb) != NULL && ((const tvb_inline_prefix_t *)(tvb))->real_data != NULL && \
+	 (offset) >= 0 && \
+	 (guint)(offset) + (len) <= ((const tvb_inline_prefix_t *)(tvb))->length ? \
+	 ((const tvb_inline_prefix_t *)(tvb))->real_data + (offset) : NULL)
+
+#define TVB_INLINE_ACCESSOR(type, name, len, fetch) \
+static inline type \
+name##_inline(tvbuff_t *tvb, const gint offset) \
+{ \
+	const guint8 *ptr = TVB_INLINE_PTR(tvb, offset, len); \
+	if (ptr != NULL) \
+		return fetch; \
+	return (name)(tvb, offset); \
+}
+
+TVB_INLINE_ACCESSOR(guint8,  tvb_get_guint8,  1, *ptr)
+TVB_INLINE_ACCESSOR(guint16, tvb_get_ntohs,   2, pntohs(ptr))
+TVB_INLINE_ACCESSOR(guint32, tvb_get_ntoh24,  3, pntoh24(ptr))
+TVB_INLINE_ACCESSOR(guint32, tvb_get_ntohl,   4, pntohl(ptr))
+TVB_INLINE_ACCESSOR(guint64, tvb_get_ntoh64,  8, pntoh64(ptr))
+TVB_INLINE_ACCESSOR(guint16, tvb_get_letohs,  2, pletohs(ptr))
+TVB_INLINE_ACCESSOR(guint32, tvb_get_letoh24, 3, pletoh24(ptr))
+TVB_INLINE_ACCESSOR(guint32, tvb_get_letohl,  4, pletohl(ptr))
+TVB_INLINE_ACCESSOR(guint64, tvb_get_letoh64, 8, pletoh64(ptr))
+
+#undef TVB_INLINE_ACCESSOR
+
+#ifndef TVB_NO_INLINE_ACCESSORS
+#define tvb_get_guint8(tvb, offset)	tvb_get_guint8_inline(tvb, offset)
+#define tvb_get_ntohs(tvb, offset)	tvb_get_ntohs_inline(tvb, offset)
+#define tvb_get_ntoh24(tvb, offset)	tvb_get_ntoh24_inline(tvb, offset)
+#define tvb_get_ntohl(tvb, offset)	tvb_get_ntohl_inline(tvb, offset)
+#define tvb_get_ntoh64(tvb, offset)	tvb_get_ntoh64_inline(tvb, offset)
+#define tvb_get_letohs(tvb, offset)	tvb_get_letohs_inline(tvb, offset)
+#define tvb_get_letoh24(tvb, offset)	tvb_get_letoh24_inline(tvb, offset)
+#define tvb_get_letohl(tvb, offset)	tvb_get_letohl_inline(tvb, offset)
+#define tvb_get_letoh64(tvb, offset)	tvb_get_letoh64_inline(tvb, offset)
+#endif /* TVB_NO_INLINE_ACCESSORS */
+
 /**
  * Fetch an IPv4 address, in network byte order.
  * We do *not* convert it to host byte order; we leave it in
@@ -367,6 +431,36 @@ extern void* ep_tvb_memdup(tvbuff_t *tvb, const gint offset, size_t length);
  * tvbuff_free_cb_t() is called, if any. */
 extern const guint8* tvb_get_ptr(tvbuff_t*, const gint offset, const gint length);
 
+/** Walks the bytes referred to by 'offset'/'length' as a series of
+ * contiguous chunks, without flattening TVBUFF_COMPOSITE tvbuffs the
+ * way tvb_get_ptr() does. Use it to stream large reassembled payloads:
+ *
+ *     tvb_chunk_iter_t iter;
+ *     const guint8 *chunk;
+ *     guint chunk_length;
+ *
+ *     tvb_chunk_iter_init(&iter, tvb, offset, length);
+ *     while ((chunk = tvb_chunk_iter_next(&iter, &chunk_length)) != NULL)
+ *         consume(chunk, chunk_length);
+ *
+ * The chunks point into the tvbuff's own data, with the same rules as the
+ * pointer returned by tvb_get_ptr(). */
+typedef struct {
+	tvbuff_t	*tvb;
+	guint		offset;
+	guint		remaining;
+} tvb_chunk_iter_t;
+
+/** Start walking the given range. Throws an exception if the range isn't
+ * within the tvbuff; a length of -1 means "to the end of the tvbuff". */
+extern void tvb_chunk_iter_init(tvb_chunk_iter_t *iter, tvbuff_t *tvb,
+    const gint offset, const gint length);
+
+/** Returns the next chunk and stores its length in 'chunk_length', or
+ * returns NULL once the whole range has been walked. */
+extern const guint8* tvb_chunk_iter_next(tvb_chunk_iter_t *iter,
+    guint *chunk_length);
+
 /** Find first occurence of any of the needles in tvbuff, starting at offset.
  * Searches at most maxlength number of bytes; if maxlength is -1, searches
  * to end of tvbuff.
@@ -694,6 +788,21 @@ extern tvbuff_t* tvb_uncompress(tvbuff_t *tvb, const int offset,  int comprlen);
  */
 extern tvbuff_t* tvb_child_uncompress(tvbuff_t *parent, tvbuff_t *tvb, const int offset, int comprlen);
 
+/** Statistics for the cache of tvb_uncompress() results */
+typedef struct {
+	guint	hits;		/**< Lookups answered from the cache */
+	guint	misses;		/**< Lookups that had to inflate the data */
+	guint	entries;	/**< Results currently cached */
+	gsize	bytes;		/**< Memory used by the cached results */
+} tvb_uncompress_cache_stats_t;
+
+/** Throw away all cached tvb_uncompress() results and reset the
+ * statistics.  Called whenever dissection is (re)initialized. */
+extern void tvb_uncompress_cache_clear(void);
+
+/** Fill in the current tvb_uncompress() cache statistics */
+extern void tvb_uncompress_cache_get_stats(tvb_uncompress_cache_stats_t *stats);
+
 /************** END OF ACCESSORS ****************/
 
 #ifdef __cplusplus
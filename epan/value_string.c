@@ -27,6 +27,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "to_str.h"
 #include "emem.h"
@@ -147,6 +148,61 @@ value_string_ext_new(value_string *vs, guint vs_tot_num_entries, gchar *vs_name)
     return vse;
 }
 
+static int
+vs_ptr_compare(const void *a, const void *b)
+{
+    const value_string *vs_a = *(const value_string * const *)a;
+    const value_string *vs_b = *(const value_string * const *)b;
+
+    if (vs_a->value != vs_b->value)
+        return (vs_a->value < vs_b->value) ? -1 : 1;
+    /* Same value: keep the entries in array order */
+    return (vs_a < vs_b) ? -1 : (vs_a > vs_b);
+}
+
+/* Create a value_string_ext for a plain value_string array that returns the
+ *  same string match_strval() would, using direct access or a binary search.
+ *  If the array isn't in strictly ascending order, a sorted copy of it is
+ *  indexed instead, with only the first entry (the one match_strval() finds)
+ *  kept for each value; VALUE_STRING_EXT_VS_P() of the result is then not vs.
+ * Return: NULL if vs has fewer than min_entries entries (for which a linear
+ *  search is about as fast), otherwise a g_malloc'd value_string_ext.
+ */
+value_string_ext *
+value_string_ext_new_index(const value_string *vs, const guint min_entries, const gchar *vs_name) {
+    const value_string **sorted;
+    value_string        *copy;
+    gboolean             ascending = TRUE;
+    guint                num_entries, i, j;
+
+    for (num_entries = 0; vs[num_entries].strptr != NULL; num_entries++) {
+        if ((num_entries > 0) && (vs[num_entries].value <= vs[num_entries-1].value))
+            ascending = FALSE;
+    }
+    if (num_entries < min_entries)
+        return NULL;
+
+    if (ascending)
+        return value_string_ext_new((value_string *)vs, num_entries + 1, (gchar *)vs_name);
+
+    sorted = g_new(const value_string *, num_entries);
+    for (i = 0; i < num_entries; i++)
+        sorted[i] = &vs[i];
+    qsort(sorted, num_entries, sizeof (const value_string *), vs_ptr_compare);
+
+    copy = g_new(value_string, num_entries + 1);
+    for (i = 0, j = 0; i < num_entries; i++) {
+        if ((j > 0) && (copy[j-1].value == sorted[i]->value))
+            continue;
+        copy[j++] = *sorted[i];
+    }
+    copy[j].value  = 0;
+    copy[j].strptr = NULL;
+    g_free(sorted);
+
+    return value_string_ext_new(copy, j + 1, (gchar *)vs_name);
+}
+
 /* Looks up val in a value_string array using access method (direct, binary search
  *  or linear) determined at rutime during the initial access); (see _match_strval_ext_init)
  * Returns the associated string ptr on a match, and returns NULL on failure.
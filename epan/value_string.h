@@ -144,6 +144,12 @@ extern const value_string *_match_strval_ext_init(const guint32 val, const value
 /* Return: a pointer to a gmalloc'd and initialized value_string_ext struct.                      */
 extern value_string_ext *value_string_ext_new(value_string *vs, guint vs_tot_num_entries, gchar *vs_name);
 
+/* Create a value_string_ext that looks up values in the plain value_string array vs,   */
+/*  returning the same string match_strval() would.  Arrays that aren't in strictly     */
+/*  ascending order are indexed through a sorted, g_malloc'd copy.                      */
+/* Return: NULL if vs has fewer than min_entries entries, else a gmalloc'd struct.      */
+extern value_string_ext *value_string_ext_new_index(const value_string *vs, const guint min_entries, const gchar *vs_name);
+
 /* Looks up val in a value_string array using access method (direct, binary search
  *  or linear) determined at rutime during the initial access); (see _match_strval_ext_init)
  * Returns the associated string ptr on a match or NULL on failure.
@@ -93,8 +93,37 @@ static void cf_reset_state(capture_file *cf);
 static int read_packet(capture_file *cf, dfilter_t *dfcode,
     gboolean filtering_tap_listeners, guint tap_flags, gint64 offset);
 
+/* How much of the capture rescan_packets() has to dissect again. */
+typedef enum {
+  RESCAN_ALL,       /* dissect every frame */
+  RESCAN_PASSED,    /* the new filter is narrower; dissect only frames that
+                       passed the previous one */
+  RESCAN_CACHED     /* restore the results at the head of cf->dfilter_results */
+} rescan_scope_t;
+
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item,
-    gboolean refilter, gboolean redissect);
+    gboolean refilter, gboolean redissect, rescan_scope_t scope);
+
+/*
+ * Per-frame results of a recently applied display filter, one bit per
+ * frame, so that going back to that filter needs no dissection at all.
+ */
+typedef struct {
+  gchar   *dftext;      /* filter text, "" if there was no filter */
+  guint32  count;       /* number of frames the results cover */
+  guint8  *passed;      /* passed_dfilter flag of each frame */
+  guint8  *dependent;   /* dependent_of_displayed flag of each frame */
+} dfilter_results_t;
+
+/* Number of filters whose results we remember. */
+#define N_DFILTER_RESULTS   8
+
+#define DFILTER_RESULT_BIT(bits, framenum) \
+  (((bits)[((framenum) - 1) >> 3] >> (((framenum) - 1) & 7)) & 1)
+
+static void cf_save_dfilter_results(capture_file *cf);
+static dfilter_results_t *cf_lookup_dfilter_results(capture_file *cf, const char *dftext);
+static void cf_invalidate_dfilter_results(capture_file *cf);
 
 typedef enum {
   MR_NOTMATCHED,
@@ -408,6 +437,8 @@ cf_reset_state(capture_file *cf)
 
   dfilter_free(cf->rfcode);
   cf->rfcode = NULL;
+  cf_invalidate_dfilter_results(cf);
+  cf->dfilter_flags_valid = TRUE;
   if (cf->frames != NULL) {
     free_frame_data_sequence(cf->frames);
     cf->frames = NULL;
@@ -1505,6 +1536,7 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
   const char *filter_old = cf->dfilter ? cf->dfilter : "";
   dfilter_t   *dfcode;
   GTimeVal     start_time;
+  rescan_scope_t scope;
 
   /* if new filter equals old one, do nothing unless told to do so */
   if (!force && strcmp(filter_new, filter_old) == 0) {
@@ -1545,6 +1577,23 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
     }
   }
 
+  /* Decide how much of the capture has to be dissected again.  Taps
+     see only the frames that get dissected, so if any of them need
+     the frames we have to dissect them all. */
+  scope = RESCAN_ALL;
+  if (cf->dfilter_flags_valid && !tap_listeners_require_dissection() &&
+      strcmp(filter_new, filter_old) != 0) {
+    /* Remember how the frames fared with the old filter... */
+    cf_save_dfilter_results(cf);
+
+    /* ...and see whether we already know how they fare with the new
+       one, or whether the new one can only drop frames. */
+    if (cf_lookup_dfilter_results(cf, dftext ? dftext : "") != NULL)
+      scope = RESCAN_CACHED;
+    else if (dfilter_is_narrowing(cf->dfilter, dftext))
+      scope = RESCAN_PASSED;
+  }
+
   /* We have a valid filter.  Replace the current filter. */
   g_free(cf->dfilter);
   cf->dfilter = dftext;
@@ -1554,9 +1603,9 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
   /* Now rescan the packet list, applying the new filter, but not
      throwing away information constructed on a previous pass. */
   if (dftext == NULL) {
-    rescan_packets(cf, "Resetting", "Filter", TRUE, FALSE);
+    rescan_packets(cf, "Resetting", "Filter", TRUE, FALSE, scope);
   } else {
-    rescan_packets(cf, "Filtering", dftext, TRUE, FALSE);
+    rescan_packets(cf, "Filtering", dftext, TRUE, FALSE, scope);
   }
 
   /* Cleanup and release all dfilter resources */
@@ -1568,6 +1617,8 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
 void
 cf_reftime_packets(capture_file *cf)
 {
+  /* Filters on relative times may now give different results. */
+  cf_invalidate_dfilter_results(cf);
 
   ref_time_packets(cf);
 }
@@ -1575,7 +1626,125 @@ cf_reftime_packets(capture_file *cf)
 void
 cf_redissect_packets(capture_file *cf)
 {
-  rescan_packets(cf, "Reprocessing", "all packets", TRUE, TRUE);
+  rescan_packets(cf, "Reprocessing", "all packets", TRUE, TRUE, RESCAN_ALL);
+}
+
+/*
+ * Save the current filter results of all frames in the list of recently
+ * used filter results, most recently used first.
+ */
+static void
+cf_save_dfilter_results(capture_file *cf)
+{
+  const char        *dftext = cf->dfilter ? cf->dfilter : "";
+  dfilter_results_t *results;
+  GSList            *last;
+  guint32            framenum;
+  gsize              bitmap_size;
+  frame_data        *fdata;
+
+  if (cf->count == 0)
+    return;
+
+  results = cf_lookup_dfilter_results(cf, dftext);
+  if (results == NULL) {
+    results = g_new(dfilter_results_t, 1);
+    results->dftext = g_strdup(dftext);
+    results->passed = NULL;
+    results->dependent = NULL;
+    cf->dfilter_results = g_slist_prepend(cf->dfilter_results, results);
+
+    if (g_slist_length(cf->dfilter_results) > N_DFILTER_RESULTS) {
+      last = g_slist_last(cf->dfilter_results);
+      results = (dfilter_results_t *)last->data;
+      g_free(results->dftext);
+      g_free(results->passed);
+      g_free(results->dependent);
+      g_free(results);
+      cf->dfilter_results = g_slist_delete_link(cf->dfilter_results, last);
+      results = (dfilter_results_t *)cf->dfilter_results->data;
+    }
+  }
+
+  bitmap_size = (cf->count + 7) / 8;
+  results->count = cf->count;
+  results->passed = (guint8 *)g_realloc(results->passed, bitmap_size);
+  results->dependent = (guint8 *)g_realloc(results->dependent, bitmap_size);
+  memset(results->passed, 0, bitmap_size);
+  memset(results->dependent, 0, bitmap_size);
+  for (framenum = 1; framenum <= cf->count; framenum++) {
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    if (fdata->flags.passed_dfilter)
+      results->passed[(framenum - 1) >> 3] |= 1 << ((framenum - 1) & 7);
+    if (fdata->flags.dependent_of_displayed)
+      results->dependent[(framenum - 1) >> 3] |= 1 << ((framenum - 1) & 7);
+  }
+}
+
+/*
+ * Find the saved results of a filter that cover all frames, and make
+ * them the most recently used ones.
+ */
+static dfilter_results_t *
+cf_lookup_dfilter_results(capture_file *cf, const char *dftext)
+{
+  GSList            *item;
+  dfilter_results_t *results;
+
+  for (item = cf->dfilter_results; item != NULL; item = g_slist_next(item)) {
+    results = (dfilter_results_t *)item->data;
+    if (strcmp(results->dftext, dftext) == 0) {
+      if (results->count != cf->count)
+        return NULL;
+      cf->dfilter_results = g_slist_delete_link(cf->dfilter_results, item);
+      cf->dfilter_results = g_slist_prepend(cf->dfilter_results, results);
+      return results;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Something that filters can test (a mark, a time reference, a comment,
+ * the dissection itself) changed, so neither the saved results nor the
+ * frames' current flags can be trusted any more.
+ */
+static void
+cf_invalidate_dfilter_results(capture_file *cf)
+{
+  GSList            *item;
+  dfilter_results_t *results;
+
+  for (item = cf->dfilter_results; item != NULL; item = g_slist_next(item)) {
+    results = (dfilter_results_t *)item->data;
+    g_free(results->dftext);
+    g_free(results->passed);
+    g_free(results->dependent);
+    g_free(results);
+  }
+  g_slist_free(cf->dfilter_results);
+  cf->dfilter_results = NULL;
+  cf->dfilter_flags_valid = FALSE;
+}
+
+/*
+ * Account for a frame we're not dissecting again, because its
+ * "passed_dfilter" flag is already known, the way
+ * add_packet_to_packet_list() does for frames it dissects.
+ */
+static void
+add_undissected_packet(capture_file *cf, frame_data *fdata)
+{
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &first_ts, &prev_dis_ts, &prev_cap_ts);
+
+  if (fdata->flags.passed_dfilter || fdata->flags.ref_time) {
+    cf->displayed_count++;
+    frame_data_set_after_dissect(fdata, &cum_bytes, &prev_dis_ts);
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+  }
 }
 
 gboolean
@@ -1650,10 +1819,15 @@ cf_read_frame(capture_file *cf, frame_data *fdata)
    "redissect" is TRUE if we need to make the dissectors reconstruct
    any state information they have (because a preference that affects
    some dissector has changed, meaning some dissector might construct
-   its state differently from the way it was constructed the last time). */
+   its state differently from the way it was constructed the last time).
+
+   "scope" says which frames actually have to be dissected; with
+   RESCAN_PASSED, frames that didn't pass the previous filter are known
+   not to pass the current one, and with RESCAN_CACHED the filter results
+   are taken from cf->dfilter_results without dissecting anything. */
 static void
 rescan_packets(capture_file *cf, const char *action, const char *action_item,
-        gboolean refilter, gboolean redissect)
+        gboolean refilter, gboolean redissect, rescan_scope_t scope)
 {
   /* Rescan packets new packet list */
   guint32     framenum;
@@ -1674,6 +1848,7 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
   guint       tap_flags;
   gboolean    add_to_packet_list = FALSE;
   gboolean compiled;
+  dfilter_results_t *cached = NULL;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -1721,6 +1896,15 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
      * packet list store. */
     new_packet_list_clear();
     add_to_packet_list = TRUE;
+
+    /* Nothing we remember about filter results holds any more. */
+    cf_invalidate_dfilter_results(cf);
+  }
+
+  g_assert(scope == RESCAN_ALL || (refilter && !redissect));
+  if (scope == RESCAN_CACHED) {
+    /* cf_lookup_dfilter_results() moved them to the head of the list. */
+    cached = (dfilter_results_t *)cf->dfilter_results->data;
   }
 
   /* We don't yet know which will be the first and last frames displayed. */
@@ -1830,9 +2014,6 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
       fdata->flags.dependent_of_displayed = 0;
     }
 
-    if (!cf_read_frame(cf, fdata))
-      break; /* error reading the frame */
-
     /* If the previous frame is displayed, and we haven't yet seen the
        selected frame, remember that frame - it's the closest one we've
        yet seen before the selected frame. */
@@ -1840,10 +2021,24 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
       preceding_frame_num = prev_frame_num;
       preceding_frame = prev_frame;
     }
-    add_packet_to_packet_list(fdata, cf, dfcode, filtering_tap_listeners,
-                                    tap_flags, &cf->pseudo_header, cf->pd,
-                                    refilter,
-                                    add_to_packet_list);
+
+    if (scope == RESCAN_CACHED) {
+      fdata->flags.passed_dfilter = DFILTER_RESULT_BIT(cached->passed, framenum);
+      fdata->flags.dependent_of_displayed = DFILTER_RESULT_BIT(cached->dependent, framenum);
+      add_undissected_packet(cf, fdata);
+    } else if (scope == RESCAN_PASSED && !fdata->flags.passed_dfilter &&
+               !fdata->flags.ref_time) {
+      /* It didn't pass the broader filter, so it won't pass this one. */
+      add_undissected_packet(cf, fdata);
+    } else {
+      if (!cf_read_frame(cf, fdata))
+        break; /* error reading the frame */
+
+      add_packet_to_packet_list(fdata, cf, dfcode, filtering_tap_listeners,
+                                      tap_flags, &cf->pseudo_header, cf->pd,
+                                      refilter,
+                                      add_to_packet_list);
+    }
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -1868,6 +2063,10 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
   /* We are done redissecting the packet list. */
   cf->redissecting = FALSE;
 
+  /* If we stopped early, the frames we didn't get to still have the
+     results of the previous filter. */
+  cf->dfilter_flags_valid = (framenum > cf->count);
+
   if (redissect) {
     /* Clear out what remains of the visited flags and per-frame data
        pointers.
@@ -2926,10 +3125,21 @@ cf_find_packet_summary_line(capture_file *cf, const char *string,
                             search_direction dir)
 {
   match_data        mdata;
+  gboolean          *cols_needed;
+  gboolean          result;
+  gint              colx;
+
+  /* Only the Info column is looked at, so don't format the others. */
+  cols_needed = g_new(gboolean, cf->cinfo.num_cols);
+  for (colx = 0; colx < cf->cinfo.num_cols; colx++)
+    cols_needed[colx] = cf->cinfo.fmt_matx[colx][COL_INFO];
 
   mdata.string = string;
   mdata.string_len = strlen(string);
-  return find_packet(cf, match_summary_line, &mdata, dir);
+  mdata.cols_needed = cols_needed;
+  result = find_packet(cf, match_summary_line, &mdata, dir);
+  g_free(cols_needed);
+  return result;
 }
 
 static match_result
@@ -2956,7 +3166,9 @@ match_summary_line(capture_file *cf, frame_data *fdata, void *criterion)
   /* Don't bother constructing the protocol tree */
   epan_dissect_init(&edt, FALSE, FALSE);
   /* Get the column information */
+  col_set_needed(&cf->cinfo, mdata->cols_needed);
   epan_dissect_run(&edt, &cf->pseudo_header, cf->pd, fdata, &cf->cinfo);
+  col_set_needed(&cf->cinfo, NULL);
 
   /* Find the Info column */
   for (colx = 0; colx < cf->cinfo.num_cols; colx++) {
@@ -3627,6 +3839,7 @@ void
 cf_mark_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->flags.marked) {
+    cf_invalidate_dfilter_results(cf);
     frame->flags.marked = TRUE;
     if (cf->count > cf->marked_count)
       cf->marked_count++;
@@ -3640,6 +3853,7 @@ void
 cf_unmark_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->flags.marked) {
+    cf_invalidate_dfilter_results(cf);
     frame->flags.marked = FALSE;
     if (cf->marked_count > 0)
       cf->marked_count--;
@@ -3653,6 +3867,7 @@ void
 cf_ignore_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->flags.ignored) {
+    cf_invalidate_dfilter_results(cf);
     frame->flags.ignored = TRUE;
     if (cf->count > cf->ignored_count)
       cf->ignored_count++;
@@ -3666,6 +3881,7 @@ void
 cf_unignore_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->flags.ignored) {
+    cf_invalidate_dfilter_results(cf);
     frame->flags.ignored = FALSE;
     if (cf->ignored_count > 0)
       cf->ignored_count--;
@@ -3721,6 +3937,8 @@ cf_update_capture_comment(capture_file *cf, gchar *comment)
 void
 cf_update_packet_comment(capture_file *cf, frame_data *fdata, gchar *comment)
 {
+  cf_invalidate_dfilter_results(cf);
+
   if (fdata->opt_comment != NULL) {
     /* OK, remove the old comment. */
     g_free(fdata->opt_comment);
@@ -96,6 +96,7 @@ typedef struct {
     capture_file  *cf;
     gboolean       frame_matched;
     field_info    *finfo;
+    const gboolean *cols_needed;
 } match_data;
 
 extern void
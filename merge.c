@@ -28,6 +28,16 @@
 #include "wtap.h"
 #include "merge.h"
 
+/*
+ * merge_read_packet() keeps the files that have a packet waiting in a
+ * binary min-heap ordered by the time stamp of that packet, so that
+ * finding the earliest packet doesn't mean looking at every file.  The
+ * heap holds indices into the in_files array it was built for.
+ */
+static merge_in_file_t *heap_files = NULL;
+static int             *heap = NULL;
+static int              heap_len = 0;
+
 /*
  * Scan through the arguments and open the input files
  */
@@ -79,6 +89,13 @@ merge_close_in_files(int count, merge_in_file_t in_files[])
   for (i = 0; i < count; i++) {
     wtap_close(in_files[i].wth);
   }
+
+  if (heap_files == in_files) {
+    g_free(heap);
+    heap = NULL;
+    heap_len = 0;
+    heap_files = NULL;
+  }
 }
 
 /*
@@ -148,6 +165,77 @@ is_earlier(struct wtap_nstime *l, struct wtap_nstime *r) {
   return TRUE;
 }
 
+/*
+ * returns TRUE if the packet waiting in file l should be merged before
+ * the one waiting in file r; of packets with the same time stamp, the one
+ * from the file later in the list goes first
+ */
+static gboolean
+heap_before(merge_in_file_t in_files[], int l, int r)
+{
+  struct wtap_nstime *lts = &wtap_phdr(in_files[l].wth)->ts;
+  struct wtap_nstime *rts = &wtap_phdr(in_files[r].wth)->ts;
+
+  if (lts->secs != rts->secs || lts->nsecs != rts->nsecs)
+    return is_earlier(lts, rts);
+  return l > r;
+}
+
+static void
+heap_sift_down(merge_in_file_t in_files[], int pos)
+{
+  int child, tmp;
+
+  for (;;) {
+    child = 2 * pos + 1;
+    if (child >= heap_len)
+      break;
+    if (child + 1 < heap_len &&
+        heap_before(in_files, heap[child + 1], heap[child]))
+      child++;
+    if (!heap_before(in_files, heap[child], heap[pos]))
+      break;
+    tmp = heap[pos];
+    heap[pos] = heap[child];
+    heap[child] = tmp;
+    pos = child;
+  }
+}
+
+static void
+heap_sift_up(merge_in_file_t in_files[], int pos)
+{
+  int parent, tmp;
+
+  while (pos > 0) {
+    parent = (pos - 1) / 2;
+    if (!heap_before(in_files, heap[pos], heap[parent]))
+      break;
+    tmp = heap[pos];
+    heap[pos] = heap[parent];
+    heap[parent] = tmp;
+    pos = parent;
+  }
+}
+
+/*
+ * Read the next packet from a file, updating its state.
+ * Returns FALSE on a read error.
+ */
+static gboolean
+merge_fill_file(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+  if (!wtap_read(in_file->wth, err, err_info, &in_file->data_offset)) {
+    if (*err != 0) {
+      in_file->state = GOT_ERROR;
+      return FALSE;
+    }
+    in_file->state = AT_EOF;
+  } else
+    in_file->state = PACKET_PRESENT;
+  return TRUE;
+}
+
 /*
  * Read the next packet, in chronological order, from the set of files
  * to be merged.
@@ -166,46 +254,51 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
                   int *err, gchar **err_info)
 {
   int i;
-  int ei = -1;
-  struct wtap_nstime tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-  struct wtap_pkthdr *phdr;
+  int ei;
 
-  /*
-   * Make sure we have a packet available from each file, if there are any
-   * packets left in the file in question, and search for the packet
-   * with the earliest time stamp.
-   */
-  for (i = 0; i < in_file_count; i++) {
-    if (in_files[i].state == PACKET_NOT_PRESENT) {
-      /*
-       * No packet available, and we haven't seen an error or EOF yet,
-       * so try to read the next packet.
-       */
-      if (!wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset)) {
-        if (*err != 0) {
-          in_files[i].state = GOT_ERROR;
-          return &in_files[i];
-        }
-        in_files[i].state = AT_EOF;
-      } else
-        in_files[i].state = PACKET_PRESENT;
-    }
-    
-    if (in_files[i].state == PACKET_PRESENT) {
-      phdr = wtap_phdr(in_files[i].wth);
-      if (is_earlier(&phdr->ts, &tv)) {
-        tv = phdr->ts;
-        ei = i;
+  if (heap_files != in_files) {
+    /*
+     * First packet: make sure we have a packet available from each
+     * file, if there are any packets left in the file in question, and
+     * put the files that have one into the heap.
+     */
+    g_free(heap);
+    heap = g_new(int, in_file_count);
+    heap_len = 0;
+    heap_files = in_files;
+    for (i = 0; i < in_file_count; i++) {
+      if (in_files[i].state == PACKET_NOT_PRESENT &&
+          !merge_fill_file(&in_files[i], err, err_info)) {
+        heap_files = NULL;
+        return &in_files[i];
+      }
+      if (in_files[i].state == PACKET_PRESENT) {
+        heap[heap_len++] = i;
+        heap_sift_up(in_files, heap_len - 1);
       }
     }
+  } else if (heap_len > 0 &&
+             in_files[heap[0]].state == PACKET_NOT_PRESENT) {
+    /*
+     * The file we returned the last packet from is at the top of the
+     * heap; read its next packet and move it to where that belongs.
+     */
+    ei = heap[0];
+    if (!merge_fill_file(&in_files[ei], err, err_info))
+      return &in_files[ei];
+    if (in_files[ei].state == AT_EOF)
+      heap[0] = heap[--heap_len];
+    heap_sift_down(in_files, 0);
   }
 
-  if (ei == -1) {
+  if (heap_len == 0) {
     /* All the streams are at EOF.  Return an EOF indication. */
     *err = 0;
     return NULL;
   }
 
+  ei = heap[0];
+
   /* We'll need to read another packet from this file. */
   in_files[ei].state = PACKET_NOT_PRESENT;
 
@@ -129,6 +129,7 @@ usage(void)
   fprintf(stderr, "  -T <encap type>   set the output file encapsulation type;\n");
   fprintf(stderr, "                    default is the same as the first input file.\n");
   fprintf(stderr, "                    an empty \"-T\" option will list the encapsulation types.\n");
+  fprintf(stderr, "  -z <compression>  compress the output file; \"gzip\" or \"zstd\".\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "Miscellaneous:\n");
   fprintf(stderr, "  -h                display this help and exit.\n");
@@ -211,6 +212,7 @@ main(int argc, char *argv[])
   int          file_type = WTAP_FILE_PCAP;	/* default to pcapng format */
 #endif
   int          frame_type = -2;
+  int          compression = WTAP_UNCOMPRESSED;
   int          out_fd;
   merge_in_file_t   *in_files      = NULL, *in_file;
   int          i;
@@ -228,7 +230,7 @@ main(int argc, char *argv[])
 #endif /* _WIN32 */
 
   /* Process the options first */
-  while ((opt = getopt(argc, argv, "hvas:T:F:w:")) != -1) {
+  while ((opt = getopt(argc, argv, "hvas:T:F:w:z:")) != -1) {
 
     switch (opt) {
     case 'w':
@@ -267,6 +269,15 @@ main(int argc, char *argv[])
       snaplen = get_positive_int(optarg, "snapshot length");
       break;
 
+    case 'z':
+      compression = wtap_short_string_to_compression_type(optarg);
+      if (compression < 0) {
+        fprintf(stderr, "mergecap: \"%s\" isn't a supported compression type\n",
+            optarg);
+        exit(1);
+      }
+      break;
+
     case 'h':
       usage();
       exit(0);
@@ -405,10 +416,10 @@ main(int argc, char *argv[])
     shb_hdr->shb_user_appl =	"mergecap";	/* NULL if not available, UTF-8 string containing the name of the application used to create this section. */
 
     pdh = wtap_dump_fdopen_ng(out_fd, file_type, frame_type, snaplen,
-                              FALSE /* compressed */, shb_hdr, NULL /* wtapng_iface_descriptions_t *idb_inf */, &open_err);
+                              compression, shb_hdr, NULL /* wtapng_iface_descriptions_t *idb_inf */, &open_err);
     g_string_free(comment_gstr, TRUE);
   }else{
-       pdh = wtap_dump_fdopen(out_fd, file_type, frame_type, snaplen, FALSE /* compressed */, &open_err);
+       pdh = wtap_dump_fdopen(out_fd, file_type, frame_type, snaplen, compression, &open_err);
   }
   if (pdh == NULL) {
     merge_close_in_files(in_file_count, in_files);
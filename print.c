@@ -1669,6 +1669,12 @@ const gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
             /* Print out the full details for the protocol. */
             if (fi->rep) {
                 return fi->rep->representation;
+            } else if (fi->deferred_rep) {
+                /* The label hasn't been rendered yet */
+                gchar *label_str = ep_alloc(ITEM_LABEL_LENGTH);
+
+                proto_item_fill_label(fi, label_str);
+                return label_str;
             } else {
                 /* Just print out the protocol abbreviation */
                 return fi->hfinfo->abbrev;
@@ -49,6 +49,7 @@ fi
 WIRESHARK=$WS_BIN_PATH/wireshark
 TSHARK=$WS_BIN_PATH/tshark
 CAPINFOS=$WS_BIN_PATH/capinfos
+EDITCAP=$WS_BIN_PATH/editcap
 DUMPCAP=$WS_BIN_PATH/dumpcap
 
 # interface with at least a few packets/sec traffic on it
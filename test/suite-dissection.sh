@@ -0,0 +1,86 @@
+#!/bin/bash
+#
+# Test the dissection of sample captures
+#
+# $Id$
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 2005 Ulf Lamping
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+
+
+# common exit status values
+EXIT_OK=0
+EXIT_COMMAND_LINE=1
+EXIT_ERROR=2
+
+# TCP out-of-order desegmentation.
+# dns-tcp-ooo-straddle.pcap carries two DNS messages over TCP, A at
+# relative sequence numbers [1,2001) and B at [2001,3501).  The end of
+# B (frame 5) arrives before the end of A has been seen.  Frame 6 then
+# holds the last 100 bytes of A and the start of B, and frame 7 fills
+# in the middle of A.  Both messages must be reassembled.
+dissection_step_tcp_ooo_straddle() {
+	$TSHARK -o "tcp.reassemble_out_of_order: TRUE" \
+		-Tfields -e frame.number -e dns.id \
+		-r "${CAPTURE_DIR}dns-tcp-ooo-straddle.pcap" \
+		-R dns > ./dissection-out.txt 2> /dev/null
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "exit status of $TSHARK: $RETURNVALUE"
+		return
+	fi
+	grep -E '^6[[:blank:]]+0x2222$' ./dissection-out.txt > /dev/null 2>&1 &&
+		grep -E '^7[[:blank:]]+0x1111$' ./dissection-out.txt > /dev/null 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "DNS messages around an out-of-order gap weren't both reassembled"
+		cat ./dissection-out.txt
+		return
+	fi
+	test_step_ok
+}
+
+tshark_dissection_suite() {
+	test_step_add "TCP out-of-order segment straddling the end of a PDU" dissection_step_tcp_ooo_straddle
+}
+
+dissection_cleanup_step() {
+	rm -f ./dissection-out.txt
+}
+
+dissection_prep_step() {
+	dissection_cleanup_step
+}
+
+dissection_suite() {
+	test_step_set_pre dissection_prep_step
+	test_step_set_post dissection_cleanup_step
+	test_suite_add "TShark dissection" tshark_dissection_suite
+}
+
+# Editor modelines
+#
+# Local Variables:
+# sh-basic-offset: 8
+# tab-width: 8
+# indent-tabs-mode: t
+# End:
+#
+# ex: set shiftwidth=8 tabstop=8 noexpandtab:
+# :indentSize=8:tabSize=8:noTabs=false:
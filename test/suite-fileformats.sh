@@ -125,6 +125,75 @@ ff_step_nsec_pcapng_direct() {
 	test_step_ok
 }
 
+# Compressed pcap written by editcap / direct
+# $1 compression type as understood by "editcap -z"
+ff_compressed_pcap_direct() {
+	$EDITCAP -z $1 "${CAPTURE_DIR}dhcp.pcap" ./ff-compressed.pcap > /dev/null 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		# editcap was built without support for this compression type
+		test_step_skipped
+		return
+	fi
+	$TSHARK $TS_FF_ARGS -r ./ff-compressed.pcap > ./ff-ts-$1-pcap-direct.txt 2> /dev/null
+	diff -u $FF_BASELINE ./ff-ts-$1-pcap-direct.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "Output of microsecond pcap direct read vs $1 compressed pcap direct read differ"
+		cat $DIFF_OUT
+		return
+	fi
+	$CAPINFOS -c "${CAPTURE_DIR}dhcp.pcap" | grep -i 'Number of packets' > ./ff-ts-capinfos.txt 2>&1
+	$CAPINFOS -c ./ff-compressed.pcap | grep -i 'Number of packets' > ./ff-ts-$1-capinfos.txt 2>&1
+	diff -u ./ff-ts-capinfos.txt ./ff-ts-$1-capinfos.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "capinfos packet count of pcap vs $1 compressed pcap differ"
+		cat $DIFF_OUT
+		return
+	fi
+	test_step_ok
+}
+
+# Compressed pcap written by editcap / two-pass read
+# The second pass fetches every packet with wtap_seek_read(), so this
+# goes through the seek point code of the decompressor.
+# $1 compression type as understood by "editcap -z"
+ff_compressed_pcap_two_pass() {
+	$EDITCAP -z $1 "${CAPTURE_DIR}rsasnakeoil2.pcap" ./ff-compressed.pcap > /dev/null 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_skipped
+		return
+	fi
+	$TSHARK $TS_FF_ARGS -2 -R tcp -r "${CAPTURE_DIR}rsasnakeoil2.pcap" > ./ff-ts-two-pass.txt 2> /dev/null
+	$TSHARK $TS_FF_ARGS -2 -R tcp -r ./ff-compressed.pcap > ./ff-ts-$1-two-pass.txt 2> /dev/null
+	diff -u ./ff-ts-two-pass.txt ./ff-ts-$1-two-pass.txt > $DIFF_OUT 2>&1
+	RETURNVALUE=$?
+	if [ ! $RETURNVALUE -eq $EXIT_OK ]; then
+		test_step_failed "Output of two-pass pcap read vs two-pass $1 compressed pcap read differ"
+		cat $DIFF_OUT
+		return
+	fi
+	test_step_ok
+}
+
+ff_step_gzip_pcap_direct() {
+	ff_compressed_pcap_direct gzip
+}
+
+ff_step_zstd_pcap_direct() {
+	ff_compressed_pcap_direct zstd
+}
+
+ff_step_gzip_pcap_two_pass() {
+	ff_compressed_pcap_two_pass gzip
+}
+
+ff_step_zstd_pcap_two_pass() {
+	ff_compressed_pcap_two_pass zstd
+}
+
 tshark_ff_suite() {
 	# Microsecond pcap direct read is used as the baseline.
 	test_step_add "Microsecond pcap via stdin" ff_step_usec_pcap_stdin
@@ -134,10 +203,15 @@ tshark_ff_suite() {
 	test_step_add "Microsecond pcap-ng direct read" ff_step_usec_pcapng_direct
 #	test_step_add "Nanosecond pcap-ng via stdin" ff_step_nsec_pcapng_stdin
 	test_step_add "Nanosecond pcap-ng direct read" ff_step_nsec_pcapng_direct
+	test_step_add "gzip compressed pcap direct read" ff_step_gzip_pcap_direct
+	test_step_add "zstd compressed pcap direct read" ff_step_zstd_pcap_direct
+	test_step_add "gzip compressed pcap two-pass read" ff_step_gzip_pcap_two_pass
+	test_step_add "zstd compressed pcap two-pass read" ff_step_zstd_pcap_two_pass
 }
 
 ff_cleanup_step() {
 	rm -f ./ff-ts-*.txt
+	rm -f ./ff-compressed.pcap
 	rm -f $DIFF_OUT
 }
 
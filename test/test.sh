@@ -53,6 +53,7 @@ Usage: $THIS [-c] [-h] [-s <suite>]
       capture
       clopts
       decryption
+      dissection
       fileformats
       io
       prerequisites
@@ -70,13 +71,14 @@ source suite-capture.sh
 source suite-unittests.sh
 source suite-fileformats.sh
 source suite-decryption.sh
+source suite-dissection.sh
 
 
 #check prerequisites
 test_step_prerequisites() {
 
 	NOTFOUND=0
-	for i in "$WIRESHARK" "$TSHARK" "$CAPINFOS" "$DUMPCAP" ; do
+	for i in "$WIRESHARK" "$TSHARK" "$CAPINFOS" "$EDITCAP" "$DUMPCAP" ; do
 		if [ ! -x $i ]; then
 			echo "Couldn't find $i"
 			NOTFOUND=1
@@ -116,6 +118,7 @@ test_suite() {
 	test_suite_add "Unit tests" unittests_suite
 	test_suite_add "File formats" fileformats_suite
 	test_suite_add "Decryption" decryption_suite
+	test_suite_add "Dissection" dissection_suite
 }
 
 
@@ -146,6 +149,9 @@ if [ -n "$RUN_SUITE" ] ; then
 	  "decryption")
 	    test_suite_run "Decryption" decryption_suite
             exit $? ;;
+	  "dissection")
+	    test_suite_run "Dissection" dissection_suite
+            exit $? ;;
 	  "fileformats")
             test_suite_run "File formats" fileformats_suite
             exit $? ;;
@@ -0,0 +1,201 @@
+#!/usr/bin/python
+#
+# Benchmark TCP sequence analysis on a synthetic long fat pipe capture
+#
+# Writes a capture of a single bulk TCP transfer with a large number of
+# segments in flight, optionally losing some of them, and times TShark
+# reading it with TCP sequence analysis enabled.
+#
+# $Id$
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+#
+
+from optparse import OptionParser
+import collections
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+SNAPLEN = 54    # Ethernet, IPv4 and TCP headers only
+
+def ip_checksum(hdr):
+    s = 0
+    for i in range(0, len(hdr), 2):
+        s += (ord(hdr[i:i+1]) << 8) + ord(hdr[i+1:i+2])
+    while s >> 16:
+        s = (s & 0xffff) + (s >> 16)
+    return ~s & 0xffff
+
+class Writer:
+    def __init__(self, f):
+        self.f = f
+        self.usecs = 0
+        self.ip_id = 0
+        # pcap file header, Ethernet
+        f.write(struct.pack("<IHHiIII", 0xa1b2c3d4, 2, 4, 0, 0, SNAPLEN, 1))
+
+    def packet(self, to_server, seq, ack, flags, seglen, win):
+        self.usecs += 10
+        self.ip_id = (self.ip_id + 1) & 0xffff
+        if to_server:
+            (src, dst, sport, dport) = (0x0a000001, 0x0a000002, 40000, 5001)
+        else:
+            (src, dst, sport, dport) = (0x0a000002, 0x0a000001, 5001, 40000)
+        ip = struct.pack("!BBHHHBBHII", 0x45, 0, 40 + seglen, self.ip_id, 0x4000, 64, 6, 0, src, dst)
+        ip = ip[:10] + struct.pack("!H", ip_checksum(ip)) + ip[12:]
+        tcp = struct.pack("!HHIIBBHHH", sport, dport, seq & 0xffffffff, ack & 0xffffffff,
+                          5 << 4, flags, win, 0, 0)
+        eth = struct.pack("!6s6sH", b"\x00\x00\x00\x00\x00\x02", b"\x00\x00\x00\x00\x00\x01", 0x0800)
+        self.f.write(struct.pack("<IIII", self.usecs // 1000000, self.usecs % 1000000,
+                                 SNAPLEN, 14 + 40 + seglen))
+        self.f.write(eth + ip + tcp)
+
+class Receiver:
+    def __init__(self, seq, mss):
+        self.next = seq
+        self.mss = mss
+        self.buffered = set()
+
+    def arrive(self, seq):
+        if seq == self.next:
+            self.next += self.mss
+            while self.next in self.buffered:
+                self.buffered.remove(self.next)
+                self.next += self.mss
+        elif seq > self.next:
+            self.buffered.add(seq)
+
+def write_capture(f, options):
+    rand = random.Random(options.seed)
+    w = Writer(f)
+    mss = options.mss
+    isn_c = rand.randrange(1 << 32)
+    isn_s = rand.randrange(1 << 32)
+
+    w.packet(True, isn_c, 0, 0x02, 0, 65535)
+    w.packet(False, isn_s, isn_c + 1, 0x12, 0, 65535)
+    w.packet(True, isn_c + 1, isn_s + 1, 0x10, 0, 65535)
+
+    # Keep options.window segments in flight and ACK every other segment
+    # that arrives.  Lost segments are retransmitted after three duplicate
+    # ACKs.
+    snd = isn_c + 1
+    rcv = Receiver(snd, mss)
+    flight = collections.deque()
+    missing = []
+    arrivals = 0
+    dups = 0
+    for i in range(options.segments):
+        w.packet(True, snd, isn_s + 1, 0x18, mss, 65535)
+        flight.append((snd, rand.random() < options.loss))
+        snd += mss
+        if len(flight) < options.window:
+            continue
+
+        (seq, lost) = flight.popleft()
+        if lost:
+            missing.append(seq)
+        else:
+            rcv.arrive(seq)
+        arrivals += 1
+        if arrivals % 2 == 0:
+            w.packet(False, isn_s + 1, rcv.next, 0x10, 0, 65535)
+            if missing and rcv.next == missing[0]:
+                dups += 1
+                if dups == 3:
+                    seq = missing.pop(0)
+                    w.packet(True, seq, isn_s + 1, 0x18, mss, 65535)
+                    rcv.arrive(seq)
+                    dups = 0
+
+    while flight:
+        (seq, lost) = flight.popleft()
+        if lost:
+            missing.append(seq)
+        else:
+            rcv.arrive(seq)
+    for seq in missing:
+        w.packet(True, seq, isn_s + 1, 0x18, mss, 65535)
+        rcv.arrive(seq)
+    w.packet(False, isn_s + 1, rcv.next, 0x10, 0, 65535)
+
+    w.packet(True, snd, isn_s + 1, 0x11, 0, 65535)
+    w.packet(False, isn_s + 1, snd + 1, 0x11, 0, 65535)
+    w.packet(True, snd + 1, isn_s + 2, 0x10, 0, 65535)
+
+def main():
+    parser = OptionParser(usage="usage: %prog [options] [capture_file]")
+    parser.add_option("-b", "--binary-dir", dest="bin_dir", default=os.getcwd(),
+                      help="directory containing tshark executable")
+    parser.add_option("-n", "--segments", dest="segments", default=200000, type="int",
+                      help="number of data segments to send")
+    parser.add_option("-w", "--window", dest="window", default=20000, type="int",
+                      help="number of segments in flight")
+    parser.add_option("-s", "--mss", dest="mss", default=1460, type="int",
+                      help="segment size")
+    parser.add_option("-l", "--loss", dest="loss", default=0.0005, type="float",
+                      help="fraction of segments lost and retransmitted")
+    parser.add_option("-r", "--repeat", dest="repeat", default=3, type="int",
+                      help="number of timed runs")
+    parser.add_option("", "--seed", dest="seed", default=1, type="int",
+                      help="random seed")
+    (options, args) = parser.parse_args()
+
+    if len(args) > 1:
+        parser.error("too many arguments")
+
+    if args:
+        cap_file = args[0]
+        remove = False
+    else:
+        (handle, cap_file) = tempfile.mkstemp(suffix='.pcap')
+        os.close(handle)
+        remove = True
+
+    try:
+        f = open(cap_file, "wb")
+        write_capture(f, options)
+        f.close()
+
+        tshark = os.path.join(options.bin_dir, "tshark")
+        cmd = [tshark, "-n", "-q", "-r", cap_file,
+               "-o", "tcp.analyze_sequence_numbers:TRUE",
+               "-o", "tcp.track_bytes_in_flight:TRUE"]
+        best = None
+        for i in range(options.repeat):
+            start = time.time()
+            if subprocess.call(cmd) != 0:
+                sys.stderr.write("%s failed\n" % " ".join(cmd))
+                sys.exit(1)
+            elapsed = time.time() - start
+            if best is None or elapsed < best:
+                best = elapsed
+        sys.stdout.write("%u segments, %u in flight: %.3f seconds\n" %
+                         (options.segments, options.window, best))
+    finally:
+        if remove:
+            os.remove(cap_file)
+
+if __name__ == "__main__":
+    main()
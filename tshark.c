@@ -165,6 +165,7 @@ static int load_cap_file(capture_file *, char *, int, gboolean, int, gint64);
 static gboolean process_packet(capture_file *cf, gint64 offset,
     const struct wtap_pkthdr *whdr, union wtap_pseudo_header *pseudo_header,
     const guchar *pd, gboolean filtering_tap_listeners, guint tap_flags);
+static void packet_edt_end(void);
 static void show_capture_file_io_error(const char *, int, gboolean);
 static void show_print_file_io_error(int err);
 static gboolean write_preamble(capture_file *cf);
@@ -2487,6 +2488,43 @@ capture_cleanup(int signum _U_)
 #endif /* _WIN32 */
 #endif /* HAVE_LIBPCAP */
 
+/*
+ * The dissection context used for one packet after another.  It's reset
+ * with epan_dissect_reset() after each packet, rather than cleaned up and
+ * initialized again, so that its protocol tree's memory gets reused.
+ */
+static epan_dissect_t packet_edt;
+static gboolean       packet_edt_active = FALSE;
+static gboolean       packet_edt_tree;
+static gboolean       packet_edt_visible;
+
+static epan_dissect_t *
+packet_edt_begin(gboolean create_proto_tree, gboolean proto_tree_visible)
+{
+  /* We can only reuse it if it was set up the same way. */
+  if (packet_edt_active && (packet_edt_tree != create_proto_tree ||
+                            packet_edt_visible != proto_tree_visible))
+    packet_edt_end();
+
+  if (!packet_edt_active) {
+    epan_dissect_init(&packet_edt, create_proto_tree, proto_tree_visible);
+    packet_edt_active = TRUE;
+    packet_edt_tree = create_proto_tree;
+    packet_edt_visible = proto_tree_visible;
+  }
+
+  return &packet_edt;
+}
+
+static void
+packet_edt_end(void)
+{
+  if (packet_edt_active) {
+    epan_dissect_cleanup(&packet_edt);
+    packet_edt_active = FALSE;
+  }
+}
+
 static gboolean
 process_packet_first_pass(capture_file *cf,
                gint64 offset, const struct wtap_pkthdr *whdr,
@@ -2495,7 +2533,7 @@ process_packet_first_pass(capture_file *cf,
   frame_data fdlocal;
   guint32 framenum;
   gboolean create_proto_tree = FALSE;
-  epan_dissect_t edt;
+  epan_dissect_t *edt = NULL;
   gboolean passed;
 
   /* The frame number of this packet is one more than the count of
@@ -2524,21 +2562,21 @@ process_packet_first_pass(capture_file *cf,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode ("verbose"
        is true). */
-    epan_dissect_init(&edt, create_proto_tree, FALSE);
+    edt = packet_edt_begin(create_proto_tree, FALSE);
 
     /* If we're running a read filter, prime the epan_dissect_t with that
        filter. */
     if (cf->rfcode)
-      epan_dissect_prime_dfilter(&edt, cf->rfcode);
+      epan_dissect_prime_dfilter(edt, cf->rfcode);
 
     frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
                                   &first_ts, &prev_dis_ts, &prev_cap_ts);
 
-    epan_dissect_run(&edt, pseudo_header, pd, &fdlocal, NULL);
+    epan_dissect_run(edt, pseudo_header, pd, &fdlocal, NULL);
 
     /* Run the read filter if we have one. */
     if (cf->rfcode)
-      passed = dfilter_apply_edt(cf->rfcode, &edt);
+      passed = dfilter_apply_edt(cf->rfcode, edt);
   }
 
   if (passed) {
@@ -2548,7 +2586,7 @@ process_packet_first_pass(capture_file *cf,
   }
 
   if (do_dissection)
-    epan_dissect_cleanup(&edt);
+    epan_dissect_reset(edt);
 
   return passed;
 }
@@ -2560,7 +2598,7 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
 {
   gboolean create_proto_tree;
   column_info *cinfo;
-  epan_dissect_t edt;
+  epan_dissect_t *edt = NULL;
   gboolean passed;
 
   /* If we're not running a display filter and we're not printing any
@@ -2586,16 +2624,16 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode ("verbose"
        is true). */
-    epan_dissect_init(&edt, create_proto_tree, print_packet_info && verbose);
+    edt = packet_edt_begin(create_proto_tree, print_packet_info && verbose);
 
     /* If we're running a read filter, prime the epan_dissect_t with that
        filter. */
     if (cf->rfcode)
-      epan_dissect_prime_dfilter(&edt, cf->rfcode);
+      epan_dissect_prime_dfilter(edt, cf->rfcode);
 
-    col_custom_prime_edt(&edt, &cf->cinfo);
+    col_custom_prime_edt(edt, &cf->cinfo);
 
-    tap_queue_init(&edt);
+    tap_queue_init(edt);
 
     /* We only need the columns if either
 
@@ -2610,13 +2648,13 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
     else
       cinfo = NULL;
 
-    epan_dissect_run(&edt, pseudo_header, pd, fdata, cinfo);
+    epan_dissect_run(edt, pseudo_header, pd, fdata, cinfo);
 
-    tap_push_tapped_queue(&edt);
+    tap_push_tapped_queue(edt);
 
     /* Run the read filter if we have one. */
     if (cf->rfcode)
-      passed = dfilter_apply_edt(cf->rfcode, &edt);
+      passed = dfilter_apply_edt(cf->rfcode, edt);
   }
 
   if (passed) {
@@ -2625,7 +2663,7 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
       /* We're printing packet information; print the information for
          this packet. */
       if (do_dissection)
-        print_packet(cf, &edt);
+        print_packet(cf, edt);
       else
         print_packet(cf, NULL);
 
@@ -2660,7 +2698,7 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
   }
 
   if (do_dissection) {
-    epan_dissect_cleanup(&edt);
+    epan_dissect_reset(edt);
   }
   return passed;
 }
@@ -2992,6 +3030,8 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   }
 
 out:
+  packet_edt_end();
+
   wtap_close(cf->wth);
   cf->wth = NULL;
 
@@ -3009,7 +3049,7 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
   frame_data fdata;
   gboolean create_proto_tree;
   column_info *cinfo;
-  epan_dissect_t edt;
+  epan_dissect_t *edt = NULL;
   gboolean passed;
 
   /* Count this packet. */
@@ -3040,16 +3080,16 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode ("verbose"
        is true). */
-    epan_dissect_init(&edt, create_proto_tree, print_packet_info && verbose);
+    edt = packet_edt_begin(create_proto_tree, print_packet_info && verbose);
 
     /* If we're running a read filter, prime the epan_dissect_t with that
        filter. */
     if (cf->rfcode)
-      epan_dissect_prime_dfilter(&edt, cf->rfcode);
+      epan_dissect_prime_dfilter(edt, cf->rfcode);
 
-    col_custom_prime_edt(&edt, &cf->cinfo);
+    col_custom_prime_edt(edt, &cf->cinfo);
 
-    tap_queue_init(&edt);
+    tap_queue_init(edt);
 
     /* We only need the columns if either
 
@@ -3067,13 +3107,13 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
     frame_data_set_before_dissect(&fdata, &cf->elapsed_time,
                                   &first_ts, &prev_dis_ts, &prev_cap_ts);
 
-    epan_dissect_run(&edt, pseudo_header, pd, &fdata, cinfo);
+    epan_dissect_run(edt, pseudo_header, pd, &fdata, cinfo);
 
-    tap_push_tapped_queue(&edt);
+    tap_push_tapped_queue(edt);
 
     /* Run the read filter if we have one. */
     if (cf->rfcode)
-      passed = dfilter_apply_edt(cf->rfcode, &edt);
+      passed = dfilter_apply_edt(cf->rfcode, edt);
   }
 
   if (passed) {
@@ -3084,7 +3124,7 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
       /* We're printing packet information; print the information for
          this packet. */
       if (do_dissection)
-        print_packet(cf, &edt);
+        print_packet(cf, edt);
       else
         print_packet(cf, NULL);
 
@@ -3119,7 +3159,7 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
   }
 
   if (do_dissection) {
-    epan_dissect_cleanup(&edt);
+    epan_dissect_reset(edt);
     frame_data_cleanup(&fdata);
   }
   return passed;
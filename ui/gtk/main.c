@@ -662,6 +662,12 @@ copy_selected_plist_cb(GtkWidget *w _U_, gpointer data _U_, COPY_SELECTED_E acti
         if (cfile.finfo_selected->rep &&
             strlen (cfile.finfo_selected->rep->representation) > 0) {
             g_string_append(gtk_text_str, cfile.finfo_selected->rep->representation);
+        } else if (cfile.finfo_selected->deferred_rep) {
+            /* The label hasn't been rendered yet */
+            gchar label_str[ITEM_LABEL_LENGTH];
+
+            proto_item_fill_label(cfile.finfo_selected, label_str);
+            g_string_append(gtk_text_str, label_str);
         }
         break;
     case COPY_SELECTED_FIELDNAME:
@@ -551,6 +551,10 @@ new_packet_list_set_visible_column (gint col_id, GtkTreeViewColumn *col, gboolea
 	gtk_tree_view_column_set_visible(col, visible);
 	set_column_visible(col_id, visible);
 
+	/* Hidden columns weren't formatted; fill them in when they're drawn. */
+	if (visible)
+		packet_list_reset_columnized(packetlist);
+
 	if (!prefs.gui_use_pref_save) {
 		prefs_main_write();
 	}
@@ -579,6 +583,7 @@ new_packet_list_set_all_columns_visible (void)
 		gtk_tree_view_column_set_visible(col, TRUE);
 		set_column_visible(col_id, TRUE);
 	}
+	packet_list_reset_columnized(packetlist);
 
 	if (!prefs.gui_use_pref_save) {
 		prefs_main_write();
@@ -1678,6 +1683,8 @@ new_packet_list_copy_summary_cb(gpointer data _U_, copy_summary_type copy_type)
 			return;
 
 		record = new_packet_list_get_record(model, &iter);
+		/* Hidden columns are copied too, so make sure they're filled in. */
+		packet_list_dissect_and_cache_hidden_columns(packetlist, &iter);
 		for(col = 0; col < cfile.cinfo.num_cols; ++col) {
 			if(col != 0) {
 				if(CS_CSV == copy_type) {
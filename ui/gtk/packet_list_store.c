@@ -107,7 +107,7 @@ static void packet_list_sortable_init(GtkTreeSortableIface *iface);
 static gint packet_list_compare_records(gint sort_id _U_, PacketListRecord *a,
 					PacketListRecord *b);
 static void packet_list_resort(PacketList *packet_list);
-static void packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *record, gboolean dissect_columns, gboolean dissect_color );
+static void packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *record, gboolean dissect_columns, gboolean dissect_color, gboolean hidden_columns);
 
 static GObjectClass *parent_class = NULL;
 
@@ -827,7 +827,7 @@ packet_list_dissect_and_cache_all(PacketList *packet_list)
 
 	for (progbar_loop_var = 0; progbar_loop_var < progbar_loop_max; ++progbar_loop_var) {
 		record = PACKET_LIST_RECORD_GET(packet_list->physical_rows, progbar_loop_var);
-		packet_list_dissect_and_cache_record(packet_list, record, TRUE, FALSE);
+		packet_list_dissect_and_cache_record(packet_list, record, TRUE, FALSE, FALSE);
 
 		/* Create the progress bar if necessary.
 		   We check on every iteration of the loop, so that it takes no
@@ -1122,15 +1122,58 @@ packet_list_dissect_and_cache_iter(PacketList *packet_list, GtkTreeIter *iter, g
 
 	record = iter->user_data;
 
-	packet_list_dissect_and_cache_record(packet_list, record, dissect_columns, dissect_color);
+	packet_list_dissect_and_cache_record(packet_list, record, dissect_columns, dissect_color, FALSE);
+}
+
+void
+packet_list_dissect_and_cache_hidden_columns(PacketList *packet_list, GtkTreeIter *iter)
+{
+	PacketListRecord *record;
+
+	g_return_if_fail(packet_list != NULL);
+	g_return_if_fail(PACKETLIST_IS_LIST(packet_list));
+	g_return_if_fail(iter != NULL);
+	g_return_if_fail(iter->user_data != NULL);
+
+	record = iter->user_data;
+
+	packet_list_dissect_and_cache_record(packet_list, record, TRUE, FALSE, TRUE);
+}
+
+void
+packet_list_reset_columnized(PacketList *packet_list)
+{
+	PacketListRecord *record;
+	guint i;
+
+	for(i = 0; i < PACKET_LIST_RECORD_COUNT(packet_list->physical_rows); ++i) {
+		record = PACKET_LIST_RECORD_GET(packet_list->physical_rows, i);
+		record->columnized = FALSE;
+	}
+	packet_list->columnized = FALSE;
+}
+
+/*
+ * Does column col of record still have to be formatted?  Columns based
+ * on frame_data aren't stored, and hidden columns are only formatted
+ * when we sort on them or are asked for them explicitly.
+ */
+static gboolean
+packet_list_column_needed(PacketList *packet_list, PacketListRecord *record, column_info *cinfo, gint col, gboolean hidden_columns)
+{
+	if (record->col_text[col] != NULL || col_based_on_frame_data(cinfo, col))
+		return FALSE;
+
+	return hidden_columns || get_column_visible(col) || col == packet_list->sort_id;
 }
 
 static void
-packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *record, gboolean dissect_columns, gboolean dissect_color)
+packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *record, gboolean dissect_columns, gboolean dissect_color, gboolean hidden_columns)
 {
 	epan_dissect_t edt;
 	frame_data *fdata;
 	column_info *cinfo;
+	gboolean *cols_needed = NULL;
 	gint col;
 	gboolean create_proto_tree;
 	union wtap_pseudo_header pseudo_header; /* Packet pseudo_header */
@@ -1177,6 +1220,14 @@ packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *
 		return;	/* error reading the frame */
 	}
 
+	if (dissect_columns) {
+		/* Don't format columns we aren't going to store. */
+		cols_needed = g_new(gboolean, cinfo->num_cols);
+		for(col = 0; col < cinfo->num_cols; ++col)
+			cols_needed[col] = packet_list_column_needed(packet_list, record, cinfo, col, hidden_columns);
+		col_set_needed(cinfo, cols_needed);
+	}
+
 	create_proto_tree = (color_filters_used() && dissect_color) ||
 						(have_custom_cols(cinfo) && dissect_columns);
 
@@ -1203,10 +1254,13 @@ packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *
 		epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
 
 		for(col = 0; col < cinfo->num_cols; ++col) {
-			/* Skip columns based on frame_data because we already store those. */
-			if (!col_based_on_frame_data(cinfo, col))
+			if (cols_needed[col])
 				packet_list_change_record(packet_list, record->physical_pos, col, cinfo);
 		}
+
+		/* cfile.cinfo is shared; let the next user have every column. */
+		col_set_needed(cinfo, NULL);
+		g_free(cols_needed);
 	}
 
 	if (dissect_columns)
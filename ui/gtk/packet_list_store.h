@@ -123,6 +123,8 @@ gboolean packet_list_visible_record(PacketList *packet_list, GtkTreeIter *iter);
 gint packet_list_append_record(PacketList *packet_list, frame_data *fdata);
 void packet_list_change_record(PacketList *packet_list, guint row, gint col, column_info *cinfo);
 void packet_list_dissect_and_cache_iter(PacketList *packet_list, GtkTreeIter *iter, gboolean dissect_columns, gboolean dissect_color);
+void packet_list_dissect_and_cache_hidden_columns(PacketList *packet_list, GtkTreeIter *iter);
+void packet_list_reset_columnized(PacketList *packet_list);
 gboolean packet_list_do_packet_list_dissect_and_cache_all(PacketList *packet_list, gint sort_col_id);
 void packet_list_reset_colorized(PacketList *packet_list);
 const char* packet_list_get_widest_column_string(PacketList *packet_list, gint col);
@@ -104,43 +104,159 @@
  * possible that you could have captured someone a router telnet-session
  * using another tool. So, a libpcap trace of an toshiba "snoop" session
  * should be discovered as a libpcap file, not a toshiba file.
+ *
+ * Open routines for file types with magic numbers at fixed offsets list
+ * them here; the beginning of the file is read once, and routines none
+ * of whose magic numbers match it aren't tried at all.  Routines with
+ * no list, or that are registered by plugins, are always tried.
  */
 
+struct open_magic {
+	guint		offset;		/* offset of the magic number in the file */
+	guint		len;		/* length of the magic number */
+	const guint8	*bytes;		/* the magic number */
+};
+
+#define OPEN_MAGIC(offset, str)	{ offset, sizeof str - 1, (const guint8 *)str }
+#define OPEN_MAGIC_END		{ 0, 0, NULL }
 
-static wtap_open_routine_t open_routines_base[] = {
+/* Largest offset + length in any of the lists below */
+#define OPEN_MAGIC_PROBE_SIZE	32
+
+static const struct open_magic libpcap_magic[] = {
+	OPEN_MAGIC(0, "\xa1\xb2\xc3\xd4"),	/* PCAP_MAGIC, big-endian */
+	OPEN_MAGIC(0, "\xd4\xc3\xb2\xa1"),	/* PCAP_MAGIC, little-endian */
+	OPEN_MAGIC(0, "\xa1\xb2\xcd\x34"),	/* PCAP_MODIFIED_MAGIC, big-endian */
+	OPEN_MAGIC(0, "\x34\xcd\xb2\xa1"),	/* PCAP_MODIFIED_MAGIC, little-endian */
+	OPEN_MAGIC(0, "\xa1\xb2\x3c\x4d"),	/* PCAP_NSEC_MAGIC, big-endian */
+	OPEN_MAGIC(0, "\x4d\x3c\xb2\xa1"),	/* PCAP_NSEC_MAGIC, little-endian */
+	OPEN_MAGIC_END
+};
+static const struct open_magic pcapng_magic[] = {
+	OPEN_MAGIC(0, "\x0a\x0d\x0d\x0a"),	/* Section Header Block type */
+	OPEN_MAGIC_END
+};
+static const struct open_magic lanalyzer_magic[] = {
+	OPEN_MAGIC(0, "\x01\x10"),		/* RT_HeaderRegular */
+	OPEN_MAGIC(0, "\x07\x10"),		/* RT_HeaderCyclic */
+	OPEN_MAGIC_END
+};
+static const struct open_magic ngsniffer_magic[] = {
+	OPEN_MAGIC(0, "TRSNIFF data    \x1a"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic snoop_magic[] = {
+	OPEN_MAGIC(0, "snoop\0\0\0"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic iptrace_magic[] = {
+	OPEN_MAGIC(0, "iptrace 1.0"),
+	OPEN_MAGIC(0, "iptrace 2.0"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic netmon_magic[] = {
+	OPEN_MAGIC(0, "RTSS"),			/* Network Monitor 1.x */
+	OPEN_MAGIC(0, "GMBU"),			/* Network Monitor 2.x */
+	OPEN_MAGIC_END
+};
+static const struct open_magic netxray_magic[] = {
+	OPEN_MAGIC(0, "XCP\0"),			/* NetXRay 2.0 and later */
+	OPEN_MAGIC(0, "VL\0\0"),		/* NetXRay 1.x */
+	OPEN_MAGIC_END
+};
+static const struct open_magic radcom_magic[] = {
+	/* bytes 1 and 2 vary between captures; radcom_open() checks byte 0 */
+	OPEN_MAGIC(3, "\x34\x12\x66\x22\x88"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic nettl_magic[] = {
+	OPEN_MAGIC(0, "\x00\x00\x00\x01\x00\x00\x00\x00\x00\x07\xd0\x00"), /* HP-UX 9.x */
+	OPEN_MAGIC(0, "\x54\x52\x00\x64\x00\x00\x00\x00\x00\x00\x00\x80"), /* HP-UX 10.x and 11.x */
+	OPEN_MAGIC_END
+};
+static const struct open_magic visual_magic[] = {
+	OPEN_MAGIC(0, "\005VNF"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic _5views_magic[] = {
+	OPEN_MAGIC(0, "\xaa\xaa\xaa\xaa"),	/* CST_5VW_INFO_HEADER_KEY */
+	OPEN_MAGIC_END
+};
+static const struct open_magic network_instruments_magic[] = {
+	OPEN_MAGIC(0, "ObserverPktBuffer"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic airopeek9_magic[] = {
+	OPEN_MAGIC(0, "\177ver"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic k12_magic[] = {
+	OPEN_MAGIC(0, "\x00\x00\x02\x00\x12\x05\x00\x10"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic catapult_dct2000_magic[] = {
+	OPEN_MAGIC(0, "Session Transcript"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic aethra_magic[] = {
+	OPEN_MAGIC(0, "V0208"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic btsnoop_magic[] = {
+	OPEN_MAGIC(0, "btsnoop\0"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic eyesdn_magic[] = {
+	OPEN_MAGIC(0, "EyeSDN"),
+	OPEN_MAGIC_END
+};
+static const struct open_magic tnef_magic[] = {
+	OPEN_MAGIC(0, "\x78\x9f\x3e\x22"),	/* TNEF_SIGNATURE, little-endian */
+	OPEN_MAGIC_END
+};
+
+struct open_info {
+	wtap_open_routine_t		open_routine;
+	const struct open_magic		*magic;		/* NULL if not known */
+	gboolean			heuristic;	/* no magic number at all */
+	const char			*extensions;	/* for heuristics, tried first if one matches */
+};
+
+static const struct open_info open_routines_base[] = {
 	/* Files that have magic bytes in fixed locations. These
 	 * are easy to identify.
 	 */
-	libpcap_open,
-	pcapng_open,
-	lanalyzer_open,
-	ngsniffer_open,
-	snoop_open,
-	iptrace_open,
-	netmon_open,
-	netxray_open,
-	radcom_open,
-	nettl_open,
-	visual_open,
-	_5views_open,
-	network_instruments_open,
-	airopeek9_open,
-	dbs_etherwatch_open,
-	k12_open,
-	catapult_dct2000_open,
-	ber_open,
-	aethra_open,
-	btsnoop_open,
-	eyesdn_open,
-	vwr_open,
-	packetlogger_open, /* This type does not have a magic number, but its
-			    * files are sometimes grabbed by mpeg_open. */
-	mpeg_open,
-	mp2t_open,
-	tnef_open,
-	dct3trace_open,
-	daintree_sna_open,
-	mime_file_open,
+	{ libpcap_open,			libpcap_magic,		FALSE, NULL },
+	{ pcapng_open,			pcapng_magic,		FALSE, NULL },
+	{ lanalyzer_open,		lanalyzer_magic,	FALSE, NULL },
+	{ ngsniffer_open,		ngsniffer_magic,	FALSE, NULL },
+	{ snoop_open,			snoop_magic,		FALSE, NULL },
+	{ iptrace_open,			iptrace_magic,		FALSE, NULL },
+	{ netmon_open,			netmon_magic,		FALSE, NULL },
+	{ netxray_open,			netxray_magic,		FALSE, NULL },
+	{ radcom_open,			radcom_magic,		FALSE, NULL },
+	{ nettl_open,			nettl_magic,		FALSE, NULL },
+	{ visual_open,			visual_magic,		FALSE, NULL },
+	{ _5views_open,			_5views_magic,		FALSE, NULL },
+	{ network_instruments_open,	network_instruments_magic, FALSE, NULL },
+	{ airopeek9_open,		airopeek9_magic,	FALSE, NULL },
+	{ dbs_etherwatch_open,		NULL,			FALSE, NULL },
+	{ k12_open,			k12_magic,		FALSE, NULL },
+	{ catapult_dct2000_open,	catapult_dct2000_magic,	FALSE, NULL },
+	{ ber_open,			NULL,			FALSE, NULL },
+	{ aethra_open,			aethra_magic,		FALSE, NULL },
+	{ btsnoop_open,			btsnoop_magic,		FALSE, NULL },
+	{ eyesdn_open,			eyesdn_magic,		FALSE, NULL },
+	{ vwr_open,			NULL,			FALSE, NULL },
+	{ packetlogger_open,		NULL,			FALSE, NULL },
+				/* This type does not have a magic number, but its
+				 * files are sometimes grabbed by mpeg_open. */
+	{ mpeg_open,			NULL,			FALSE, NULL },
+	{ mp2t_open,			NULL,			FALSE, NULL },
+	{ tnef_open,			tnef_magic,		FALSE, NULL },
+	{ dct3trace_open,		NULL,			FALSE, NULL },
+	{ daintree_sna_open,		NULL,			FALSE, NULL },
+	{ mime_file_open,		NULL,			FALSE, NULL },
 	/* Files that don't have magic bytes at a fixed location,
 	 * but that instead require a heuristic of some sort to
 	 * identify them.  This includes the ASCII trace files that
@@ -151,27 +267,27 @@ static wtap_open_routine_t open_routines_base[] = {
 	/* I put NetScreen *before* erf, because there were some
 	 * false positives with my test-files (Sake Blok, July 2007)
 	 */
-	netscreen_open,
-	erf_open,
-	ipfix_open,
-	k12text_open,
-	etherpeek_open,
-	pppdump_open,
-	iseries_open,
-	ascend_open,
-	toshiba_open,
-	i4btrace_open,
-	csids_open,
-	vms_open,
-	cosine_open,
-	hcidump_open,
-	commview_open,
-	nstrace_open
+	{ netscreen_open,		NULL,			TRUE, NULL },
+	{ erf_open,			NULL,			TRUE, "erf" },
+	{ ipfix_open,			NULL,			TRUE, "pfx;ipfix" },
+	{ k12text_open,			NULL,			TRUE, NULL },
+	{ etherpeek_open,		NULL,			TRUE, "pkt;tpc;apc;wpz" },
+	{ pppdump_open,			NULL,			TRUE, NULL },
+	{ iseries_open,			NULL,			TRUE, NULL },
+	{ ascend_open,			NULL,			TRUE, NULL },
+	{ toshiba_open,			NULL,			TRUE, NULL },
+	{ i4btrace_open,		NULL,			TRUE, NULL },
+	{ csids_open,			NULL,			TRUE, NULL },
+	{ vms_open,			NULL,			TRUE, NULL },
+	{ cosine_open,			NULL,			TRUE, NULL },
+	{ hcidump_open,			NULL,			TRUE, NULL },
+	{ commview_open,		NULL,			TRUE, "ncf" },
+	{ nstrace_open,			NULL,			TRUE, NULL }
 };
 
 #define	N_FILE_TYPES	(sizeof open_routines_base / sizeof open_routines_base[0])
 
-static wtap_open_routine_t* open_routines = NULL;
+static struct open_info* open_routines = NULL;
 
 static GArray* open_routines_arr = NULL;
 
@@ -181,22 +297,66 @@ static void init_open_routines(void) {
 
 	if (open_routines_arr) return;
 
-	open_routines_arr = g_array_new(FALSE,TRUE,sizeof(wtap_open_routine_t));
+	open_routines_arr = g_array_new(FALSE,TRUE,sizeof(struct open_info));
 
 	g_array_append_vals(open_routines_arr,open_routines_base,N_FILE_TYPES);
 
-	open_routines = (wtap_open_routine_t*)(void *)open_routines_arr->data;
+	open_routines = (struct open_info*)(void *)open_routines_arr->data;
 }
 
 void wtap_register_open_routine(wtap_open_routine_t open_routine, gboolean has_magic) {
+	struct open_info info;
+
 	init_open_routines();
 
+	/* We don't know its magic numbers, so it's tried on every file */
+	info.open_routine = open_routine;
+	info.magic = NULL;
+	info.heuristic = !has_magic;
+	info.extensions = NULL;
+
 	if (has_magic)
-		g_array_prepend_val(open_routines_arr,open_routine);
+		g_array_prepend_val(open_routines_arr,info);
 	else
-		g_array_append_val(open_routines_arr,open_routine);
+		g_array_append_val(open_routines_arr,info);
 
-	open_routines = (wtap_open_routine_t*)(void *)open_routines_arr->data;
+	open_routines = (struct open_info*)(void *)open_routines_arr->data;
+}
+
+/* Does any of the magic numbers appear in the probe buffer? */
+static gboolean open_magic_matches(const struct open_magic *magic,
+    const guint8 *probe, guint probe_len)
+{
+	if (magic == NULL)
+		return TRUE;	/* we don't know; try it */
+
+	for (; magic->bytes != NULL; magic++) {
+		if (magic->offset + magic->len <= probe_len &&
+		    memcmp(probe + magic->offset, magic->bytes, magic->len) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Is the file name's extension one of the semicolon-separated extensions? */
+static gboolean open_extension_matches(const char *extensions,
+    const char *extension)
+{
+	gchar **extensions_set, **extensionp;
+	gboolean found = FALSE;
+
+	if (extensions == NULL || extension == NULL)
+		return FALSE;
+
+	extensions_set = g_strsplit(extensions, ";", 0);
+	for (extensionp = extensions_set; *extensionp != NULL; extensionp++) {
+		if (g_ascii_strcasecmp(*extensionp, extension) == 0) {
+			found = TRUE;
+			break;
+		}
+	}
+	g_strfreev(extensions_set);
+	return found;
 }
 
 /*
@@ -232,7 +392,11 @@ wtap* wtap_open_offline(const char *filename, int *err, char **err_info,
 	ws_statb64 statb;
 	wtap	*wth;
 	unsigned int	i;
+	int	pass;
 	gboolean use_stdin = FALSE;
+	guint8	probe[OPEN_MAGIC_PROBE_SIZE];
+	int	probe_len;
+	const char *extension;
 
 	/* open standard input if filename is '-' */
 	if (strcmp(filename, "-") == 0)
@@ -356,8 +520,58 @@ wtap* wtap_open_offline(const char *filename, int *err, char **err_info,
 		file_set_random_access(wth->random_fh, TRUE, wth->fast_seek);
 	}
 
-	/* Try all file types */
-	for (i = 0; i < open_routines_arr->len; i++) {
+	/* Read the beginning of the file once, to check magic numbers against */
+	probe_len = file_read(probe, sizeof probe, wth->fh);
+	if (probe_len < 0) {
+		/* I/O error - give up */
+		*err = file_error(wth->fh, err_info);
+		if (wth->random_fh != NULL)
+			file_close(wth->random_fh);
+		file_close(wth->fh);
+		g_free(wth);
+		return NULL;
+	}
+
+	/* Find the file name's extension, if any */
+	extension = NULL;
+	if (!use_stdin) {
+		extension = strrchr(filename, '.');
+		if (extension != NULL) {
+			extension++;
+			if (strchr(extension, '/') != NULL ||
+			    strchr(extension, G_DIR_SEPARATOR) != NULL)
+				extension = NULL;	/* the dot is in a directory name */
+		}
+	}
+
+	/* Try the file types whose magic numbers match, then the
+	   heuristic ones that usually have this file's extension,
+	   then the rest of the heuristic ones. */
+	for (pass = 0; pass < 3; pass++) {
+	    for (i = 0; i < open_routines_arr->len; i++) {
+		struct open_info *info = &open_routines[i];
+
+		switch (pass) {
+
+		case 0:
+			if (info->heuristic ||
+			    !open_magic_matches(info->magic, probe, probe_len))
+				continue;
+			break;
+
+		case 1:
+			if (!info->heuristic ||
+			    !open_extension_matches(info->extensions, extension))
+				continue;
+			break;
+
+		case 2:
+			if (!info->heuristic ||
+			    open_extension_matches(info->extensions, extension))
+				continue;
+			break;
+		}
+
 		/* Seek back to the beginning of the file; the open routine
 		   for the previous file type may have left the file
 		   position somewhere other than the beginning, and the
@@ -374,7 +588,7 @@ wtap* wtap_open_offline(const char *filename, int *err, char **err_info,
 			return NULL;
 		}
 
-		switch ((*open_routines[i])(wth, err, err_info)) {
+		switch ((*info->open_routine)(wth, err, err_info)) {
 
 		case -1:
 			/* I/O error - give up */
@@ -392,6 +606,7 @@ wtap* wtap_open_offline(const char *filename, int *err, char **err_info,
 			/* We found the file type */
 			goto success;
 		}
+	    }
 	}
 
 	/* Well, it's not one of the types of file we know about. */
@@ -905,6 +1120,31 @@ int wtap_short_string_to_file_type(const char *short_name)
 	return -1;	/* no such file type, or we can't write it */
 }
 
+/* Name to use in command-line options for each kind of output compression */
+static const struct {
+	const char *short_name;
+	int compression;
+} compression_types[] = {
+#ifdef HAVE_LIBZ
+	{ "gzip", WTAP_GZIP_COMPRESSED },
+#ifdef HAVE_LIBZSTD
+	{ "zstd", WTAP_ZSTD_COMPRESSED },
+#endif
+#endif
+	{ "none", WTAP_UNCOMPRESSED }
+};
+
+int wtap_short_string_to_compression_type(const char *short_name)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(compression_types); i++) {
+		if (strcmp(short_name, compression_types[i].short_name) == 0)
+			return compression_types[i].compression;
+	}
+	return -1;	/* no such compression type, or we can't write it */
+}
+
 static GSList *add_extensions(GSList *extensions, const gchar *extension,
     GSList *compressed_file_extensions)
 {
@@ -1076,23 +1316,24 @@ gboolean wtap_dump_has_name_resolution(int filetype)
 	return TRUE;
 }
 
-static gboolean wtap_dump_open_check(int filetype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int filetype, int encap, int comressed, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int filetype, int encap, int snaplen,
-					gboolean compressed, int *err);
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int filetype, gboolean compressed, int *err);
+					int compressed, int *err);
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int filetype, int compressed, int *err);
 
-static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
-static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
+static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename, int *err);
+static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd, int *err);
 static int wtap_dump_file_close(wtap_dumper *wdh);
+static gboolean wtap_dump_file_flush_buf(wtap_dumper *wdh, int *err);
 
 wtap_dumper* wtap_dump_open(const char *filename, int filetype, int encap,
-				int snaplen, gboolean compressed, int *err)
+				int snaplen, int compressed, int *err)
 {
 	return wtap_dump_open_ng(filename, filetype, encap,snaplen, compressed, NULL, NULL, err);
 }
 
 wtap_dumper* wtap_dump_open_ng(const char *filename, int filetype, int encap,
-				int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+				int snaplen, int compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
@@ -1154,12 +1395,8 @@ wtap_dumper* wtap_dump_open_ng(const char *filename, int filetype, int encap,
 #endif
 		wdh->fh = stdout;
 	} else {
-		/* In case "fopen()" fails but doesn't set "errno", set "errno"
-		   to a generic "the open failed" error. */
-		errno = WTAP_ERR_CANT_OPEN;
-		fh = wtap_dump_file_open(wdh, filename);
+		fh = wtap_dump_file_open(wdh, filename, err);
 		if (fh == NULL) {
-			*err = errno;
 			g_free(wdh);
 			return NULL;	/* can't create file */
 		}
@@ -1173,6 +1410,7 @@ wtap_dumper* wtap_dump_open_ng(const char *filename, int filetype, int encap,
 			wtap_dump_file_close(wdh);
 			ws_unlink(filename);
 		}
+		g_free(wdh->out_buf);
 		g_free(wdh);
 		return NULL;
 	}
@@ -1180,13 +1418,13 @@ wtap_dumper* wtap_dump_open_ng(const char *filename, int filetype, int encap,
 }
 
 wtap_dumper* wtap_dump_fdopen(int fd, int filetype, int encap, int snaplen,
-				gboolean compressed, int *err)
+				int compressed, int *err)
 {
 	return wtap_dump_fdopen_ng(fd, filetype, encap, snaplen, compressed, NULL, NULL, err);
 }
 
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int filetype, int encap, int snaplen,
-				gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+				int compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
@@ -1242,12 +1480,8 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int filetype, int encap, int snaplen,
 		g_array_append_val(wdh->interface_data, descr);
 	}
 
-	/* In case "fopen()" fails but doesn't set "errno", set "errno"
-	   to a generic "the open failed" error. */
-	errno = WTAP_ERR_CANT_OPEN;
-	fh = wtap_dump_file_fdopen(wdh, fd);
+	fh = wtap_dump_file_fdopen(wdh, fd, err);
 	if (fh == NULL) {
-		*err = errno;
 		g_free(wdh);
 		return NULL;	/* can't create standard I/O stream */
 	}
@@ -1255,13 +1489,14 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int filetype, int encap, int snaplen,
 
 	if (!wtap_dump_open_finish(wdh, filetype, compressed, err)) {
 		wtap_dump_file_close(wdh);
+		g_free(wdh->out_buf);
 		g_free(wdh);
 		return NULL;
 	}
 	return wdh;
 }
 
-static gboolean wtap_dump_open_check(int filetype, int encap, gboolean compressed, int *err)
+static gboolean wtap_dump_open_check(int filetype, int encap, int compressed, int *err)
 {
 	if (!wtap_dump_can_open(filetype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -1281,6 +1516,16 @@ static gboolean wtap_dump_open_check(int filetype, int encap, gboolean compresse
 		return FALSE;
 	}
 
+	/* and do we support this kind of compression? */
+	if(compressed != WTAP_UNCOMPRESSED && compressed != WTAP_GZIP_COMPRESSED
+#ifdef HAVE_LIBZSTD
+	    && compressed != WTAP_ZSTD_COMPRESSED
+#endif
+	    ) {
+		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+		return FALSE;
+	}
+
 	*err = (*dump_open_table[filetype].can_write_encap)(encap);
 	if (*err != 0)
 		return FALSE;
@@ -1290,7 +1535,7 @@ static gboolean wtap_dump_open_check(int filetype, int encap, gboolean compresse
 }
 
 static wtap_dumper* wtap_dump_alloc_wdh(int filetype, int encap, int snaplen,
-					gboolean compressed, int *err)
+					int compressed, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -1307,7 +1552,7 @@ static wtap_dumper* wtap_dump_alloc_wdh(int filetype, int encap, int snaplen,
 	return wdh;
 }
 
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int filetype, gboolean compressed, int *err)
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int filetype, int compressed, int *err)
 {
 	int fd;
 	gboolean cant_seek;
@@ -1333,6 +1578,16 @@ static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int filetype, gboolean c
 		return FALSE;
 	}
 
+	/* Uncompressed output is collected in our own buffer and
+	   handed to stdio in large chunks (the gzip and zstd writers
+	   already buffer their output); stdio needn't buffer it again,
+	   except on the standard output, which may already be in use. */
+	if(!compressed) {
+		wdh->out_buf = (guint8 *)g_malloc(WTAP_DUMP_BUF_SIZE);
+		if (wdh->fh != stdout)
+			setvbuf((FILE *)wdh->fh, NULL, _IONBF, 0);
+	}
+
 	/* Now try to open the file for writing. */
 	if (!(*dump_open_table[filetype].dump_open)(wdh, err)) {
 		return FALSE;
@@ -1347,14 +1602,23 @@ gboolean wtap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
 	return (wdh->subtype_write)(wdh, phdr, pseudo_header, pd, err);
 }
 
+/*
+ * Push everything written so far out to the file, e.g. after each packet
+ * of a live capture.  A failure is remembered and reported by the next
+ * write or by wtap_dump_close().
+ */
 void wtap_dump_flush(wtap_dumper *wdh)
 {
+	int err;
+
 #ifdef HAVE_LIBZ
 	if(wdh->compressed) {
 		gzwfile_flush((GZWFILE_T)wdh->fh);
 	} else
 #endif
 	{
+		if (!wtap_dump_file_flush_buf(wdh, &err))
+			return;
 		fflush((FILE *)wdh->fh);
 	}
 }
@@ -1362,6 +1626,7 @@ void wtap_dump_flush(wtap_dumper *wdh)
 gboolean wtap_dump_close(wtap_dumper *wdh, int *err)
 {
 	gboolean ret = TRUE;
+	int flush_err;
 
 	if (wdh->subtype_close != NULL) {
 		/* There's a close routine for this dump stream. */
@@ -1383,10 +1648,16 @@ gboolean wtap_dump_close(wtap_dumper *wdh, int *err)
 		}
 	} else {
 		/* as we don't close stdout, at least try to flush it */
-		wtap_dump_flush(wdh);
+		if (!wtap_dump_file_flush_buf(wdh, &flush_err)) {
+			if (ret && err != NULL)
+				*err = flush_err;
+			ret = FALSE;
+		}
+		fflush((FILE *)wdh->fh);
 	}
 	if (wdh->priv != NULL)
 		g_free(wdh->priv);
+	g_free(wdh->out_buf);
 	g_free(wdh);
 	return ret;
 }
@@ -1410,39 +1681,72 @@ gboolean wtap_dump_set_addrinfo_list(wtap_dumper *wdh, struct addrinfo *addrinfo
 	return TRUE;
 }
 
-/* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
-static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
+/* internally open a file for writing (compressed or not); on failure
+   return NULL and set *err */
+static WFILE_T wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename, int *err)
 {
-	if(wdh->compressed) {
-		return gzwfile_open(filename);
-	} else {
-		return ws_fopen(filename, "wb");
-	}
+	WFILE_T fh;
+
+#ifdef HAVE_LIBZ
+	if(wdh->compressed)
+		return gzwfile_open(filename, wdh->compressed, err);
+#endif
+	/* In case "fopen()" fails but doesn't set "errno", set "errno"
+	   to a generic "the open failed" error. */
+	errno = WTAP_ERR_CANT_OPEN;
+	fh = ws_fopen(filename, "wb");
+	if (fh == NULL)
+		*err = errno;
+	return fh;
 }
-#else
-static WFILE_T wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
+
+/* internally open a file for writing (compressed or not); on failure
+   return NULL and set *err */
+static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd, int *err)
 {
-	return ws_fopen(filename, "wb");
-}
-#endif
+	WFILE_T fh;
 
-/* internally open a file for writing (compressed or not) */
 #ifdef HAVE_LIBZ
-static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
-{
-	if(wdh->compressed) {
-		return gzwfile_fdopen(fd);
-	} else {
-		return fdopen(fd, "wb");
-	}
+	if(wdh->compressed)
+		return gzwfile_fdopen(fd, wdh->compressed, err);
+#endif
+	/* In case "fdopen()" fails but doesn't set "errno", set "errno"
+	   to a generic "the open failed" error. */
+	errno = WTAP_ERR_CANT_OPEN;
+	fh = fdopen(fd, "wb");
+	if (fh == NULL)
+		*err = errno;
+	return fh;
 }
-#else
-static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
+
+/* write out whatever is waiting in the output buffer of an uncompressed file */
+static gboolean wtap_dump_file_flush_buf(wtap_dumper *wdh, int *err)
 {
-	return fdopen(fd, "wb");
+	size_t nwritten;
+
+	if (wdh->out_buf_err != 0) {
+		*err = wdh->out_buf_err;
+		return FALSE;
+	}
+	if (wdh->out_buf_len == 0)
+		return TRUE;
+
+	nwritten = fwrite(wdh->out_buf, 1, wdh->out_buf_len, (FILE *)wdh->fh);
+	/*
+	 * At least according to the Mac OS X man page,
+	 * this can return a short count on an error.
+	 */
+	if (nwritten != wdh->out_buf_len) {
+		if (ferror((FILE *)wdh->fh))
+			*err = errno;
+		else
+			*err = WTAP_ERR_SHORT_WRITE;
+		wdh->out_buf_err = *err;
+		return FALSE;
+	}
+	wdh->out_buf_len = 0;
+	return TRUE;
 }
-#endif
 
 /* internally writing raw bytes (compressed or not) */
 gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
@@ -1463,11 +1767,31 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 	} else
 #endif
 	{
-		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
 		/*
-		 * At least according to the Mac OS X man page,
-		 * this can return a short count on an error.
+		 * Record headers, padding and options are small; collect
+		 * them, and the packet data following them, in the output
+		 * buffer so that a whole run of records goes out with one
+		 * write.
 		 */
+		if (bufsize <= WTAP_DUMP_BUF_SIZE - wdh->out_buf_len) {
+			if (wdh->out_buf_err != 0) {
+				*err = wdh->out_buf_err;
+				return FALSE;
+			}
+			memcpy(wdh->out_buf + wdh->out_buf_len, buf, bufsize);
+			wdh->out_buf_len += bufsize;
+			return TRUE;
+		}
+		if (!wtap_dump_file_flush_buf(wdh, err))
+			return FALSE;
+		if (bufsize < WTAP_DUMP_BUF_SIZE / 2) {
+			memcpy(wdh->out_buf, buf, bufsize);
+			wdh->out_buf_len = bufsize;
+			return TRUE;
+		}
+
+		/* Large payloads are written straight from the caller's buffer. */
+		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
 		if (nwritten != bufsize) {
 			if (ferror((FILE *)wdh->fh))
 				*err = errno;
@@ -1479,15 +1803,55 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 	return TRUE;
 }
 
+/* internally seeking in a file being written (only uncompressed files) */
+gint64 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
+{
+#ifdef HAVE_LIBZ
+	if (wdh->compressed) {
+		*err = WTAP_ERR_CANT_SEEK;
+		return -1;
+	}
+#endif
+	if (!wtap_dump_file_flush_buf(wdh, err))
+		return -1;
+	if (fseek((FILE *)wdh->fh, (long)offset, whence) == -1) {
+		*err = errno;
+		return -1;
+	}
+	return 0;
+}
+
+/* internally getting the current offset in a file being written */
+gint64 wtap_dump_file_tell(wtap_dumper *wdh)
+{
+	gint64 pos;
+
+#ifdef HAVE_LIBZ
+	if (wdh->compressed)
+		return -1;
+#endif
+	pos = ftell((FILE *)wdh->fh);
+	if (pos == -1)
+		return -1;
+	return pos + wdh->out_buf_len;
+}
+
 /* internally close a file for writing (compressed or not) */
 static int wtap_dump_file_close(wtap_dumper *wdh)
 {
+	int err;
+
 #ifdef HAVE_LIBZ
 	if(wdh->compressed) {
 		return gzwfile_close((GZWFILE_T)wdh->fh);
 	} else
 #endif
 	{
+		if (!wtap_dump_file_flush_buf(wdh, &err)) {
+			fclose((FILE *)wdh->fh);
+			errno = err;
+			return EOF;
+		}
 		return fclose((FILE *)wdh->fh);
 	}
 }
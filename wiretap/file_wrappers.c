@@ -51,6 +51,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif /* HAVE_FCNTL_H */
@@ -63,8 +64,13 @@
 #include <zlib.h>
 #endif /* HAVE_LIBZ */
 
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif /* HAVE_LIBZSTD */
+
 /*
- * See RFC 1952 for a description of the gzip file format.
+ * See RFC 1952 for a description of the gzip file format, and RFC 8878
+ * for a description of the Zstandard file format.
  *
  * Some other compressed file formats we might want to support:
  *
@@ -82,6 +88,9 @@
 static const char *compressed_file_extensions[] = {
 #ifdef HAVE_LIBZ
 	"gz",
+#endif
+#ifdef HAVE_LIBZSTD
+	"zst",
 #endif
 	NULL
 };
@@ -107,6 +116,84 @@ wtap_get_compressed_file_extensions(void)
 /* #define GZBUFSIZE 8192 */
 #define GZBUFSIZE 4096
 
+/*
+ * When reading a file sequentially, we read it READ_BUFSIZE bytes at a
+ * time (or the file system's preferred I/O size, if that's bigger), and
+ * hint to the OS that it should read the next READ_AHEAD bytes in the
+ * background.  The WIRESHARK_READ_BUFFER_SIZE environment variable
+ * overrides the buffer size, in kilobytes.  If the WIRESHARK_READ_AHEAD
+ * environment variable is set, to a number of megabytes, a reader
+ * thread instead keeps that much of the file read ahead of us.
+ *
+ * Random access uses the file system's preferred I/O size, as each
+ * seek throws away whatever was read beyond the record we wanted.
+ *
+ * The output buffer is twice the size of the input buffer, so by
+ * default the sequential handle holds 192 KB of buffers per open file,
+ * and the random access handle only three times the preferred I/O size.
+ */
+#define READ_BUFSIZE		(64*1024)
+#define READ_BUFSIZE_MAX	(16*1048576)
+#define READ_AHEAD		1048576
+#define READ_AHEAD_MAX		(1024*1048576)
+
+#ifdef HAVE_PREAD
+struct ra_chunk;
+#endif
+
+#ifdef HAVE_LIBZ
+/*
+ * When writing, we split the compressed data into gzip members holding
+ * at most GZ_BLOCK_SIZE bytes of uncompressed data each.  The header of
+ * each member has an extra subfield (RFC 1952 section 2.3.1.1) with the
+ * ID 'W' 'S' giving the length of the member's compressed data, so that
+ * a reader can find the next member without inflating this one, and can
+ * thus inflate several members at once.  Other gzip readers just see an
+ * ordinary multi-member gzip file.
+ */
+#define GZ_BLOCK_SIZE		1048576
+#define GZ_BLOCK_MAX		(16*1048576)	/* sanity limit on the sizes of a block */
+#define GZ_BLOCK_SI1		'W'
+#define GZ_BLOCK_SI2		'S'
+#define GZ_BLOCK_HEADER_LEN	20	/* fixed header, XLEN, one 4-byte subfield */
+#define GZ_BLOCK_TRAILER_LEN	8	/* CRC-32 and ISIZE */
+#define GZ_BLOCK_THREADS	4	/* worker threads if we can't count processors */
+
+/*
+ * When closing, we also write an index of the blocks, so that a reader
+ * can seek to any of them without first reading up to it.  The index is
+ * stored in the extra fields ('W' 'I') of empty gzip members, as pairs
+ * of little-endian 64-bit offsets: where the block's compressed data
+ * starts in the file and where its data starts in the uncompressed data.
+ * The file ends with another empty member, of fixed length, whose extra
+ * field ('W' 'L') gives the offset of the first index member.
+ */
+#define GZ_INDEX_SI2		'I'
+#define GZ_INDEX_ENTRY_LEN	16
+#define GZ_INDEX_MAX_ENTRIES	((65535 - 4) / GZ_INDEX_ENTRY_LEN)	/* per member */
+#define GZ_INDEX_MAX		(64*1048576)	/* sanity limit on the size of the index */
+#define GZ_LOCATOR_SI2		'L'
+#define GZ_LOCATOR_LEN		34	/* header, 12-byte extra field, empty data, trailer */
+
+struct gz_block;
+#endif
+
+#ifdef HAVE_LIBZSTD
+/*
+ * zstd-compressed files are written as a series of independent frames,
+ * each holding at most GZ_BLOCK_SIZE bytes of uncompressed data, followed
+ * by a seek table in the Zstandard seekable format (see
+ * contrib/seekable_format in the zstd sources): a skippable frame giving
+ * the compressed and uncompressed size of each frame, ending with a
+ * footer that gives the number of frames.  Ordinary zstd readers skip
+ * the seek table.
+ */
+#define SEEKABLE_SKIPPABLE_MAGIC	0x184D2A5E
+#define SEEKABLE_MAGIC			0x8F92EAB1
+#define SEEKABLE_FOOTER_LEN		9
+#define SEEKABLE_MAX			(64*1048576)	/* sanity limit on the size of the seek table */
+#endif
+
 struct wtap_reader {
 	int fd;                 /* file descriptor */
 	gint64 raw_pos;         /* current position in file (just to not call lseek()) */
@@ -135,6 +222,40 @@ struct wtap_reader {
 	/* zlib inflate stream */
 	z_stream strm;          /* stream structure in-place (not a pointer) */
 	int dont_check_crc;	/* 1 if we aren't supposed to check the CRC */
+	/* blocked gzip members, inflated on worker threads */
+	gboolean blocks_ok;     /* TRUE if we may inflate blocks in parallel */
+	gboolean blocks_started; /* TRUE once gz_block_setup() has succeeded */
+	GMutex *blocks_mtx;     /* protects the done flag of queued blocks */
+	GCond *blocks_cond;     /* signalled when a block has been inflated */
+	GQueue *blocks;         /* blocks read ahead, in file order */
+	struct gz_block *block; /* block whose output is being delivered */
+	gint64 blocks_out;      /* uncompressed offset after the last queued block */
+	int blocks_err;         /* read-ahead error, reported once queue drains */
+	const char *blocks_err_info;
+#endif
+#ifdef HAVE_LIBZSTD
+	ZSTD_DCtx *zstd;        /* zstd decompression context, created on first use */
+#endif
+	/* reading ahead */
+	unsigned blksize;       /* file system's preferred I/O size */
+	gsize read_ahead;       /* how much to read ahead, or hint at */
+	double stall_time;      /* seconds spent waiting for input */
+	GTimer *stall_timer;
+#ifdef HAVE_POSIX_FADVISE
+	gboolean advise;        /* TRUE to give WILLNEED hints */
+	gint64 advised;         /* end of the range last hinted at */
+#endif
+#ifdef HAVE_PREAD
+	gboolean ra_ok;         /* TRUE if we may use a reader thread */
+	GThreadPool *ra_pool;   /* reader thread, created on first use */
+	struct ra_chunk *ra_chunk; /* chunk whose data is being delivered */
+	GMutex *ra_mtx;         /* protects the fields below */
+	GCond *ra_cond;         /* signalled when any of them change */
+	GQueue *ra_chunks;      /* chunks read ahead, in file order */
+	gsize ra_queued;        /* amount of data in ra_chunks */
+	gint64 ra_pos;          /* where the reader thread reads next */
+	gboolean ra_running;    /* TRUE while the reader thread is reading */
+	gboolean ra_stop;       /* TRUE to tell the reader thread to stop */
 #endif
 	/* fast seeking */
 	GPtrArray *fast_seek;
@@ -147,6 +268,234 @@ struct wtap_reader {
 #ifdef HAVE_LIBZ
 #define ZLIB		2	/* decompress a zlib stream */
 #define GZIP_AFTER_HEADER 3
+#define GZIP_BLOCKS	4	/* deliver blocks inflated by worker threads */
+#endif
+#ifdef HAVE_LIBZSTD
+#define ZSTD		5	/* decompress zstd frames */
+#endif
+
+#ifdef HAVE_PREAD
+struct ra_chunk {
+	gint64 off;             /* offset in the file of the data */
+	unsigned char *data;
+	unsigned len;           /* amount of data read */
+	unsigned used;          /* amount of data already delivered */
+	gboolean eof;           /* TRUE if the file ended after the data */
+	int err;                /* error code from reading past the data */
+};
+
+static void
+ra_chunk_free(struct ra_chunk *chunk)
+{
+	g_free(chunk->data);
+	g_free(chunk);
+}
+
+/* Reader thread routine: read the file, from ra_pos on, until we're
+   read_ahead bytes ahead of what's been delivered, the file ends, or
+   we're told to stop. */
+static void
+ra_read(gpointer data _U_, gpointer user_data)
+{
+	FILE_T state = (FILE_T)user_data;
+	struct ra_chunk *chunk;
+	unsigned size = state->size;
+	ssize_t ret;
+
+	g_mutex_lock(state->ra_mtx);
+	for (;;) {
+		while (!state->ra_stop && state->ra_queued >= state->read_ahead)
+			g_cond_wait(state->ra_cond, state->ra_mtx);
+		if (state->ra_stop)
+			break;
+
+		chunk = g_new(struct ra_chunk, 1);
+		chunk->off = state->ra_pos;
+		chunk->len = 0;
+		chunk->used = 0;
+		chunk->eof = FALSE;
+		chunk->err = 0;
+		g_mutex_unlock(state->ra_mtx);
+
+		chunk->data = (unsigned char *)g_try_malloc(size);
+		if (chunk->data == NULL)
+			chunk->err = ENOMEM;
+		else {
+			while (chunk->len < size) {
+				ret = pread(state->fd, chunk->data + chunk->len,
+				    size - chunk->len, chunk->off + chunk->len);
+				if (ret <= 0) {
+					if (ret < 0)
+						chunk->err = errno;
+					else
+						chunk->eof = TRUE;
+					break;
+				}
+				chunk->len += (unsigned)ret;
+			}
+		}
+
+		g_mutex_lock(state->ra_mtx);
+		if (state->ra_stop) {
+			ra_chunk_free(chunk);
+			break;
+		}
+		g_queue_push_tail(state->ra_chunks, chunk);
+		state->ra_queued += chunk->len;
+		state->ra_pos += chunk->len;
+		g_cond_broadcast(state->ra_cond);
+		if (chunk->eof || chunk->err)
+			break;
+	}
+	state->ra_running = FALSE;
+	g_cond_broadcast(state->ra_cond);
+	g_mutex_unlock(state->ra_mtx);
+}
+
+/* Stop the reader thread, and throw away whatever it read ahead.  Must
+   be called with ra_mtx held. */
+static void
+ra_stop(FILE_T state)
+{
+	struct ra_chunk *chunk;
+
+	state->ra_stop = TRUE;
+	g_cond_broadcast(state->ra_cond);
+	while (state->ra_running)
+		g_cond_wait(state->ra_cond, state->ra_mtx);
+	state->ra_stop = FALSE;
+	while ((chunk = (struct ra_chunk *)g_queue_pop_head(state->ra_chunks)) != NULL)
+		ra_chunk_free(chunk);
+	state->ra_queued = 0;
+}
+
+/* Throw away anything read ahead, e.g. because we're seeking. */
+static void
+ra_drain(FILE_T state)
+{
+	if (state->ra_pool == NULL)
+		return;
+
+	if (state->ra_chunk != NULL) {
+		ra_chunk_free(state->ra_chunk);
+		state->ra_chunk = NULL;
+	}
+	g_mutex_lock(state->ra_mtx);
+	ra_stop(state);
+	g_mutex_unlock(state->ra_mtx);
+}
+
+/* Start the reader thread, if we haven't already.  Returns FALSE if we
+   have to read the file ourselves. */
+static gboolean
+ra_setup(FILE_T state)
+{
+	if (!state->ra_ok)
+		return FALSE;
+	if (state->ra_pool != NULL)
+		return TRUE;
+
+	state->ra_pool = g_thread_pool_new(ra_read, state, 1, FALSE, NULL);
+	if (state->ra_pool == NULL) {
+		state->ra_ok = FALSE;
+		return FALSE;
+	}
+#if GLIB_CHECK_VERSION(2,31,0)
+	state->ra_mtx = g_new(GMutex, 1);
+	g_mutex_init(state->ra_mtx);
+	state->ra_cond = g_new(GCond, 1);
+	g_cond_init(state->ra_cond);
+#else
+	state->ra_mtx = g_mutex_new();
+	state->ra_cond = g_cond_new();
+#endif
+	state->ra_chunks = g_queue_new();
+	state->ra_queued = 0;
+	state->ra_running = FALSE;
+	state->ra_stop = FALSE;
+	state->ra_chunk = NULL;
+	return TRUE;
+}
+
+/* Get the next chunk read ahead, at raw_pos, restarting the reader
+   thread there if it's stopped or reading somewhere else. */
+static struct ra_chunk *
+ra_next(FILE_T state)
+{
+	struct ra_chunk *chunk;
+
+	g_mutex_lock(state->ra_mtx);
+	for (;;) {
+		chunk = (struct ra_chunk *)g_queue_peek_head(state->ra_chunks);
+		if (chunk != NULL) {
+			if (chunk->off == state->raw_pos)
+				break;
+			/* we've seeked since this was read */
+			ra_stop(state);
+			continue;
+		}
+		if (!state->ra_running || state->ra_pos != state->raw_pos) {
+			ra_stop(state);
+			state->ra_pos = state->raw_pos;
+			state->ra_running = TRUE;
+			g_thread_pool_push(state->ra_pool, state, NULL);
+		}
+		g_timer_start(state->stall_timer);
+		g_cond_wait(state->ra_cond, state->ra_mtx);
+		state->stall_time += g_timer_elapsed(state->stall_timer, NULL);
+	}
+	g_queue_pop_head(state->ra_chunks);
+	state->ra_queued -= chunk->len;
+	g_cond_broadcast(state->ra_cond);
+	g_mutex_unlock(state->ra_mtx);
+	return chunk;
+}
+
+/* raw_read() from what the reader thread has read ahead. */
+static int
+ra_raw_read(FILE_T state, unsigned char *buf, unsigned int count, unsigned *have)
+{
+	struct ra_chunk *chunk;
+	unsigned n;
+
+	*have = 0;
+	while (*have < count) {
+		chunk = state->ra_chunk;
+		if (chunk != NULL && chunk->off + chunk->used != state->raw_pos) {
+			/* we've seeked since this was read */
+			ra_drain(state);
+			chunk = NULL;
+		}
+		if (chunk != NULL && chunk->used == chunk->len) {
+			state->ra_chunk = NULL;
+			if (chunk->err) {
+				state->err = chunk->err;
+				state->err_info = NULL;
+				ra_chunk_free(chunk);
+				return -1;
+			}
+			if (chunk->eof) {
+				state->eof = 1;
+				ra_chunk_free(chunk);
+				break;
+			}
+			ra_chunk_free(chunk);
+			chunk = NULL;
+		}
+		if (chunk == NULL) {
+			chunk = ra_next(state);
+			state->ra_chunk = chunk;
+		}
+
+		n = chunk->len - chunk->used > count - *have ?
+		    count - *have : chunk->len - chunk->used;
+		memcpy(buf + *have, chunk->data + chunk->used, n);
+		chunk->used += n;
+		*have += n;
+		state->raw_pos += n;
+	}
+	return 0;
+}
 #endif
 
 static int	/* gz_load */
@@ -154,7 +503,21 @@ raw_read(FILE_T state, unsigned char *buf, unsigned int count, unsigned *have)
 {
 	int ret;
 
+#ifdef HAVE_PREAD
+	if (ra_setup(state))
+		return ra_raw_read(state, buf, count, have);
+#endif
+#ifdef HAVE_POSIX_FADVISE
+	/* keep the OS reading ahead of us */
+	if (state->advise && (state->raw_pos + (gint64)state->read_ahead / 2 > state->advised ||
+	    state->raw_pos + (gint64)state->read_ahead < state->advised)) {
+		(void)posix_fadvise(state->fd, state->raw_pos, state->read_ahead, POSIX_FADV_WILLNEED);
+		state->advised = state->raw_pos + state->read_ahead;
+	}
+#endif
+
 	*have = 0;
+	g_timer_start(state->stall_timer);
 	do {
 		ret = read(state->fd, buf + *have, count - *have);
 		if (ret <= 0)
@@ -162,6 +525,7 @@ raw_read(FILE_T state, unsigned char *buf, unsigned int count, unsigned *have)
 		*have += ret;
 		state->raw_pos += ret;
 	} while (*have < count);
+	state->stall_time += g_timer_elapsed(state->stall_timer, NULL);
 	if (ret < 0) {
 		state->err = errno;
 		state->err_info = NULL;
@@ -185,6 +549,72 @@ fill_in_buffer(FILE_T state)
 	return 0;
 }
 
+/* Make sure there are at least n bytes in the input buffer, unless the
+   input ends first, keeping what's already there.  Returns -1 on a read
+   error, 0 otherwise. */
+static int
+fill_in_buffer_min(FILE_T state, unsigned n)
+{
+	unsigned got;
+
+	if (state->err)
+		return -1;
+	if (state->avail_in < n && state->eof == 0) {
+		memmove(state->in, state->next_in, state->avail_in);
+		state->next_in = state->in;
+		if (raw_read(state, state->in + state->avail_in, state->size - state->avail_in, &got) == -1)
+			return -1;
+		state->avail_in += got;
+	}
+	return 0;
+}
+
+/* Skip n bytes of input.  Returns -1, with state->err set, on an error
+   or if the input ends first, 0 otherwise. */
+static int
+skip_in(FILE_T state, gint64 n)
+{
+	while (n != 0) {
+		if (state->avail_in == 0) {
+			if (fill_in_buffer(state) == -1)
+				return -1;
+			if (state->avail_in == 0) {
+				state->err = WTAP_ERR_SHORT_READ;
+				state->err_info = NULL;
+				return -1;
+			}
+		}
+		if ((gint64)state->avail_in >= n) {
+			state->avail_in -= (unsigned)n;
+			state->next_in += n;
+			break;
+		}
+		n -= state->avail_in;
+		state->avail_in = 0;
+	}
+	return 0;
+}
+
+/* Read len bytes at offset off in the file into buf, without disturbing
+   the stream state other than the file position.  Returns 0 on success,
+   -1 on a short read or error. */
+static int
+read_at(FILE_T state, gint64 off, unsigned char *buf, unsigned len)
+{
+	unsigned have = 0;
+	int ret;
+
+	if (ws_lseek64(state->fd, off, SEEK_SET) == -1)
+		return -1;
+	while (have < len) {
+		ret = read(state->fd, buf + have, len - have);
+		if (ret <= 0)
+			return -1;
+		have += ret;
+	}
+	return 0;
+}
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -560,6 +990,574 @@ zlib_read(FILE_T state, unsigned char *buf, unsigned int count)
 		state->fast_seek_cur = NULL;
 	}
 }
+
+/* A blocked gzip member, read ahead by the reading thread and inflated
+   by one of the worker threads. */
+struct gz_block {
+	unsigned char *comp;    /* compressed data, followed by the trailer */
+	unsigned comp_len;      /* length of the compressed data */
+	unsigned char *data;    /* inflated data */
+	guint32 crc;            /* CRC-32 from the trailer */
+	guint32 len;            /* uncompressed length from the trailer */
+	unsigned used;          /* amount of data already delivered */
+	int check_crc;          /* 1 if we're supposed to check the CRC */
+	FILE_T state;           /* stream the block was read from */
+	gboolean done;          /* set, under blocks_mtx, once inflated */
+	int err;                /* error code */
+	const char *err_info;   /* additional error information string */
+};
+
+static void
+gz_block_free(struct gz_block *block)
+{
+	g_free(block->comp);
+	g_free(block->data);
+	g_free(block);
+}
+
+/*
+ * All streams share one pool of worker threads, so that reading many
+ * blocked files at once (mergecap, capinfos -j) doesn't start a set of
+ * threads for each of them.  Each stream reads ahead two blocks per
+ * thread, divided among the streams reading blocks at the time, but
+ * at least two.
+ */
+static GThreadPool *gz_block_pool = NULL;
+static gint gz_block_streams = 0;       /* streams that have queued blocks */
+
+/* Worker thread routine: inflate one block, and check it against its
+   trailer. */
+static void
+gz_block_inflate(gpointer data, gpointer user_data _U_)
+{
+	struct gz_block *block = (struct gz_block *)data;
+	FILE_T state = block->state;
+	z_stream strm;
+	int ret;
+
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	strm.avail_in = 0;
+	strm.next_in = Z_NULL;
+
+	/* one byte more than we expect, so that we notice overlong data */
+	block->data = (unsigned char *)g_try_malloc(block->len + 1);
+	if (block->data == NULL || inflateInit2(&strm, -15) != Z_OK) {
+		/* This means "not enough memory". */
+		block->err = ENOMEM;
+	} else {
+		strm.next_in = block->comp;
+		strm.avail_in = block->comp_len;
+		strm.next_out = block->data;
+		strm.avail_out = block->len + 1;
+		ret = inflate(&strm, Z_FINISH);
+		if (ret == Z_MEM_ERROR) {
+			block->err = ENOMEM;
+		} else if (ret == Z_NEED_DICT) {
+			block->err = WTAP_ERR_DECOMPRESS;
+			block->err_info = "preset dictionary needed";
+		} else if (ret == Z_DATA_ERROR) {
+			block->err = WTAP_ERR_DECOMPRESS;
+			block->err_info = strm.msg;
+		} else if (ret != Z_STREAM_END) {
+			block->err = WTAP_ERR_DECOMPRESS;
+			block->err_info = strm.avail_out == 0 ?
+			    "length field wrong" : "compressed block truncated";
+		} else if (strm.total_out != block->len) {
+			block->err = WTAP_ERR_DECOMPRESS;
+			block->err_info = "length field wrong";
+		} else if (block->check_crc &&
+		    crc32(crc32(0L, Z_NULL, 0), block->data, block->len) != block->crc) {
+			block->err = WTAP_ERR_DECOMPRESS;
+			block->err_info = "bad CRC";
+		}
+		inflateEnd(&strm);
+	}
+	g_free(block->comp);
+	block->comp = NULL;
+
+	g_mutex_lock(state->blocks_mtx);
+	block->done = TRUE;
+	g_cond_broadcast(state->blocks_cond);
+	g_mutex_unlock(state->blocks_mtx);
+}
+
+static gpointer
+gz_block_pool_new(gpointer data _U_)
+{
+	guint threads;
+
+#if GLIB_CHECK_VERSION(2,36,0)
+	threads = g_get_num_processors();
+#else
+	threads = GZ_BLOCK_THREADS;
+#endif
+	return g_thread_pool_new(gz_block_inflate, NULL, threads, FALSE, NULL);
+}
+
+/* Start the worker threads, if nobody has yet, and set up the stream
+   to use them.  Returns FALSE if blocks have to be inflated as an
+   ordinary gzip stream. */
+static gboolean
+gz_block_setup(FILE_T state)
+{
+	static GOnce pool_once = G_ONCE_INIT;
+
+	if (!state->blocks_ok)
+		return FALSE;
+	if (state->blocks_started)
+		return TRUE;
+
+	gz_block_pool = (GThreadPool *)g_once(&pool_once, gz_block_pool_new, NULL);
+	if (gz_block_pool == NULL) {
+		state->blocks_ok = FALSE;
+		return FALSE;
+	}
+#if GLIB_CHECK_VERSION(2,31,0)
+	state->blocks_mtx = g_new(GMutex, 1);
+	g_mutex_init(state->blocks_mtx);
+	state->blocks_cond = g_new(GCond, 1);
+	g_cond_init(state->blocks_cond);
+#else
+	state->blocks_mtx = g_mutex_new();
+	state->blocks_cond = g_cond_new();
+#endif
+	state->blocks = g_queue_new();
+	state->blocks_started = TRUE;
+	g_atomic_int_inc(&gz_block_streams);
+	return TRUE;
+}
+
+/* Read the compressed data and trailer of the blocked member whose header
+   we've just read, and hand it to the worker threads.  Returns 0 on
+   success; otherwise -1 is returned and state->err is set. */
+static int
+gz_block_queue(FILE_T state, guint32 comp_len)
+{
+	struct gz_block *block;
+	unsigned need = comp_len + GZ_BLOCK_TRAILER_LEN;
+	unsigned n, got;
+
+	block = g_new(struct gz_block, 1);
+	block->comp = (unsigned char *)g_try_malloc(need);
+	if (block->comp == NULL) {
+		g_free(block);
+		state->err = ENOMEM;
+		state->err_info = NULL;
+		return -1;
+	}
+
+	if (state->fast_seek)
+		fast_seek_header(state, state->raw_pos - state->avail_in, state->blocks_out, GZIP_AFTER_HEADER);
+
+	n = state->avail_in > need ? need : state->avail_in;
+	memcpy(block->comp, state->next_in, n);
+	state->next_in += n;
+	state->avail_in -= n;
+	if (n < need) {
+		if (raw_read(state, block->comp + n, need - n, &got) == -1) {
+			g_free(block->comp);
+			g_free(block);
+			return -1;
+		}
+		if (got < need - n) {
+			g_free(block->comp);
+			g_free(block);
+			state->err = WTAP_ERR_SHORT_READ;
+			state->err_info = NULL;
+			return -1;
+		}
+	}
+
+	block->comp_len = comp_len;
+	block->crc = pletohl(block->comp + comp_len);
+	block->len = pletohl(block->comp + comp_len + 4);
+	block->data = NULL;
+	block->used = 0;
+	block->check_crc = !state->dont_check_crc;
+	block->state = state;
+	block->err = 0;
+	block->err_info = NULL;
+	state->blocks_out += block->len;
+	state->is_compressed = TRUE;
+
+	g_queue_push_tail(state->blocks, block);
+	if (block->len > GZ_BLOCK_MAX) {
+		block->err = WTAP_ERR_DECOMPRESS;
+		block->err_info = "compressed block too large";
+		block->done = TRUE;
+	} else {
+		block->done = FALSE;
+		g_thread_pool_push(gz_block_pool, block, NULL);
+	}
+	return 0;
+}
+
+/* If the input continues with another blocked member, queue it.  Returns
+   1 if we did, 0 if the input continues with something else, and -1, with
+   state->err set, on an error. */
+static int
+gz_block_next(FILE_T state)
+{
+	static const unsigned char block_head[4] = { 31, 139, 8, 4 };
+	static const unsigned char block_extra[6] = { 8, 0, GZ_BLOCK_SI1, GZ_BLOCK_SI2, 4, 0 };
+	guint32 comp_len;
+
+	/* get the whole header into the input buffer */
+	if (fill_in_buffer_min(state, GZ_BLOCK_HEADER_LEN) == -1)
+		return -1;
+	if (state->avail_in < GZ_BLOCK_HEADER_LEN ||
+	    memcmp(state->next_in, block_head, sizeof block_head) != 0 ||
+	    memcmp(state->next_in + 10, block_extra, sizeof block_extra) != 0)
+		return 0;
+
+	comp_len = pletohl(state->next_in + 16);
+	if (comp_len > GZ_BLOCK_MAX)
+		return 0;       /* leave it to gz_head() */
+	state->next_in += GZ_BLOCK_HEADER_LEN;
+	state->avail_in -= GZ_BLOCK_HEADER_LEN;
+	return gz_block_queue(state, comp_len) == -1 ? -1 : 1;
+}
+
+/* Keep the worker threads busy by reading ahead up to two blocks per
+   thread, shared among the streams.  A read error is held back until the
+   blocks before it have been delivered. */
+static void
+gz_block_read_ahead(FILE_T state)
+{
+	guint streams = (guint)g_atomic_int_get(&gz_block_streams);
+	guint ahead = 2 * (guint)g_thread_pool_get_max_threads(gz_block_pool);
+
+	if (streams > 1)
+		ahead /= streams;
+	if (ahead < 2)
+		ahead = 2;
+
+	while (state->blocks_err == 0 && g_queue_get_length(state->blocks) < ahead) {
+		int ret = gz_block_next(state);
+
+		if (ret == -1) {
+			state->blocks_err = state->err;
+			state->blocks_err_info = state->err_info;
+			state->err = 0;
+			state->err_info = NULL;
+			break;
+		}
+		if (ret == 0)
+			break;
+	}
+}
+
+/* Deliver up to count bytes of inflated blocks into buf, in file order.
+   When the blocks run out, state->compression is set to UNKNOWN to look
+   at whatever follows them. */
+static void
+gz_block_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	struct gz_block *block;
+	unsigned n;
+
+	state->next = buf;
+	state->have = 0;
+
+	while ((block = state->block) == NULL || block->used == block->len) {
+		if (block != NULL) {
+			gz_block_free(block);
+			state->block = NULL;
+		}
+
+		gz_block_read_ahead(state);
+		block = (struct gz_block *)g_queue_pop_head(state->blocks);
+		if (block == NULL) {
+			state->err = state->blocks_err;
+			state->err_info = state->blocks_err_info;
+			state->blocks_err = 0;
+			state->blocks_err_info = NULL;
+			state->compression = UNKNOWN;
+			return;
+		}
+
+		g_mutex_lock(state->blocks_mtx);
+		while (!block->done)
+			g_cond_wait(state->blocks_cond, state->blocks_mtx);
+		g_mutex_unlock(state->blocks_mtx);
+
+		if (block->err) {
+			state->err = block->err;
+			state->err_info = block->err_info;
+			gz_block_free(block);
+			return;
+		}
+		state->block = block;
+	}
+
+	n = block->len - block->used > count ? count : block->len - block->used;
+	memcpy(buf, block->data + block->used, n);
+	block->used += n;
+	state->have = n;
+}
+
+/* Throw away any blocks read ahead, e.g. because we're seeking. */
+static void
+gz_block_drain(FILE_T state)
+{
+	struct gz_block *block;
+
+	if (state->blocks == NULL)
+		return;
+
+	if (state->block != NULL) {
+		gz_block_free(state->block);
+		state->block = NULL;
+	}
+	while ((block = (struct gz_block *)g_queue_pop_head(state->blocks)) != NULL) {
+		g_mutex_lock(state->blocks_mtx);
+		while (!block->done)
+			g_cond_wait(state->blocks_cond, state->blocks_mtx);
+		g_mutex_unlock(state->blocks_mtx);
+		gz_block_free(block);
+	}
+	state->blocks_err = 0;
+	state->blocks_err_info = NULL;
+}
+
+/* Check that p points to the header of an empty gzip member whose extra
+   field holds just one of our subfields, with ID si2, and return the
+   length of that subfield, or -1 if it isn't one. */
+static int
+gz_index_member(const unsigned char *p, unsigned avail, guint8 si2)
+{
+	static const unsigned char empty[10] = { 0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0 };
+	unsigned xlen, sublen;
+
+	if (avail < 16 || p[0] != 31 || p[1] != 139 || p[2] != 8 || p[3] != 4)
+		return -1;
+	xlen = pletohs(p + 10);
+	sublen = pletohs(p + 14);
+	if (p[12] != GZ_BLOCK_SI1 || p[13] != si2 || xlen != sublen + 4 ||
+	    avail < 12 + xlen + sizeof empty ||
+	    memcmp(p + 12 + xlen, empty, sizeof empty) != 0)
+		return -1;
+	return (int)sublen;
+}
+
+/* If the file ends with an index of its blocks, as written by
+   gzwfile_close(), turn it into fast seek points, so that we can seek
+   anywhere without reading up to there first. */
+static void
+gz_index_load(FILE_T state)
+{
+	unsigned char locator[GZ_LOCATOR_LEN];
+	unsigned char *buf = NULL, *p;
+	gint64 end, index_pos, in, out, last_out = -1;
+	unsigned index_len, avail;
+	int sublen, i;
+	GPtrArray *points;
+	struct fast_seek_point *val;
+
+	end = ws_lseek64(state->fd, 0, SEEK_END);
+	if (end == -1 || end - state->start < GZ_LOCATOR_LEN)
+		goto done;
+	end -= state->start;
+
+	/* find the index */
+	if (read_at(state, state->start + end - GZ_LOCATOR_LEN, locator, GZ_LOCATOR_LEN) == -1 ||
+	    gz_index_member(locator, GZ_LOCATOR_LEN, GZ_LOCATOR_SI2) != 8)
+		goto done;
+	index_pos = (gint64)pletohll(locator + 16);
+	if (index_pos < 0 || index_pos > end - GZ_LOCATOR_LEN ||
+	    end - GZ_LOCATOR_LEN - index_pos > GZ_INDEX_MAX)
+		goto done;
+	index_len = (unsigned)(end - GZ_LOCATOR_LEN - index_pos);
+
+	/* read it, and check all of it before using any of it */
+	buf = (unsigned char *)g_try_malloc(index_len ? index_len : 1);
+	if (buf == NULL || read_at(state, state->start + index_pos, buf, index_len) == -1)
+		goto done;
+	points = g_ptr_array_new();
+	for (p = buf, avail = index_len; avail != 0; ) {
+		sublen = gz_index_member(p, avail, GZ_INDEX_SI2);
+		if (sublen == -1 || sublen % GZ_INDEX_ENTRY_LEN != 0)
+			break;
+		for (i = 0; i < sublen; i += GZ_INDEX_ENTRY_LEN) {
+			in = (gint64)pletohll(p + 16 + i);
+			out = (gint64)pletohll(p + 16 + i + 8);
+			if (in < 0 || in >= index_pos || out <= last_out)
+				break;
+			val = g_new(struct fast_seek_point,1);
+			val->in = state->start + in;
+			val->out = out;
+			val->compression = GZIP_AFTER_HEADER;
+			g_ptr_array_add(points, val);
+			last_out = out;
+		}
+		if (i != sublen)
+			break;
+		p += 12 + 4 + sublen + 10;
+		avail -= 12 + 4 + sublen + 10;
+	}
+	if (avail == 0) {
+		for (i = 0; i < (int)points->len; i++)
+			g_ptr_array_add(state->fast_seek, points->pdata[i]);
+	} else {
+		for (i = 0; i < (int)points->len; i++)
+			g_free(points->pdata[i]);
+	}
+	g_ptr_array_free(points, TRUE);
+
+done:
+	g_free(buf);
+	/* put the file position back where the stream expects it */
+	ws_lseek64(state->fd, state->raw_pos, SEEK_SET);
+}
+#endif
+
+#ifdef HAVE_LIBZSTD
+/* Get ready to decompress a zstd frame.  Returns 0 on success; otherwise
+   -1 is returned and state->err is set. */
+static int
+zstd_setup(FILE_T state)
+{
+	if (state->zstd == NULL) {
+		state->zstd = ZSTD_createDCtx();
+		if (state->zstd == NULL) {
+			/* This means "not enough memory". */
+			state->err = ENOMEM;
+			state->err_info = NULL;
+			return -1;
+		}
+	} else
+		ZSTD_DCtx_reset(state->zstd, ZSTD_reset_session_only);
+	return 0;
+}
+
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	ZSTD_inBuffer input;
+	ZSTD_outBuffer output;
+	size_t ret = 1;
+	size_t before;
+
+	output.dst = buf;
+	output.size = count;
+	output.pos = 0;
+
+	/* fill output buffer up to end of frame or error */
+	do {
+		/* get more input for ZSTD_decompressStream() */
+		if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+			break;
+		if (state->avail_in == 0) {
+			/* EOF; the decoder may still have output for us,
+			   which it hands over without any more input.
+			   The frame is truncated only if it has none. */
+			input.src = state->next_in;
+			input.size = 0;
+			input.pos = 0;
+			before = output.pos;
+			ret = ZSTD_decompressStream(state->zstd, &output, &input);
+			if (ZSTD_isError(ret)) {
+				state->err = WTAP_ERR_DECOMPRESS;
+				state->err_info = ZSTD_getErrorName(ret);
+				break;
+			}
+			if (ret != 0 && output.pos == before) {
+				state->err = WTAP_ERR_SHORT_READ;
+				state->err_info = NULL;
+				break;
+			}
+			continue;
+		}
+
+		input.src = state->next_in;
+		input.size = state->avail_in;
+		input.pos = 0;
+		ret = ZSTD_decompressStream(state->zstd, &output, &input);
+		state->next_in += input.pos;
+		state->avail_in -= (unsigned)input.pos;
+		if (ZSTD_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = ZSTD_getErrorName(ret);
+			break;
+		}
+	} while (output.pos < output.size && ret != 0);
+
+	state->next = buf;
+	state->have = (unsigned)output.pos;
+
+	/* at the end of the frame, look at what follows it */
+	if (ret == 0)
+		state->compression = UNKNOWN;
+}
+
+/* If the file ends with a zstd seek table, turn it into fast seek points,
+   so that we can seek anywhere without reading up to there first. */
+static void
+zstd_index_load(FILE_T state)
+{
+	unsigned char footer[SEEKABLE_FOOTER_LEN];
+	unsigned char *buf = NULL, *p;
+	gint64 end, table_pos, in, out;
+	guint32 frames, i, entry_len, table_len, comp_len, len;
+	GPtrArray *points;
+	struct fast_seek_point *val;
+
+	end = ws_lseek64(state->fd, 0, SEEK_END);
+	if (end == -1 || end - state->start < 8 + SEEKABLE_FOOTER_LEN)
+		goto done;
+
+	/* find the seek table */
+	if (read_at(state, end - SEEKABLE_FOOTER_LEN, footer, SEEKABLE_FOOTER_LEN) == -1 ||
+	    pletohl(footer + 5) != SEEKABLE_MAGIC ||
+	    (footer[4] & 0x7c) != 0)    /* reserved bits */
+		goto done;
+	frames = pletohl(footer);
+	entry_len = (footer[4] & 0x80) ? 12 : 8;   /* with or without checksums */
+	if (frames > SEEKABLE_MAX / entry_len)
+		goto done;
+	table_len = frames * entry_len;
+	table_pos = end - SEEKABLE_FOOTER_LEN - table_len - 8;
+	if (table_pos < state->start)
+		goto done;
+
+	/* read it, and check all of it before using any of it */
+	buf = (unsigned char *)g_try_malloc(8 + table_len);
+	if (buf == NULL || read_at(state, table_pos, buf, 8 + table_len) == -1 ||
+	    pletohl(buf) != SEEKABLE_SKIPPABLE_MAGIC ||
+	    pletohl(buf + 4) != table_len + SEEKABLE_FOOTER_LEN)
+		goto done;
+	points = g_ptr_array_new();
+	in = state->start;
+	out = 0;
+	for (i = 0, p = buf + 8; i < frames; i++, p += entry_len) {
+		comp_len = pletohl(p);
+		len = pletohl(p + 4);
+		if (len != 0) {
+			val = g_new(struct fast_seek_point,1);
+			val->in = in;
+			val->out = out;
+			val->compression = ZSTD;
+			g_ptr_array_add(points, val);
+		}
+		in += comp_len;
+		out += len;
+	}
+	if (in == table_pos) {
+		for (i = 0; i < points->len; i++)
+			g_ptr_array_add(state->fast_seek, points->pdata[i]);
+	} else {
+		for (i = 0; i < points->len; i++)
+			g_free(points->pdata[i]);
+	}
+	g_ptr_array_free(points, TRUE);
+
+done:
+	g_free(buf);
+	/* put the file position back where the stream expects it */
+	ws_lseek64(state->fd, state->raw_pos, SEEK_SET);
+}
 #endif
 
 static int
@@ -573,6 +1571,35 @@ gz_head(FILE_T state)
 			return 0;
 	}
 
+#ifdef HAVE_LIBZSTD
+	/* look for a zstd frame, or for a skippable frame, such as a seek
+	   table, after one */
+	if (fill_in_buffer_min(state, 8) == -1)
+		return -1;
+	if (state->avail_in >= 4 && pletohl(state->next_in) == ZSTD_MAGICNUMBER) {
+		if (zstd_setup(state) == -1)
+			return -1;
+		/* if it's the first frame, see if the file has a seek table */
+		if (state->fast_seek != NULL && state->fast_seek->len == 0)
+			zstd_index_load(state);
+		if (state->fast_seek)
+			fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, ZSTD);
+		state->compression = ZSTD;
+		state->is_compressed = TRUE;
+		return 0;
+	}
+	if (state->avail_in >= 8 && state->zstd != NULL &&
+	    (pletohl(state->next_in) & 0xFFFFFFF0) == (SEEKABLE_SKIPPABLE_MAGIC & 0xFFFFFFF0)) {
+		guint32 frame_len = pletohl(state->next_in + 4);
+
+		state->next_in += 8;
+		state->avail_in -= 8;
+		if (skip_in(state, frame_len) == -1)
+			return -1;
+		return gz_head(state);
+	}
+#endif
+
 	/* look for the gzip magic header bytes 31 and 139 */
 #ifdef HAVE_LIBZ
 	if (state->next_in[0] == 31) {
@@ -585,11 +1612,17 @@ gz_head(FILE_T state)
 			guint8 flags;
 			guint16 len;
 			guint16 hcrc;
+			gboolean blocked = FALSE;
+			guint32 comp_len = 0;
 
 			/* we have a gzip header, woo hoo! */
 			state->avail_in--;
 			state->next_in++;
 
+			/* if it's the first one, see if the file has an index */
+			if (state->fast_seek != NULL && state->fast_seek->len == 0)
+				gz_index_load(state);
+
 			/* read rest of header */
 
 			/* compression method (CM) */
@@ -627,7 +1660,26 @@ gz_head(FILE_T state)
 				if (gz_next2(state, &len) == -1)
 					return -1;
 
-				/* skip the extra field */
+				/* look for our block subfield, skip the rest */
+				while (len >= 4) {
+					guint8 si1, si2;
+					guint16 sublen;
+
+					if (gz_next1(state, &si1) == -1 ||
+					    gz_next1(state, &si2) == -1 ||
+					    gz_next2(state, &sublen) == -1)
+						return -1;
+					len -= 4;
+					if (sublen > len)
+						sublen = len;
+					if (si1 == GZ_BLOCK_SI1 && si2 == GZ_BLOCK_SI2 && sublen == 4) {
+						if (gz_next4(state, &comp_len) == -1)
+							return -1;
+						blocked = TRUE;
+					} else if (gz_skipn(state, sublen) == -1)
+						return -1;
+					len -= sublen;
+				}
 				if (gz_skipn(state, len) == -1)
 					return -1;
 			}
@@ -648,6 +1700,16 @@ gz_head(FILE_T state)
 				/* XXX - check the CRC? */
 			}
 
+			/* if the member says where it ends, inflate it and the
+			   ones after it on the worker threads */
+			if (blocked && comp_len <= GZ_BLOCK_MAX && gz_block_setup(state)) {
+				state->blocks_out = state->pos;
+				if (gz_block_queue(state, comp_len) == -1)
+					return -1;
+				state->compression = GZIP_BLOCKS;
+				return 0;
+			}
+
 			/* set up for decompression */
 			inflateReset(&(state->strm));
 			state->strm.adler = crc32(0L, Z_NULL, 0);
@@ -696,6 +1758,22 @@ gz_head(FILE_T state)
 static int /* gz_make */
 fill_out_buffer(FILE_T state)
 {
+#ifdef HAVE_LIBZ
+	if (state->compression == GZIP_BLOCKS) {    /* inflated by worker threads */
+		gz_block_read(state, state->out, state->size << 1);
+		if (state->have || state->err)
+			return 0;
+		/* no more blocks; look at what follows them */
+	}
+#endif
+#ifdef HAVE_LIBZSTD
+	if (state->compression == ZSTD) {           /* decompress */
+		zstd_read(state, state->out, state->size << 1);
+		if (state->have || state->err)
+			return 0;
+		/* end of frame; look at what follows it */
+	}
+#endif
 	if (state->compression == UNKNOWN) {           /* look for gzip header */
 		if (gz_head(state) == -1)
 			return -1;
@@ -711,10 +1789,30 @@ fill_out_buffer(FILE_T state)
 	else if (state->compression == ZLIB) {      /* decompress */
 		zlib_read(state, state->out, state->size << 1);
 	}
+	else if (state->compression == GZIP_BLOCKS) {
+		gz_block_read(state, state->out, state->size << 1);
+	}
+#endif
+#ifdef HAVE_LIBZSTD
+	else if (state->compression == ZSTD) {
+		zstd_read(state, state->out, state->size << 1);
+	}
 #endif
 	return 0;
 }
 
+/* Returns TRUE if there's no input left to generate output from. */
+static gboolean
+gz_input_done(FILE_T state)
+{
+#ifdef HAVE_LIBZ
+	/* blocks read ahead are already out of the input buffer */
+	if (state->compression == GZIP_BLOCKS)
+		return FALSE;
+#endif
+	return state->eof && state->avail_in == 0;
+}
+
 static int
 gz_skip(FILE_T state, gint64 len)
 {
@@ -737,7 +1835,7 @@ gz_skip(FILE_T state, gint64 len)
 			   any more data into the output buffer, so
 			   return an error indication. */
 			return -1;
-		} else if (state->eof && state->avail_in == 0) {
+		} else if (gz_input_done(state)) {
 			/* We have nothing in the output buffer, and
 			   we're at the end of the input; just return. */
 			break;
@@ -765,6 +1863,23 @@ gz_reset(FILE_T state)
 	state->avail_in = 0;          /* no input data yet */
 }
 
+/* Get a size from the environment variable name, in units of unit bytes,
+   or dflt if it isn't set or isn't a sensible size. */
+static unsigned
+env_size(const char *name, unsigned unit, unsigned dflt, unsigned max)
+{
+	const char *s;
+	char *p;
+	unsigned long n;
+
+	if ((s = getenv(name)) == NULL)
+		return dflt;
+	n = strtoul(s, &p, 10);
+	if (p == s || *p != '\0' || n == 0 || n > max / unit)
+		return dflt;
+	return (unsigned)n * unit;
+}
+
 FILE_T
 file_fdopen(int fd)
 {
@@ -772,7 +1887,11 @@ file_fdopen(int fd)
 	struct stat st;
 #endif
 	int want = GZBUFSIZE;
+	unsigned size;
 	FILE_T state;
+#ifdef HAVE_PREAD
+	ws_statb64 statb;
+#endif
 
 	if (fd == -1)
 		return NULL;
@@ -805,11 +1924,15 @@ file_fdopen(int fd)
 		/* XXX, verify result? */
 	}
 #endif
+	size = env_size("WIRESHARK_READ_BUFFER_SIZE", 1024, READ_BUFSIZE, READ_BUFSIZE_MAX);
+	if (size < (unsigned)want)
+		size = want;
 
 	/* allocate buffers */
-	state->in = (unsigned char *)g_try_malloc(want);
-	state->out = (unsigned char *)g_try_malloc(want << 1);
-	state->size = want;
+	state->in = (unsigned char *)g_try_malloc(size);
+	state->out = (unsigned char *)g_try_malloc(size << 1);
+	state->size = size;
+	state->blksize = want;
 	if (state->in == NULL || state->out == NULL) {
 		g_free(state->out);
 		g_free(state->in);
@@ -818,6 +1941,27 @@ file_fdopen(int fd)
 		return NULL;
 	}
 
+	/* we expect to read the file sequentially, unless told otherwise */
+	state->read_ahead = env_size("WIRESHARK_READ_AHEAD", 1048576, READ_AHEAD, READ_AHEAD_MAX);
+	state->stall_time = 0.0;
+	state->stall_timer = g_timer_new();
+#ifdef HAVE_POSIX_FADVISE
+	(void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	state->advise = TRUE;
+	state->advised = state->raw_pos;
+#endif
+#ifdef HAVE_PREAD
+	/* the reader thread needs a file it can pread() */
+	state->ra_ok = getenv("WIRESHARK_READ_AHEAD") != NULL &&
+	    g_thread_supported() &&
+	    ws_fstat64(fd, &statb) == 0 && S_ISREG(statb.st_mode);
+	state->ra_pool = NULL;
+#ifdef HAVE_POSIX_FADVISE
+	if (state->ra_ok)
+		state->advise = FALSE;
+#endif
+#endif
+
 #ifdef HAVE_LIBZ
 	/* allocate inflate memory */
 	state->strm.zalloc = Z_NULL;
@@ -826,6 +1970,7 @@ file_fdopen(int fd)
 	state->strm.avail_in = 0;
 	state->strm.next_in = Z_NULL;
 	if (inflateInit2(&(state->strm), -15) != Z_OK) {    /* raw inflate */
+		g_timer_destroy(state->stall_timer);
 		g_free(state->out);
 		g_free(state->in);
 		g_free(state);
@@ -835,6 +1980,20 @@ file_fdopen(int fd)
 
 	/* for now, assume we should check the crc */
 	state->dont_check_crc = 0;
+
+	/* blocked members can be inflated in parallel if we have threads */
+	state->blocks_ok = g_thread_supported();
+	state->blocks_started = FALSE;
+	state->blocks_mtx = NULL;
+	state->blocks_cond = NULL;
+	state->blocks = NULL;
+	state->block = NULL;
+	state->blocks_out = 0;
+	state->blocks_err = 0;
+	state->blocks_err_info = NULL;
+#endif
+#ifdef HAVE_LIBZSTD
+	state->zstd = NULL;
 #endif
 	/* return stream */
 	return state;
@@ -893,9 +2052,49 @@ file_open(const char *path)
 }
 
 void 
-file_set_random_access(FILE_T stream, gboolean random _U_, GPtrArray *seek)
+file_set_random_access(FILE_T stream, gboolean random, GPtrArray *seek)
 {
 	stream->fast_seek = seek;
+
+	/* the first stream given the seek points fills them in from the
+	   file's index, if it has one, once gz_head() has seen what kind
+	   of file it is */
+
+	/* reading ahead would just be thrown away by the next seek */
+	if (random) {
+#ifdef HAVE_LIBZ
+		stream->blocks_ok = FALSE;
+#endif
+#ifdef HAVE_PREAD
+		ra_drain(stream);
+		stream->ra_ok = FALSE;
+#endif
+#ifdef HAVE_POSIX_FADVISE
+		(void)posix_fadvise(stream->fd, 0, 0, POSIX_FADV_RANDOM);
+		stream->advise = FALSE;
+#endif
+		/* nor does it need the big sequential buffers; nothing has
+		   been read yet, so just swap them for smaller ones */
+		if (stream->avail_in == 0 && stream->have == 0 &&
+		    stream->blksize < stream->size) {
+			unsigned char *in, *out;
+
+			in = (unsigned char *)g_try_malloc(stream->blksize);
+			out = (unsigned char *)g_try_malloc(stream->blksize << 1);
+			if (in != NULL && out != NULL) {
+				g_free(stream->in);
+				g_free(stream->out);
+				stream->in = in;
+				stream->out = out;
+				stream->next_in = in;
+				stream->next = out;
+			} else {
+				g_free(out);
+				g_free(in);
+			}
+			stream->size = stream->blksize;
+		}
+	}
 }
 
 gint64
@@ -964,12 +2163,21 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 			off = here->in;
 			off2 = here->out;
 		} else
+#endif
+#ifdef HAVE_LIBZSTD
+		if (here->compression == ZSTD) {
+			off = here->in;
+			off2 = here->out;
+		} else
 #endif
 		{
 			off2 = (file->pos + offset);
 			off = here->in + (off2 - here->out);
 		}
 
+#ifdef HAVE_LIBZ
+		gz_block_drain(file);
+#endif
 		if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
 			*err = errno;
 			return -1;
@@ -1016,6 +2224,15 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 			strm->adler = crc32(0L, Z_NULL, 0);
 			file->compression = ZLIB;
 		} else
+#endif
+#ifdef HAVE_LIBZSTD
+		if (here->compression == ZSTD) {
+			if (zstd_setup(file) == -1) {
+				*err = file->err;
+				return -1;
+			}
+			file->compression = ZSTD;
+		} else
 #endif
 			file->compression = here->compression;
 
@@ -1034,7 +2251,7 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 	if (file->compression == UNCOMPRESSED && file->pos + offset >= file->raw 
 			&& (offset < 0 || offset >= file->have) /* seek only when we don't have that offset in buffer */)
 	{
-		if (ws_lseek64(file->fd, offset - file->have, SEEK_CUR) == -1) {
+		if (ws_lseek64(file->fd, file->raw_pos + (offset - file->have), SEEK_SET) == -1) {
 			*err = errno;
 			return -1;
 		}
@@ -1059,6 +2276,9 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 		/* rewind, then skip to offset */
 
 		/* back up and start over */
+#ifdef HAVE_LIBZ
+		gz_block_drain(file);
+#endif
 		if (ws_lseek64(file->fd, file->start, SEEK_SET) == -1) {
 			*err = errno;
 			return -1;
@@ -1126,6 +2346,12 @@ file_iscompressed(FILE_T stream)
 	return stream->is_compressed;
 }
 
+double
+file_stall_time(FILE_T stream)
+{
+	return stream->stall_time;
+}
+
 int 
 file_read(void *buf, unsigned int len, FILE_T file)
 {
@@ -1159,7 +2385,7 @@ file_read(void *buf, unsigned int len, FILE_T file)
 			   any more data into the output buffer, so
 			   return an error indication. */
 			return -1;
-		} else if (file->eof && file->avail_in == 0) {
+		} else if (gz_input_done(file)) {
 			/* We have nothing in the output buffer, and
 			   we're at the end of the input; just return
 			   with what we've gotten so far. */
@@ -1277,7 +2503,7 @@ int
 file_eof(FILE_T file)
 {
 	/* return end-of-file state */
-	return (file->eof && file->avail_in == 0 && file->have == 0);
+	return (gz_input_done(file) && file->have == 0);
 }
 
 /*
@@ -1307,6 +2533,9 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+#ifdef HAVE_PREAD
+	ra_drain(file);
+#endif
 	ws_close(file->fd);
 	file->fd = -1;
 }
@@ -1331,7 +2560,41 @@ file_close(FILE_T file)
 	if (file->size) {
 #ifdef HAVE_LIBZ
 		inflateEnd(&(file->strm));
+		if (file->blocks_started) {
+			gz_block_drain(file);
+			g_atomic_int_add(&gz_block_streams, -1);
+			g_queue_free(file->blocks);
+#if GLIB_CHECK_VERSION(2,31,0)
+			g_mutex_clear(file->blocks_mtx);
+			g_free(file->blocks_mtx);
+			g_cond_clear(file->blocks_cond);
+			g_free(file->blocks_cond);
+#else
+			g_mutex_free(file->blocks_mtx);
+			g_cond_free(file->blocks_cond);
+#endif
+		}
+#endif
+#ifdef HAVE_LIBZSTD
+		ZSTD_freeDCtx(file->zstd);
+#endif
+#ifdef HAVE_PREAD
+		if (file->ra_pool != NULL) {
+			ra_drain(file);
+			g_thread_pool_free(file->ra_pool, FALSE, TRUE);
+			g_queue_free(file->ra_chunks);
+#if GLIB_CHECK_VERSION(2,31,0)
+			g_mutex_clear(file->ra_mtx);
+			g_free(file->ra_mtx);
+			g_cond_clear(file->ra_cond);
+			g_free(file->ra_cond);
+#else
+			g_mutex_free(file->ra_mtx);
+			g_cond_free(file->ra_cond);
 #endif
+		}
+#endif
+		g_timer_destroy(file->stall_timer);
 		g_free(file->out);
 		g_free(file->in);
 	}
@@ -1354,48 +2617,76 @@ struct wtap_writer {
     int fd;                 /* file descriptor */
     gint64 pos;             /* current position in uncompressed data */
     unsigned size;          /* buffer size, zero if not allocated yet */
-    unsigned want;          /* requested buffer size, default is GZBUFSIZE */
-    unsigned char *in;      /* input buffer */
-    unsigned char *out;     /* output buffer (double-sized when reading) */
-    unsigned char *next;    /* next output data to deliver or write */
+    unsigned want;          /* requested buffer size, default is GZ_BLOCK_SIZE */
+    unsigned char *in;      /* input buffer, holding one block */
+    unsigned have;          /* amount of data in the input buffer */
+    unsigned char *out;     /* output buffer, holding one gzip member */
+    unsigned out_size;      /* size of the output buffer */
     int level;              /* compression level */
     int strategy;           /* compression strategy */
     int err;                /* error code */
+    gint64 raw_pos;         /* amount of compressed data written */
+    GArray *index;          /* where the blocks written so far start */
 	/* zlib deflate stream */
     z_stream strm;          /* stream structure in-place (not a pointer) */
+#ifdef HAVE_LIBZSTD
+    ZSTD_CCtx *zstd;        /* non-NULL if writing zstd frames rather than gzip */
+#endif
+};
+
+struct gz_index_entry {
+    gint64 in;              /* offset of the block's compressed data */
+    gint64 out;             /* offset of the block's uncompressed data */
 };
 
+/* Open a file for writing compressed; on failure return NULL and set *err */
 GZWFILE_T
-gzwfile_open(const char *path)
+gzwfile_open(const char *path, int compression, int *err)
 {
     int fd;
     GZWFILE_T state;
-    int save_errno;
 
     fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
-    if (fd == -1)
+    if (fd == -1) {
+        *err = errno;
         return NULL;
-    state = gzwfile_fdopen(fd);
-    if (state == NULL) {
-        save_errno = errno;
-        close(fd);
-        errno = save_errno;
     }
+    state = gzwfile_fdopen(fd, compression, err);
+    if (state == NULL)
+        close(fd);
     return state;
 }
 
 GZWFILE_T
-gzwfile_fdopen(int fd)
+gzwfile_fdopen(int fd, int compression, int *err)
 {
     GZWFILE_T state;
 
     /* allocate wtap_writer structure to return */
     state = (GZWFILE_T)g_try_malloc(sizeof *state);
-    if (state == NULL)
+    if (state == NULL) {
+        *err = ENOMEM;
+        return NULL;
+    }
+#ifdef HAVE_LIBZSTD
+    state->zstd = NULL;
+    if (compression == WTAP_ZSTD_COMPRESSED) {
+        state->zstd = ZSTD_createCCtx();
+        if (state->zstd == NULL) {
+            g_free(state);
+            *err = ENOMEM;
+            return NULL;
+        }
+    } else
+#endif
+    if (compression != WTAP_GZIP_COMPRESSED) {
+        g_free(state);
+        *err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
         return NULL;
+    }
     state->fd = fd;
     state->size = 0;            /* no buffers allocated yet */
-    state->want = GZBUFSIZE;    /* requested buffer size */
+    state->want = GZ_BLOCK_SIZE;    /* requested buffer size */
 
     state->level = Z_DEFAULT_COMPRESSION;
     state->strategy = Z_DEFAULT_STRATEGY;
@@ -1403,7 +2694,9 @@ gzwfile_fdopen(int fd)
     /* initialize stream */
     state->err = Z_OK;              /* clear error */
     state->pos = 0;                 /* no uncompressed data yet */
-    state->strm.avail_in = 0;       /* no input data yet */
+    state->have = 0;                /* no input data yet */
+    state->raw_pos = 0;
+    state->index = g_array_new(FALSE, FALSE, sizeof (struct gz_index_entry));
 
     /* return stream */
     return state;
@@ -1418,101 +2711,212 @@ gz_init(GZWFILE_T state)
     int ret;
     z_streamp strm = &(state->strm);
 
+#ifdef HAVE_LIBZSTD
+    if (state->zstd != NULL) {
+        /* one frame per block, each with a checksum of its data */
+        if (ZSTD_isError(ZSTD_CCtx_setParameter(state->zstd, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT)) ||
+            ZSTD_isError(ZSTD_CCtx_setParameter(state->zstd, ZSTD_c_checksumFlag, 1))) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        state->out_size = (unsigned)ZSTD_compressBound(state->want);
+    } else
+#endif
+    {
+        /* allocate deflate memory, set up for raw deflate; we write the
+           gzip header and trailer of each block ourselves */
+        strm->zalloc = Z_NULL;
+        strm->zfree = Z_NULL;
+        strm->opaque = Z_NULL;
+        ret = deflateInit2(strm, state->level, Z_DEFLATED,
+                           -15, 8, state->strategy);
+        if (ret != Z_OK) {
+            if (ret == Z_MEM_ERROR) {
+            	/* This means "not enough memory". */
+            	state->err = ENOMEM;
+            } else {
+            	/* This "shouldn't happen". */
+            	state->err = WTAP_ERR_INTERNAL;
+            }
+            return -1;
+        }
+
+        /* a block can't compress to more than deflateBound() says */
+        state->out_size = GZ_BLOCK_HEADER_LEN +
+                          (unsigned)deflateBound(strm, state->want) +
+                          GZ_BLOCK_TRAILER_LEN;
+    }
+
     /* allocate input and output buffers */
     state->in = (unsigned char *)g_try_malloc(state->want);
-    state->out = (unsigned char *)g_try_malloc(state->want);
+    state->out = (unsigned char *)g_try_malloc(state->out_size);
     if (state->in == NULL || state->out == NULL) {
         g_free(state->out);
         g_free(state->in);
+#ifdef HAVE_LIBZSTD
+        if (state->zstd == NULL)
+#endif
+            (void)deflateEnd(strm);
         state->err = ENOMEM;
         return -1;
     }
 
-    /* allocate deflate memory, set up for gzip compression */
-    strm->zalloc = Z_NULL;
-    strm->zfree = Z_NULL;
-    strm->opaque = Z_NULL;
-    ret = deflateInit2(strm, state->level, Z_DEFLATED,
-                       15 + 16, 8, state->strategy);
-    if (ret != Z_OK) {
-        g_free(state->out);
-        g_free(state->in);
-        if (ret == Z_MEM_ERROR) {
-        	/* This means "not enough memory". */
-        	state->err = ENOMEM;
-        } else {
-        	/* This "shouldn't happen". */
-        	state->err = WTAP_ERR_INTERNAL;
-        }
-        return -1;
-    }
-
     /* mark state as initialized */
     state->size = state->want;
+    state->have = 0;
+    return 0;
+}
 
-    /* initialize write buffer */
-    strm->avail_out = state->size;
-    strm->next_out = state->out;
-    state->next = strm->next_out;
+/* Write len bytes from buf to the output file.  Return -1, and set
+   state->err, on failure; return 0 on success. */
+static int
+gz_write_raw(GZWFILE_T state, const unsigned char *buf, unsigned len)
+{
+    int got;
+
+    got = write(state->fd, buf, len);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((unsigned)got != len) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    state->raw_pos += len;
     return 0;
 }
 
-/* Compress whatever is at avail_in and next_in and write to the output file.
-   Return -1, and set state->err, if there is an error writing to the output
-   file; return 0 on success.
-   flush is assumed to be a valid deflate() flush value.  If flush is Z_FINISH,
-   then the deflate() state is reset to start a new gzip stream. */
+#ifdef HAVE_LIBZSTD
+/* Compress what's in the input buffer as one zstd frame, and write it
+   to the output file.  Return -1, and set state->err, if there is an
+   error writing to the output file; return 0 on success. */
 static int
-gz_comp(GZWFILE_T state, int flush)
+zstd_comp(GZWFILE_T state)
 {
-    int ret, got;
-    unsigned have;
-    z_streamp strm = &(state->strm);
+    size_t ret;
+    struct gz_index_entry entry;
+
+    ret = ZSTD_compress2(state->zstd, state->out, state->out_size,
+                         state->in, state->have);
+    if (ZSTD_isError(ret)) {
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
 
-    /* allocate memory if this is the first time through */
-    if (state->size == 0 && gz_init(state) == -1)
+    entry.in = state->raw_pos;
+    entry.out = state->pos - state->have;
+    if (gz_write_raw(state, state->out, (unsigned)ret) == -1)
         return -1;
+    g_array_append_val(state->index, entry);
+    state->have = 0;
+    return 0;
+}
 
-    /* run deflate() on provided input until it produces no more output */
-    ret = Z_OK;
-    do {
-        /* write out current buffer contents if full, or if flushing, but if
-           doing Z_FINISH then don't write until we get to Z_STREAM_END */
-        if (strm->avail_out == 0 || (flush != Z_NO_FLUSH &&
-            (flush != Z_FINISH || ret == Z_STREAM_END))) {
-            have = (unsigned)(strm->next_out - state->next);
-            if (have) {
-		got = write(state->fd, state->next, have);
-		if (got < 0) {
-                    state->err = errno;
-                    return -1;
-                }
-                if ((unsigned)got != have) {
-                    state->err = WTAP_ERR_SHORT_WRITE;
-                    return -1;
-                }
-            }
-            if (strm->avail_out == 0) {
-                strm->avail_out = state->size;
-                strm->next_out = state->out;
-            }
-            state->next = strm->next_out;
-        }
+/* Write the seek table for the frames written.  Return -1, and set
+   state->err, on failure; return 0 on success. */
+static int
+zstd_write_index(GZWFILE_T state)
+{
+    unsigned char *buf, *p;
+    struct gz_index_entry *entry, *next;
+    guint i, n = state->index->len;
+    guint32 table_len = n * 8;
 
-        /* compress */
-        have = strm->avail_out;
-        ret = deflate(strm, flush);
-        if (ret == Z_STREAM_ERROR) {
-            /* This "shouldn't happen". */
-            state->err = WTAP_ERR_INTERNAL;
-            return -1;
+    buf = (unsigned char *)g_try_malloc(8 + table_len + SEEKABLE_FOOTER_LEN);
+    if (buf == NULL) {
+        state->err = ENOMEM;
+        return -1;
+    }
+    phtolel(buf, SEEKABLE_SKIPPABLE_MAGIC);
+    phtolel(buf + 4, table_len + SEEKABLE_FOOTER_LEN);
+    for (i = 0, p = buf + 8; i < n; i++, p += 8) {
+        entry = &g_array_index(state->index, struct gz_index_entry, i);
+        if (i + 1 < n) {
+            next = &g_array_index(state->index, struct gz_index_entry, i + 1);
+            phtolel(p, (guint32)(next->in - entry->in));
+            phtolel(p + 4, (guint32)(next->out - entry->out));
+        } else {
+            phtolel(p, (guint32)(state->raw_pos - entry->in));
+            phtolel(p + 4, (guint32)(state->pos - entry->out));
         }
-        have -= strm->avail_out;
-    } while (have);
+    }
+    phtolel(p, n);
+    p[4] = 0;                   /* no checksums in the table */
+    phtolel(p + 5, SEEKABLE_MAGIC);
+
+    if (gz_write_raw(state, buf, 8 + table_len + SEEKABLE_FOOTER_LEN) == -1) {
+        g_free(buf);
+        return -1;
+    }
+    g_free(buf);
+    return 0;
+}
+#endif
 
-    /* if that completed a deflate stream, allow another to start */
-    if (flush == Z_FINISH)
-        deflateReset(strm);
+/* Compress what's in the input buffer as one gzip member, and write it
+   to the output file.  Return -1, and set state->err, if there is an
+   error writing to the output file; return 0 on success. */
+static int
+gz_comp(GZWFILE_T state)
+{
+    int ret;
+    guint32 crc;
+    z_streamp strm = &(state->strm);
+    unsigned char *head, *tail;
+    struct gz_index_entry entry;
+
+    /* allocate memory if this is the first time through */
+    if (state->size == 0 && gz_init(state) == -1)
+        return -1;
+#ifdef HAVE_LIBZSTD
+    if (state->zstd != NULL)
+        return zstd_comp(state);
+#endif
+    head = state->out;
+
+    /* compress the whole block in one go */
+    strm->next_in = state->in;
+    strm->avail_in = state->have;
+    strm->next_out = state->out + GZ_BLOCK_HEADER_LEN;
+    strm->avail_out = state->out_size - GZ_BLOCK_HEADER_LEN - GZ_BLOCK_TRAILER_LEN;
+    ret = deflate(strm, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    tail = strm->next_out;
+    (void)deflateReset(strm);
+
+    /* gzip header, with our block subfield (see GZ_BLOCK_SIZE) */
+    head[0] = 31;
+    head[1] = 139;
+    head[2] = 8;                /* CM = deflate */
+    head[3] = 4;                /* FLG = FEXTRA */
+    phtolel(&head[4], 0);       /* MTIME, not available */
+    head[8] = 0;                /* XFL */
+    head[9] = 255;              /* OS = unknown */
+    phtoles(&head[10], 8);      /* XLEN */
+    head[12] = GZ_BLOCK_SI1;
+    head[13] = GZ_BLOCK_SI2;
+    phtoles(&head[14], 4);
+    phtolel(&head[16], (guint32)(tail - (head + GZ_BLOCK_HEADER_LEN)));
+
+    /* gzip trailer */
+    crc = crc32(crc32(0L, Z_NULL, 0), state->in, state->have);
+    phtolel(tail, crc);
+    phtolel(tail + 4, state->have);
+    tail += GZ_BLOCK_TRAILER_LEN;
+
+    entry.in = state->raw_pos + GZ_BLOCK_HEADER_LEN;
+    entry.out = state->pos - state->have;
+    if (gz_write_raw(state, head, (unsigned)(tail - head)) == -1)
+        return -1;
+    g_array_append_val(state->index, entry);
+    state->have = 0;
 
     /* all done, no errors */
     return 0;
@@ -1526,9 +2930,6 @@ gzwfile_write(GZWFILE_T state, const void *buf, unsigned len)
 {
     unsigned put = len;
     unsigned n;
-    z_streamp strm;
-
-    strm = &(state->strm);
 
     /* check that there's no error */
     if (state->err != Z_OK)
@@ -1542,43 +2943,26 @@ gzwfile_write(GZWFILE_T state, const void *buf, unsigned len)
     if (state->size == 0 && gz_init(state) == -1)
         return 0;
 
-    /* for small len, copy to input buffer, otherwise compress directly */
-    if (len < state->size) {
-        /* copy to input buffer, compress when full */
-        do {
-            if (strm->avail_in == 0)
-                strm->next_in = state->in;
-            n = state->size - strm->avail_in;
-            if (n > len)
-                n = len;
-            memcpy(strm->next_in + strm->avail_in, buf, n);
-            strm->avail_in += n;
-            state->pos += n;
-            buf = (char *)buf + n;
-            len -= n;
-            if (len && gz_comp(state, Z_NO_FLUSH) == -1)
-                return 0;
-        } while (len);
-    }
-    else {
-        /* consume whatever's left in the input buffer */
-        if (strm->avail_in && gz_comp(state, Z_NO_FLUSH) == -1)
-            return 0;
-
-        /* directly compress user buffer to file */
-        strm->avail_in = len;
-        strm->next_in = (voidp)buf;
-        state->pos += len;
-        if (gz_comp(state, Z_NO_FLUSH) == -1)
+    /* copy to input buffer, compress a block whenever it's full */
+    do {
+        n = state->size - state->have;
+        if (n > len)
+            n = len;
+        memcpy(state->in + state->have, buf, n);
+        state->have += n;
+        state->pos += n;
+        buf = (const char *)buf + n;
+        len -= n;
+        if (state->have == state->size && gz_comp(state) == -1)
             return 0;
-    }
+    } while (len);
 
     /* input was all buffered or compressed (put will fit in int) */
     return (int)put;
 }
 
-/* Flush out what we've written so far.  Returns -1, and sets state->err,
-   on failure; returns 0 on success. */
+/* Flush out what we've written so far, ending the current block early.
+   Returns -1, and sets state->err, on failure; returns 0 on success. */
 int
 gzwfile_flush(GZWFILE_T state)
 {
@@ -1586,13 +2970,94 @@ gzwfile_flush(GZWFILE_T state)
     if (state->err != Z_OK)
         return -1;
 
-    /* compress remaining data with Z_SYNC_FLUSH */
-    gz_comp(state, Z_SYNC_FLUSH);
-    if (state->err != Z_OK)
+    /* compress remaining data as a short block */
+    if (state->have && gz_comp(state) == -1)
         return -1;
     return 0;
 }
 
+/* Put the header of an empty gzip member with an xlen-byte extra field
+   into buf, returning its length. */
+static unsigned
+gz_empty_header(unsigned char *buf, unsigned xlen)
+{
+    buf[0] = 31;
+    buf[1] = 139;
+    buf[2] = 8;                 /* CM = deflate */
+    buf[3] = 4;                 /* FLG = FEXTRA */
+    phtolel(&buf[4], 0);        /* MTIME, not available */
+    buf[8] = 0;                 /* XFL */
+    buf[9] = 255;               /* OS = unknown */
+    phtoles(&buf[10], xlen);
+    return 12;
+}
+
+/* Put the data and trailer of an empty gzip member into buf, returning
+   their length. */
+static unsigned
+gz_empty_trailer(unsigned char *buf)
+{
+    buf[0] = 0x03;              /* final fixed-Huffman block, no data */
+    buf[1] = 0x00;
+    memset(&buf[2], 0, GZ_BLOCK_TRAILER_LEN);   /* CRC-32 and ISIZE of nothing */
+    return 2 + GZ_BLOCK_TRAILER_LEN;
+}
+
+/* Write the index of the blocks, and the locator for it, at the end of
+   the file.  Return -1, and set state->err, on failure; return 0 on
+   success. */
+static int
+gz_write_index(GZWFILE_T state)
+{
+    unsigned char *buf, *p;
+    struct gz_index_entry *entry;
+    guint first, i, n;
+    gint64 index_pos = state->raw_pos;
+
+    buf = (unsigned char *)g_try_malloc(12 + 4 + GZ_INDEX_MAX_ENTRIES * GZ_INDEX_ENTRY_LEN + 10);
+    if (buf == NULL) {
+        state->err = ENOMEM;
+        return -1;
+    }
+    for (first = 0; first < state->index->len; first += n) {
+        n = state->index->len - first;
+        if (n > GZ_INDEX_MAX_ENTRIES)
+            n = GZ_INDEX_MAX_ENTRIES;
+        p = buf + gz_empty_header(buf, 4 + n * GZ_INDEX_ENTRY_LEN);
+        *p++ = GZ_BLOCK_SI1;
+        *p++ = GZ_INDEX_SI2;
+        phtoles(p, n * GZ_INDEX_ENTRY_LEN);
+        p += 2;
+        for (i = 0; i < n; i++) {
+            entry = &g_array_index(state->index, struct gz_index_entry, first + i);
+            phtolell(p, (guint64)entry->in);
+            phtolell(p + 8, (guint64)entry->out);
+            p += GZ_INDEX_ENTRY_LEN;
+        }
+        p += gz_empty_trailer(p);
+        if (gz_write_raw(state, buf, (unsigned)(p - buf)) == -1) {
+            g_free(buf);
+            return -1;
+        }
+    }
+
+    p = buf + gz_empty_header(buf, 12);
+    *p++ = GZ_BLOCK_SI1;
+    *p++ = GZ_LOCATOR_SI2;
+    phtoles(p, 8);
+    p += 2;
+    phtolell(p, (guint64)index_pos);
+    p += 8;
+    p += gz_empty_trailer(p);
+    g_assert(p - buf == GZ_LOCATOR_LEN);
+    if (gz_write_raw(state, buf, GZ_LOCATOR_LEN) == -1) {
+        g_free(buf);
+        return -1;
+    }
+    g_free(buf);
+    return 0;
+}
+
 /* Flush out all data written, and close the file.  Returns a Wiretap
    error on failure; returns 0 on success. */
 int
@@ -1600,12 +3065,33 @@ gzwfile_close(GZWFILE_T state)
 {
     int ret = 0;
 
-    /* flush, free memory, and close file */
-    if (gz_comp(state, Z_FINISH) == -1 && ret == 0)
+    /* flush, write the index, free memory, and close file; if nothing
+       was written, still write an empty block, so that the file is a
+       valid gzip file */
+    if (state->err != Z_OK)
         ret = state->err;
-    (void)deflateEnd(&(state->strm));
-    g_free(state->out);
-    g_free(state->in);
+    else if ((state->have || state->pos == 0) && gz_comp(state) == -1)
+        ret = state->err;
+#ifdef HAVE_LIBZSTD
+    else if (state->zstd != NULL) {
+        if (zstd_write_index(state) == -1)
+            ret = state->err;
+    }
+#endif
+    else if (gz_write_index(state) == -1)
+        ret = state->err;
+    g_array_free(state->index, TRUE);
+    if (state->size) {
+#ifdef HAVE_LIBZSTD
+        if (state->zstd == NULL)
+#endif
+            (void)deflateEnd(&(state->strm));
+        g_free(state->out);
+        g_free(state->in);
+    }
+#ifdef HAVE_LIBZSTD
+    ZSTD_freeCCtx(state->zstd);
+#endif
     state->err = Z_OK;
     if (close(state->fd) == -1 && ret == 0)
         ret = errno;
@@ -36,6 +36,7 @@ extern gint64 file_tell(FILE_T stream);
 extern gint64 file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 extern gboolean file_iscompressed(FILE_T stream);
+extern double file_stall_time(FILE_T stream);
 extern int file_read(void *buf, unsigned int count, FILE_T file);
 extern int file_getc(FILE_T stream);
 extern char *file_gets(char *buf, int len, FILE_T stream);
@@ -49,8 +50,8 @@ extern void file_close(FILE_T file);
 #ifdef HAVE_LIBZ
 typedef struct wtap_writer *GZWFILE_T;
 
-extern GZWFILE_T gzwfile_open(const char *path);
-extern GZWFILE_T gzwfile_fdopen(int fd);
+extern GZWFILE_T gzwfile_open(const char *path, int compression, int *err);
+extern GZWFILE_T gzwfile_fdopen(int fd, int compression, int *err);
 extern unsigned gzwfile_write(GZWFILE_T state, const void *buf, unsigned len);
 extern int gzwfile_flush(GZWFILE_T state);
 extern int gzwfile_close(GZWFILE_T state);
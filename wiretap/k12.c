@@ -1037,8 +1037,7 @@ static gboolean k12_dump_close(wtap_dumper *wdh, int *err) {
     if (! wtap_dump_file_write(wdh, k12_eof, 2, err))
         return FALSE;
 
-    if (fseek(wdh->fh, 8, SEEK_SET) == -1) {
-        *err = errno;
+    if (wtap_dump_file_seek(wdh, 8, SEEK_SET, err) == -1) {
         return FALSE;
     }
 
@@ -1063,8 +1062,7 @@ gboolean k12_dump_open(wtap_dumper *wdh, int *err) {
         return FALSE;
     }
 
-    if (fseek(wdh->fh, 0x200, SEEK_SET) == -1) {
-        *err = errno;
+    if (wtap_dump_file_seek(wdh, 0x200, SEEK_SET, err) == -1) {
         return FALSE;
     }
 
@@ -809,8 +809,7 @@ gboolean lanalyzer_dump_open(wtap_dumper *wdh, int *err)
            + sizeof (LA_CyclicInformationFake)
            + LA_IndexRecordSize;
 
-      if (fseek(wdh->fh, jump, SEEK_SET) == -1) {
-	      *err = errno;
+      if (wtap_dump_file_seek(wdh, jump, SEEK_SET, err) == -1) {
 	      return FALSE;
             }
       wdh->bytes_dumped = jump;
@@ -840,7 +839,8 @@ static gboolean lanalyzer_dump_header(wtap_dumper *wdh, int *err)
       if (fT == NULL)
             return FALSE;
 
-      fseek(wdh->fh, 0, SEEK_SET);
+      if (wtap_dump_file_seek(wdh, 0, SEEK_SET, err) == -1)
+            return FALSE;
 
       if (!wtap_dump_file_write(wdh, &LA_HeaderRegularFake,
                                 sizeof LA_HeaderRegularFake, err))
@@ -663,10 +663,20 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 	orig_size -= phdr_len;
 	packet_size -= phdr_len;
 
-	buffer_assure_space(wth->frame_buffer, packet_size);
-	if (!libpcap_read_rec_data(wth->fh, buffer_start_ptr(wth->frame_buffer),
-	    packet_size, err, err_info))
-		return FALSE;	/* Read error */
+	if (wth->skip_packet_data) {
+		/*
+		 * The caller only wants the record header; seek over
+		 * the packet data.
+		 */
+		if (file_skip(wth->fh, packet_size, err) == -1)
+			return FALSE;
+	} else {
+		buffer_assure_space(wth->frame_buffer, packet_size);
+		if (!libpcap_read_rec_data(wth->fh,
+		    buffer_start_ptr(wth->frame_buffer), packet_size, err,
+		    err_info))
+			return FALSE;	/* Read error */
+	}
 
 	wth->phdr.presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN;
 
@@ -686,9 +696,10 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 	wth->phdr.caplen = packet_size;
 	wth->phdr.len = orig_size;
 
-	pcap_read_post_process(wth->file_type, wth->file_encap,
-	    &wth->pseudo_header, buffer_start_ptr(wth->frame_buffer),
-	    wth->phdr.caplen, libpcap->byte_swapped, -1);
+	if (!wth->skip_packet_data)
+		pcap_read_post_process(wth->file_type, wth->file_encap,
+		    &wth->pseudo_header, buffer_start_ptr(wth->frame_buffer),
+		    wth->phdr.caplen, libpcap->byte_swapped, -1);
 	return TRUE;
 }
 
@@ -1516,8 +1516,7 @@ gboolean netxray_dump_open_1_1(wtap_dumper *wdh, int *err)
 	   haven't yet written any packets.  As we'll have to rewrite
 	   the header when we've written out all the packets, we just
 	   skip over the header for now. */
-	if (fseek(wdh->fh, CAPTUREFILE_HEADER_SIZE, SEEK_SET) == -1) {
-		*err = errno;
+	if (wtap_dump_file_seek(wdh, CAPTUREFILE_HEADER_SIZE, SEEK_SET, err) == -1) {
 		return FALSE;
 	}
 	wdh->bytes_dumped += CAPTUREFILE_HEADER_SIZE;
@@ -1593,10 +1592,11 @@ static gboolean netxray_dump_close_1_1(wtap_dumper *wdh, int *err)
 	guint32 filelen;
 	struct netxray_hdr file_hdr;
 
-	filelen = (guint32)ftell(wdh->fh);	/* XXX - large files? */
+	filelen = (guint32)wtap_dump_file_tell(wdh);	/* XXX - large files? */
 
 	/* Go back to beginning */
-	fseek(wdh->fh, 0, SEEK_SET);
+	if (wtap_dump_file_seek(wdh, 0, SEEK_SET, err) == -1)
+		return FALSE;
 
 	/* Rewrite the file header. */
 	if (!wtap_dump_file_write(wdh, netxray_magic, sizeof netxray_magic, err))
@@ -1676,8 +1676,7 @@ gboolean netxray_dump_open_2_0(wtap_dumper *wdh, int *err)
 	   haven't yet written any packets.  As we'll have to rewrite
 	   the header when we've written out all the packets, we just
 	   skip over the header for now. */
-	if (fseek(wdh->fh, CAPTUREFILE_HEADER_SIZE, SEEK_SET) == -1) {
-		*err = errno;
+	if (wtap_dump_file_seek(wdh, CAPTUREFILE_HEADER_SIZE, SEEK_SET, err) == -1) {
 		return FALSE;
 	}
 	wdh->bytes_dumped += CAPTUREFILE_HEADER_SIZE;
@@ -1771,10 +1770,11 @@ static gboolean netxray_dump_close_2_0(wtap_dumper *wdh, int *err)
 	guint32 filelen;
 	struct netxray_hdr file_hdr;
 
-	filelen = (guint32)ftell(wdh->fh);	/* XXX - large files? */
+	filelen = (guint32)wtap_dump_file_tell(wdh);	/* XXX - large files? */
 
 	/* Go back to beginning */
-	fseek(wdh->fh, 0, SEEK_SET);
+	if (wtap_dump_file_seek(wdh, 0, SEEK_SET, err) == -1)
+		return FALSE;
 
 	/* Rewrite the file header. */
 	if (!wtap_dump_file_write(wdh, netxray_magic, sizeof netxray_magic, err))
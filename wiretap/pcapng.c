@@ -370,6 +370,8 @@ typedef struct wtapng_block_s {
         const union wtap_pseudo_header *pseudo_header;
         struct wtap_pkthdr *packet_header;
         const guint8 *frame_buffer;
+        guint frame_buffer_size;        /* space available at frame_buffer when reading */
+        gboolean skip_data;             /* seek over packet data rather than reading it */
         int *file_encap;
 } wtapng_block_t;
 
@@ -390,6 +392,8 @@ typedef struct {
         gint8 if_fcslen;
         wtap_new_ipv4_callback_t add_new_ipv4;
         wtap_new_ipv6_callback_t add_new_ipv6;
+        guint8 *block_buf;                                              /**< Packet block body, if it doesn't fit in the frame buffer */
+        guint block_buf_len;
 } pcapng_t;
 
 static int
@@ -450,6 +454,41 @@ pcapng_read_option(FILE_T fh, pcapng_t *pn, pcapng_option_header_t *oh,
         return block_read;
 }
 
+/*
+ * Same as pcapng_read_option(), but for an option in a block that has
+ * already been read into memory.  Returns the number of bytes used,
+ * including padding, with *content pointing at the option's value.
+ */
+static int
+pcapng_parse_option(pcapng_t *pn, const guint8 *p, guint len,
+                    pcapng_option_header_t *oh, const guint8 **content)
+{
+        guint option_len;
+
+        if (len < sizeof (*oh)) {
+                pcapng_debug0("pcapng_parse_option: failed to read option");
+                return 0;
+        }
+        memcpy(oh, p, sizeof (*oh));
+        if (pn->byte_swapped) {
+                oh->option_code      = BSWAP16(oh->option_code);
+                oh->option_length    = BSWAP16(oh->option_length);
+        }
+
+        /* sanity check: option length, including padding */
+        option_len = oh->option_length;
+        if ((option_len % 4) != 0)
+                option_len += 4 - (option_len % 4);
+        if (option_len > len - sizeof (*oh)) {
+                pcapng_debug2("pcapng_parse_option: option_length %u larger than remaining block (%u)",
+                              oh->option_length, (guint)(len - sizeof (*oh)));
+                return 0;
+        }
+
+        *content = p + sizeof (*oh);
+        return (int)(sizeof (*oh) + option_len);
+}
+
 
 static int
 pcapng_read_section_header_block(FILE_T fh, gboolean first_block,
@@ -899,8 +938,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
 {
         int bytes_read;
         int block_read;
-        int to_read, opt_cont_buf_len;
-        guint64 file_offset64;
+        guint to_read;
         pcapng_enhanced_packet_block_t epb;
         pcapng_packet_block_t pb;
         guint32 block_total_length;
@@ -909,7 +947,11 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
         guint64 ts;
         pcapng_option_header_t oh;
         int pseudo_header_len;
-        char *option_content = NULL; /* Allocate as large as the options block */
+        guint32 data_len, body_len;
+        guint8 *body;
+        const guint8 *opt_ptr;
+        const guint8 *option_content;
+        guint32 trailer_length;
         int fcslen;
 
         /* "(Enhanced) Packet Block" read fixed part */
@@ -1092,28 +1134,59 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
         wblock->packet_header->ts.secs = (time_t)(ts / int_data.time_units_per_second);
         wblock->packet_header->ts.nsecs = (int)(((ts % int_data.time_units_per_second) * 1000000000) / int_data.time_units_per_second);
 
-        /* "(Enhanced) Packet Block" read capture data */
+        /*
+         * Read the rest of the block - capture data, padding, options
+         * and the trailing block length - in one go.  If it fits, read
+         * it straight into the frame buffer, so the capture data ends
+         * up where it belongs without being copied; otherwise read it
+         * into a separate buffer and copy the capture data out.
+         *
+         * If our caller doesn't want the capture data, seek over it
+         * and its padding, and read only the options and trailer.
+         */
+        data_len = wblock->data.packet.cap_len - pseudo_header_len;
+        body_len = block_total_length -
+                   (guint32)sizeof(pcapng_block_header_t) -
+                   block_read;      /* fixed part and pseudo-header */
+        if (wblock->skip_data) {
+                if (file_skip(fh, data_len + padding, err) == -1)
+                        return 0;
+                block_read += data_len + padding;
+                body_len -= data_len + padding;
+                data_len = 0;
+                padding = 0;
+        }
+        if (body_len <= wblock->frame_buffer_size) {
+                body = (guint8 *) (wblock->frame_buffer);
+        } else {
+                if (body_len > pn->block_buf_len) {
+                        pn->block_buf = g_realloc(pn->block_buf, body_len);
+                        pn->block_buf_len = body_len;
+                }
+                body = pn->block_buf;
+        }
         errno = WTAP_ERR_CANT_READ;
-        bytes_read = file_read((guint8 *) (wblock->frame_buffer), wblock->data.packet.cap_len - pseudo_header_len, fh);
-        if (bytes_read != (int) (wblock->data.packet.cap_len - pseudo_header_len)) {
+        bytes_read = file_read(body, body_len, fh);
+        if (bytes_read != (int) body_len) {
                 *err = file_error(fh, err_info);
-                pcapng_debug1("pcapng_read_packet_block: couldn't read %u bytes of captured data",
-                              wblock->data.packet.cap_len - pseudo_header_len);
+                pcapng_debug1("pcapng_read_packet_block: couldn't read %u bytes of captured data and options",
+                              body_len);
                 if (*err == 0)
                         *err = WTAP_ERR_SHORT_READ;
                 return 0;
         }
-        block_read += bytes_read;
+        if (body != wblock->frame_buffer)
+                memcpy((guint8 *) (wblock->frame_buffer), body, data_len);
 
-        /* jump over potential padding bytes at end of the packet data */
-        if (padding != 0) {
-                file_offset64 = file_seek(fh, padding, SEEK_CUR, err);
-                if (file_offset64 <= 0) {
-                        if (*err != 0)
-                                return -1;
-                        return 0;
-                }
-                block_read += padding;
+        /* sanity check: first and second block lengths must match */
+        memcpy(&trailer_length, body + body_len - sizeof trailer_length, sizeof trailer_length);
+        if (pn->byte_swapped)
+                trailer_length = BSWAP32(trailer_length);
+        if (trailer_length != bh->block_total_length) {
+                *err = WTAP_ERR_BAD_FILE;
+                *err_info = g_strdup_printf("pcapng_read_block: total block lengths (first %u and second %u) don't match",
+                              bh->block_total_length, trailer_length);
+                return -1;
         }
 
         /* Option defaults */
@@ -1130,24 +1203,20 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
          * epb_hash       3
          * epb_dropcount  4
          */
-        errno = WTAP_ERR_CANT_READ;
-        to_read = block_total_length -
-                  (int)sizeof(pcapng_block_header_t) -
-                  block_read -    /* fixed and variable part, including padding */
-                  (int)sizeof(bh->block_total_length);
-
-        /* Allocate enough memory to hold all options */
-        opt_cont_buf_len = to_read;
-        option_content = g_malloc(opt_cont_buf_len);
+        opt_ptr = body + data_len + padding;
+        to_read = body_len - data_len - padding - (guint32)sizeof trailer_length;
 
         while (to_read > 0) {
-                /* read option */
-                bytes_read = pcapng_read_option(fh, pn, &oh, option_content, opt_cont_buf_len, err, err_info);
+                /* parse option */
+                bytes_read = pcapng_parse_option(pn, opt_ptr, to_read, &oh, &option_content);
                 if (bytes_read <= 0) {
                         pcapng_debug0("pcapng_read_packet_block: failed to read option");
-                        return bytes_read;
+                        *err = WTAP_ERR_BAD_FILE;
+                        *err_info = g_strdup_printf("pcapng_read_packet_block: option doesn't fit in the remaining %u bytes of the block",
+                                      to_read);
+                        return -1;
                 }
-                block_read += bytes_read;
+                opt_ptr += bytes_read;
                 to_read -= bytes_read;
 
                 /* handle option content */
@@ -1160,9 +1229,9 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
                         to_read = 0;
                         break;
                     case(1): /* opt_comment */
-                        if (oh.option_length > 0 && oh.option_length < opt_cont_buf_len) {
+                        if (oh.option_length > 0) {
                                 wblock->packet_header->presence_flags |= WTAP_HAS_COMMENTS;
-                                wblock->packet_header->opt_comment = g_strndup(option_content, oh.option_length);
+                                wblock->packet_header->opt_comment = g_strndup((const char *)option_content, oh.option_length);
                                 pcapng_debug2("pcapng_read_packet_block: length %u opt_comment '%s'", oh.option_length, wblock->packet_header->opt_comment);
                         } else {
                                 pcapng_debug1("pcapng_read_packet_block: opt_comment length %u seems strange", oh.option_length);
@@ -1211,14 +1280,13 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
                 }
         }
 
-        g_free(option_content);
-
-        pcap_read_post_process(WTAP_FILE_PCAPNG, int_data.wtap_encap,
-            (union wtap_pseudo_header *)wblock->pseudo_header,
-            (guint8 *) (wblock->frame_buffer),
-            (int) (wblock->data.packet.cap_len - pseudo_header_len),
-            pn->byte_swapped, fcslen);
-        return block_read;
+        if (!wblock->skip_data)
+                pcap_read_post_process(WTAP_FILE_PCAPNG, int_data.wtap_encap,
+                    (union wtap_pseudo_header *)wblock->pseudo_header,
+                    (guint8 *) (wblock->frame_buffer),
+                    (int) (wblock->data.packet.cap_len - pseudo_header_len),
+                    pn->byte_swapped, fcslen);
+        return block_read + body_len;
 }
 
 
@@ -1948,6 +2016,10 @@ pcapng_read_block(FILE_T fh, gboolean first_block, pcapng_t *pn, wtapng_block_t
         }
         block_read += bytes_read;
 
+        /* packet block readers check the trailing length themselves */
+        if (bh.block_type == BLOCK_TYPE_PB || bh.block_type == BLOCK_TYPE_EPB)
+                return block_read;
+
         /* sanity check: first and second block lengths must match */
         errno = WTAP_ERR_CANT_READ;
         bytes_read = file_read(&block_total_length, sizeof block_total_length, fh);
@@ -1996,10 +2068,14 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
         pn.version_minor = -1;
         pn.interface_data = g_array_new(FALSE, FALSE, sizeof(interface_data_t));
         pn.number_of_interfaces = 0;
+        pn.block_buf = NULL;
+        pn.block_buf_len = 0;
 
 
         /* we don't expect any packet blocks yet */
         wblock.frame_buffer = NULL;
+        wblock.frame_buffer_size = 0;
+        wblock.skip_data = FALSE;
         wblock.pseudo_header = NULL;
         wblock.packet_header = NULL;
         wblock.file_encap = &wth->file_encap;
@@ -2151,6 +2227,7 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
         wtapng_block_t wblock;
         wtapng_if_descr_t *wtapng_if_descr;
         wtapng_if_stats_t if_stats;
+        guint frame_buffer_size;
 
         *data_offset = file_tell(wth->fh);
         pcapng_debug1("pcapng_read: data_offset is initially %" G_GINT64_MODIFIER "d", *data_offset);
@@ -2159,12 +2236,15 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
          * should make use of the caplen of the packet.
          */
         if (wth->snapshot_length > 0) {
-                buffer_assure_space(wth->frame_buffer, wth->snapshot_length);
+                frame_buffer_size = wth->snapshot_length;
         } else {
-                buffer_assure_space(wth->frame_buffer, WTAP_MAX_PACKET_SIZE);
+                frame_buffer_size = WTAP_MAX_PACKET_SIZE;
         }
+        buffer_assure_space(wth->frame_buffer, frame_buffer_size);
 
         wblock.frame_buffer  = buffer_start_ptr(wth->frame_buffer);
+        wblock.frame_buffer_size = frame_buffer_size;
+        wblock.skip_data = wth->skip_packet_data;
         wblock.pseudo_header = &wth->pseudo_header;
         wblock.packet_header = &wth->phdr;
         wblock.file_encap    = &wth->file_encap;
@@ -2244,7 +2324,7 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 /* classic wtap: seek to file position and read packet */
 static gboolean
 pcapng_seek_read(wtap *wth, gint64 seek_off,
-    union wtap_pseudo_header *pseudo_header, guint8 *pd, int length _U_,
+    union wtap_pseudo_header *pseudo_header, guint8 *pd, int length,
     int *err, gchar **err_info)
 {
         pcapng_t *pcapng = (pcapng_t *)wth->priv;
@@ -2261,6 +2341,8 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
         pcapng_debug1("pcapng_seek_read: reading at offset %" G_GINT64_MODIFIER "u", seek_off);
 
         wblock.frame_buffer = pd;
+        wblock.frame_buffer_size = length;
+        wblock.skip_data = FALSE;
         wblock.pseudo_header = pseudo_header;
         wblock.packet_header = &wth->phdr;
         wblock.file_encap = &wth->file_encap;
@@ -2294,6 +2376,7 @@ pcapng_close(wtap *wth)
         if (pcapng->interface_data != NULL) {
                 g_array_free(pcapng->interface_data, TRUE);
         }
+        g_free(pcapng->block_buf);
 }
 
 
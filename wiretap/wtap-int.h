@@ -76,6 +76,7 @@ struct wtap {
     wtap_new_ipv4_callback_t    add_new_ipv4;
     wtap_new_ipv6_callback_t    add_new_ipv6;
     GPtrArray                   *fast_seek;
+    gboolean                    skip_packet_data; /* wtap_read() needn't read the packet data */
 };
 
 struct wtap_dumper;
@@ -91,14 +92,21 @@ typedef gboolean (*subtype_write_func)(struct wtap_dumper*,
                                        const guint8*, int*);
 typedef gboolean (*subtype_close_func)(struct wtap_dumper*, int*);
 
+/* Size of the output buffer used when writing uncompressed files */
+#define WTAP_DUMP_BUF_SIZE      (64 * 1024)
+
 struct wtap_dumper {
     WFILE_T                 fh;
     int                     file_type;
     int                     snaplen;
     int                     encap;
-    gboolean                compressed;
+    int                     compressed;     /* WTAP_..._COMPRESSED */
     gint64                  bytes_dumped;
 
+    guint8                  *out_buf;       /* output buffer for uncompressed files, or NULL */
+    size_t                  out_buf_len;    /* bytes waiting in out_buf */
+    int                     out_buf_err;    /* error from a deferred write of out_buf, or 0 */
+
     void                    *priv;
 
     subtype_write_func      subtype_write;
@@ -84,6 +84,18 @@ wtap_iscompressed(wtap *wth)
 	return file_iscompressed((wth->fh == NULL) ? wth->random_fh : wth->fh);
 }
 
+double
+wtap_read_stall_time(wtap *wth)
+{
+	double secs = 0.0;
+
+	if (wth->fh != NULL)
+		secs += file_stall_time(wth->fh);
+	if (wth->random_fh != NULL)
+		secs += file_stall_time(wth->random_fh);
+	return secs;
+}
+
 guint
 wtap_snapshot_length(wtap *wth)
 {
@@ -828,6 +840,11 @@ void wtap_set_cb_new_ipv6(wtap *wth, wtap_new_ipv6_callback_t add_new_ipv6) {
 		wth->add_new_ipv6 = add_new_ipv6;
 }
 
+void wtap_set_skip_packet_data(wtap *wth, gboolean skip) {
+	if (wth)
+		wth->skip_packet_data = skip;
+}
+
 gboolean
 wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 {
@@ -1054,6 +1054,14 @@ void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4);
 typedef void (*wtap_new_ipv6_callback_t) (const void *addrp, const gchar *name);
 void wtap_set_cb_new_ipv6(wtap *wth, wtap_new_ipv6_callback_t add_new_ipv6);
 
+/**
+ * Tell wtap_read() that the caller only wants the packet headers, so
+ * that the packet data can be skipped over rather than read; the frame
+ * buffer then doesn't hold the packet data.  Currently pcap- and
+ * pcapng-only; other file types still read the data.
+ */
+void wtap_set_skip_packet_data(wtap *wth, gboolean skip);
+
 /** Returns TRUE if read was successful. FALSE if failure. data_offset is
  * set to the offset in the file where the data for the read packet is
  * located. */
@@ -1076,6 +1084,9 @@ guint8 *wtap_buf_ptr(wtap *wth);
 gint64 wtap_read_so_far(wtap *wth);
 gint64 wtap_file_size(wtap *wth, int *err);
 gboolean wtap_iscompressed(wtap *wth);
+/** Return the time, in seconds, spent waiting for the file to be read,
+ * either by the OS or by a reader thread reading ahead of us. */
+double wtap_read_stall_time(wtap *wth);
 guint wtap_snapshot_length(wtap *wth); /* per file */
 int wtap_file_type(wtap *wth);
 int wtap_file_encap(wtap *wth);
@@ -1104,20 +1115,28 @@ gboolean wtap_dump_can_write_encap(int filetype, int encap);
  */
 gboolean wtap_dump_can_write_encaps(int ft, const GArray *file_encaps);
 
+/*
+ * Values for the "compressed" argument of wtap_dump_open() and friends;
+ * TRUE means gzip.
+ */
+#define WTAP_UNCOMPRESSED	0
+#define WTAP_GZIP_COMPRESSED	1
+#define WTAP_ZSTD_COMPRESSED	2
+
 gboolean wtap_dump_can_compress(int filetype);
 gboolean wtap_dump_has_name_resolution(int filetype);
 
 wtap_dumper* wtap_dump_open(const char *filename, int filetype, int encap,
-	int snaplen, gboolean compressed, int *err);
+	int snaplen, int compressed, int *err);
 
 wtap_dumper* wtap_dump_open_ng(const char *filename, int filetype, int encap,
-	int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
+	int snaplen, int compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
 wtap_dumper* wtap_dump_fdopen(int fd, int filetype, int encap, int snaplen,
-	gboolean compressed, int *err);
+	int compressed, int *err);
 
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int filetype, int encap, int snaplen,
-				gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
+				int compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
 
 gboolean wtap_dump(wtap_dumper *, const struct wtap_pkthdr *,
@@ -1140,6 +1159,7 @@ GArray *wtap_get_savable_file_types(int file_type, const GArray *file_encaps);
 const char *wtap_file_type_string(int filetype);
 const char *wtap_file_type_short_string(int filetype);
 int wtap_short_string_to_file_type(const char *short_name);
+int wtap_short_string_to_compression_type(const char *short_name);
 
 /*** various file extension functions ***/
 const char *wtap_default_file_extension(int filetype);